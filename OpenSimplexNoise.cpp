@@ -21,51 +21,254 @@
 
 // https://gist.github.com/tombsar/716134ec71d1b8c1b530
 
+#if defined(__clang__) && !defined(OSN_NO_MULTIVERSIONING)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
 #include "OpenSimplexNoise.h"
+#include "OpenSimplexNoise2.h"
+
 
+// The batch kernels below are built once per x86-64 microarchitecture level
+// and dispatched through an ifunc resolver when the program is loaded, so a
+// single generic binary still runs eval code scheduled and vectorized for the
+// CPU it finds itself on. flatten makes sure eval is inlined into (and so
+// compiled for) every clone. Define OSN_NO_MULTIVERSIONING to build only one.
+//
+// The 2D kernels stop at x86-64-v3: their v4 clone measured slower than the
+// v3 one, and even than the generic build, on an AVX-512 Xeon.
+//
+// Every clone must give the same bits as eval built for the default target,
+// so multiplies and adds are never fused into the FMA instructions of v3 and
+// v4: a fused rounding can move a point across a region boundary of the
+// kernel. GCC takes that per function; Clang contracts while parsing, so
+// the pragma has to come before the headers.
+#if !defined(OSN_NO_MULTIVERSIONING) && defined(__x86_64__) && defined(__ELF__) && \
+	((defined(__clang__) && __clang_major__ >= 14) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 11))
+#define OSN_MULTIVERSIONED
+#ifdef __clang__
+#define OSN_NO_FP_CONTRACT
+#else
+#define OSN_NO_FP_CONTRACT optimize("fp-contract=off"),
+#endif
+#define OSN_TARGET_CLONES __attribute__((OSN_NO_FP_CONTRACT flatten, target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#define OSN_TARGET_CLONES_2D __attribute__((OSN_NO_FP_CONTRACT flatten, target_clones("arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#else
+#define OSN_TARGET_CLONES
+#define OSN_TARGET_CLONES_2D
+#endif
 
 namespace OSN {
-	
-	// Array of gradient values for 2D. They approximate the directions to the
-	// vertices of a octagon from its center.
-	// Gradient set 2014-10-06.
-	const int Noise<2>::gradients [] = {
-		5, 2, 2, 5, -5, 2, -2, 5,
-		5, -2, 2, -5, -5, -2, -2, -5
-	};
-	
-	// Array of gradient values for 3D. They approximate the directions to the
-	// vertices of a rhombicuboctahedron from its center, skewed so that the
-	// triangular and square facets can be inscribed in circles of the same radius.
-	// New gradient set 2014-10-06.
-	const int Noise<3>::gradients [] = {
-		-11, 4, 4, -4, 11, 4, -4, 4, 11, 11, 4, 4, 4, 11, 4, 4, 4, 11,
-		-11, -4, 4, -4, -11, 4, -4, -4, 11, 11, -4, 4, 4, -11, 4, 4, -4, 11,
-		-11, 4, -4, -4, 11, -4, -4, 4, -11, 11, 4, -4, 4, 11, -4, 4, 4, -11,
-		-11, -4, -4, -4, -11, -4, -4, -4, -11, 11, -4, -4, 4, -11, -4, 4, -4, -11
-	};
-
-	// Array of gradient values for 4D. They approximate the directions to the
-	// vertices of a disprismatotesseractihexadecachoron from its center, skewed so that the
-	// tetrahedral and cubic facets can be inscribed in spheres of the same radius.
-	// Gradient set 2014-10-06.
-	const int Noise<4>::gradients [] = {
-		3, 1, 1, 1, 1, 3, 1, 1, 1, 1, 3, 1, 1, 1, 1, 3,
-		-3, 1, 1, 1, -1, 3, 1, 1, -1, 1, 3, 1, -1, 1, 1, 3,
-		3, -1, 1, 1, 1, -3, 1, 1, 1, -1, 3, 1, 1, -1, 1, 3,
-		-3, -1, 1, 1, -1, -3, 1, 1, -1, -1, 3, 1, -1, -1, 1, 3,
-		3, 1, -1, 1, 1, 3, -1, 1, 1, 1, -3, 1, 1, 1, -1, 3,
-		-3, 1, -1, 1, -1, 3, -1, 1, -1, 1, -3, 1, -1, 1, -1, 3,
-		3, -1, -1, 1, 1, -3, -1, 1, 1, -1, -3, 1, 1, -1, -1, 3,
-		-3, -1, -1, 1, -1, -3, -1, 1, -1, -1, -3, 1, -1, -1, -1, 3,
-		3, 1, 1, -1, 1, 3, 1, -1, 1, 1, 3, -1, 1, 1, 1, -3,
-		-3, 1, 1, -1, -1, 3, 1, -1, -1, 1, 3, -1, -1, 1, 1, -3,
-		3, -1, 1, -1, 1, -3, 1, -1, 1, -1, 3, -1, 1, -1, 1, -3,
-		-3, -1, 1, -1, -1, -3, 1, -1, -1, -1, 3, -1, -1, -1, 1, -3,
-		3, 1, -1, -1, 1, 3, -1, -1, 1, 1, -3, -1, 1, 1, -1, -3,
-		-3, 1, -1, -1, -1, 3, -1, -1, -1, 1, -3, -1, -1, 1, -1, -3,
-		3, -1, -1, -1, 1, -3, -1, -1, 1, -1, -3, -1, 1, -1, -1, -3,
-		-3, -1, -1, -1, -1, -3, -1, -1, -1, -1, -3, -1, -1, -1, -1, -3
-	};
+
+	namespace Metrics {
+
+		// The level the ifunc resolvers pick, judged by the features that define
+		// each level. Where it is x86-64-v4, the 2D kernels run their v3 clone.
+		const char * dispatchedKernelVariant(void) {
+#ifdef OSN_MULTIVERSIONED
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+				__builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) { return "x86-64-v4"; }
+			if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2")) { return "x86-64-v3"; }
+			if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) { return "x86-64-v2"; }
+			return "default";
+#else
+			return "generic";
+#endif
+		}
+
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<1>::evalBatch(const double * x, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<1>::evalBatch(const float * x, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<1>::evalTrack(double start, double step, double * out, size_t count) const {
+		evalTrackFloor(RuntimeFloor(), start, step, out, count);
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<1>::evalTrack(float start, float step, float * out, size_t count) const {
+		evalTrackFloor(RuntimeFloor(), start, step, out, count);
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise<2>::evalBatch(const double * x, const double * y, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise<2>::evalBatch(const float * x, const float * y, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<3>::evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<3>::evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise<2>::evalGradientBatch(const double * x, const double * y, ValueGradient<double, 2> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { evalGradient(x[i], y[i], out[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise<2>::evalGradientBatch(const float * x, const float * y, ValueGradient<float, 2> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { evalGradient(x[i], y[i], out[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<3>::evalGradientBatch(const double * x, const double * y, const double * z, ValueGradient<double, 3> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { evalGradient(x[i], y[i], z[i], out[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<3>::evalGradientBatch(const float * x, const float * y, const float * z, ValueGradient<float, 3> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { evalGradient(x[i], y[i], z[i], out[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise<2>::hessianBatch(const double * x, const double * y, Derivatives<double, 2> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { hessian(x[i], y[i], out[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise<2>::hessianBatch(const float * x, const float * y, Derivatives<float, 2> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { hessian(x[i], y[i], out[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<3>::hessianBatch(const double * x, const double * y, const double * z, Derivatives<double, 3> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { hessian(x[i], y[i], z[i], out[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<3>::hessianBatch(const float * x, const float * y, const float * z, Derivatives<float, 3> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { hessian(x[i], y[i], z[i], out[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<4>::evalBatch(const double * x, const double * y, const double * z, const double * w, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i], w[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise<4>::evalBatch(const float * x, const float * y, const float * z, const float * w, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i], w[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void LoopingNoise<>::evalBatch(const double * x, const double * y, const double * t, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], t[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void LoopingNoise<>::evalBatch(const float * x, const float * y, const float * t, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], t[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void LoopingNoise<>::evalFrames(const double * x, const double * y, double * out, size_t count, size_t frames) const {
+		evalFramesFloor(RuntimeFloor(), x, y, out, count, frames);
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void LoopingNoise<>::evalFrames(const float * x, const float * y, float * out, size_t count, size_t frames) const {
+		evalFramesFloor(RuntimeFloor(), x, y, out, count, frames);
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise2F<2>::evalBatch(const double * x, const double * y, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise2F<2>::evalBatch(const float * x, const float * y, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise2S<2>::evalBatch(const double * x, const double * y, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES_2D
+	void Noise2S<2>::evalBatch(const float * x, const float * y, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise2F<3>::evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise2F<3>::evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise2S<3>::evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise2S<3>::evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise2F<4>::evalBatch(const double * x, const double * y, const double * z, const double * w, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i], w[i]); }
+	}
+
+	template <>
+	OSN_TARGET_CLONES
+	void Noise2F<4>::evalBatch(const float * x, const float * y, const float * z, const float * w, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i], w[i]); }
+	}
 
 }
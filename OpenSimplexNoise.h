@@ -22,8 +22,16 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
+#include <vector>
+
+#ifdef OSN_ENABLE_METRICS
+#include "OpenSimplexNoiseMetrics.h"
+#else
+#define OSN_METRICS_ADD(counter, n) ((void) 0)
+#endif
 
 
 namespace OSN {
@@ -60,28 +68,134 @@ namespace OSN {
 		}
 	}
 
+	// Floor policies used by the evaluation kernels. Each returns floor(x) as a
+	// floating-point value and stores it as an integer in i.
+
+	// Exact for every input. Compiles to a single instruction where the target
+	// has one (e.g. SSE4.1 roundsd), otherwise it may be a library call.
+	struct StrictFloor {
+		template <typename I, typename T>
+		static inline T floor(T x, I & i) {
+			T d = std::floor(x);
+			i = (I) d;
+			return d;
+		}
+	};
+
+	// Truncates and corrects negative values, which avoids std::floor on
+	// targets without a rounding instruction. Off by one at exact negative
+	// integers, and for every negative input if OSN_ALWAYS_POSITIVE is defined.
+	struct FastFloor {
+		template <typename I, typename T>
+		static inline T floor(T x, I & i) {
+			i = (I) fastFloori(x);
+			return (T) i;
+		}
+	};
+
+	// Truncates only. Correct for non-negative inputs alone, like FastFloor
+	// with OSN_ALWAYS_POSITIVE but without affecting other generators.
+	struct PositiveFloor {
+		template <typename I, typename T>
+		static inline T floor(T x, I & i) {
+			i = (I) x;
+			return (T) i;
+		}
+	};
+
+	// Chooses between StrictFloor and FastFloor per generator at runtime,
+	// see NoiseBase::setFloorMode.
+	struct RuntimeFloor {};
+
+	enum FloorMode {
+		FLOOR_STRICT,
+		FLOOR_FAST,
+		// The mode that builds of this file before FloorMode existed would use:
+		// std::floor under -ffast-math, fastFloori otherwise.
+#ifdef __FAST_MATH__
+		FLOOR_DEFAULT = FLOOR_STRICT
+#else
+		FLOOR_DEFAULT = FLOOR_FAST
+#endif
+	};
+
+	// Compile-time configuration of a generator. To tune one, derive from
+	// DefaultPolicy and redefine the members that should change, e.g.
+	//   struct TexturePolicy : OSN::DefaultPolicy {
+	//     typedef OSN::PositiveFloor Floor;
+	//     typedef int32_t Index;
+	//   };
+	//   OSN::Noise<2, TexturePolicy> noise;
+	// Only DefaultPolicy is guaranteed to reproduce the output of earlier
+	// versions of this file bit for bit.
+	struct DefaultPolicy {
+		// Floor used by eval: StrictFloor, FastFloor, PositiveFloor or RuntimeFloor.
+		typedef RuntimeFloor Floor;
+		// Signed integer type of lattice coordinates. A 32-bit type is cheaper
+		// but limits inputs to magnitudes below 2^31.
+		typedef int64_t Index;
+		// Element type of the permutation tables. Any type that holds 0..255;
+		// uint8_t shrinks them from 1 KiB to 256 bytes each.
+		typedef int Perm;
+		// Element type of the gradient tables. Storing them as the evaluation
+		// type (float or double) saves an int conversion per contribution.
+		typedef int Gradient;
+	};
+
+	// Value, gradient and Hessian of an N-dimensional generator at one point.
+	// The Hessian is symmetric, so only its upper triangle is stored, row by
+	// row: xx, xy, yy in 2D and xx, xy, xz, yy, yz, zz in 3D.
+	template <typename T, int N>
+	struct Derivatives {
+		T value;
+		T gradient[N];
+		T hessian[N * (N + 1) / 2];
+	};
+
+	// Value and gradient of an N-dimensional generator at one point.
+	template <typename T, int N>
+	struct ValueGradient {
+		T value;
+		T gradient[N];
+	};
+
+	template <typename Policy = DefaultPolicy>
 	class NoiseBase {
 
+	public:
+
+		typedef typename Policy::Perm PermType;
+
+		// Selects the floor policy used by eval when Policy::Floor is
+		// RuntimeFloor. Strict results are exact at every lattice boundary (use
+		// it for anything that is saved or must match across builds); fast
+		// trades that for speed on older targets.
+		void setFloorMode(FloorMode mode) { floorMode = mode; }
+		FloorMode getFloorMode(void) const { return floorMode; }
+
 	protected:
 
-		int perm[256];
+		PermType perm[256];
+		FloorMode floorMode;
 
 		// Empty constructor to allow child classes to set up perm themselves.
-		NoiseBase(void) {}
+		NoiseBase(void) : floorMode(FLOOR_DEFAULT) {}
 
 		// Perform one step of the Linear Congruential Generator algorithm.
+		// The arithmetic wraps in unsigned: signed overflow is undefined, and
+		// an optimizer that sees a constant seed may assume it never happens.
 		inline static void LCG_STEP(int64_t & x) {
 			// Magic constants are attributed to Donald Knuth's MMIX implementation.
-			static const int64_t MULTIPLIER = 6364136223846793005LL;
-			static const int64_t INCREMENT = 1442695040888963407LL;
-			x = ((x * MULTIPLIER) + INCREMENT);
+			static const uint64_t MULTIPLIER = 6364136223846793005ULL;
+			static const uint64_t INCREMENT = 1442695040888963407ULL;
+			x = (int64_t) (((uint64_t) x * MULTIPLIER) + INCREMENT);
 		}
 
 		// Initializes the class using a permutation array generated from a 64-bit seed.
 		// Generates a proper permutation (i.e. doesn't merely perform N successive
 		// pair swaps on a base array).
 		// Uses a simple 64-bit LCG.
-		NoiseBase(int64_t seed) {
+		NoiseBase(int64_t seed) : floorMode(FLOOR_DEFAULT) {
 			int source[256];
 			for (int i = 0; i < 256; ++i) { source[i] = i; }
 			LCG_STEP(seed);
@@ -89,31 +203,514 @@ namespace OSN {
 			LCG_STEP(seed);
 			for (int i = 255; i >= 0; --i) {
 				LCG_STEP(seed);
-				int r = (int) ((seed + 31) % (i + 1));
+				int r = (int) ((int64_t) ((uint64_t) seed + 31) % (i + 1));
 				if (r < 0) { r += (i + 1); }
-				perm[i] = source[r];
+				perm[i] = (PermType) source[r];
 				source[r] = source[i];
 			}
 		}
 
-		NoiseBase(const int * p) {
+		NoiseBase(const int * p) : floorMode(FLOOR_DEFAULT) {
 			// Copy the supplied permutation array into this instance
-			for (int i = 0; i < 256; ++i) { perm[i] = p[i]; }
+			for (int i = 0; i < 256; ++i) { perm[i] = (PermType) p[i]; }
+		}
+
+		// Adds one contribution, attn^4 * (g . d) with attn = max(2 - d . d, 0),
+		// and its first and second derivatives to out. With e = g . d,
+		//   gradient  = attn^3 * (attn * g - 8 * e * d)
+		//   Hessian   = attn^2 * (48 * e * d d^T - 8 * attn * (g d^T + d g^T + e * I))
+		// Every term has a factor of attn^2, so points out of range add zero.
+		template <int N, typename T>
+		static inline void addDerivatives(const T (&g)[N], const T (&d)[N], Derivatives<T, N> & out) {
+			T attn = (T)2.0;
+			T e = (T)0.0;
+			for (int j = 0; j < N; ++j) {
+				attn -= d[j] * d[j];
+				e += g[j] * d[j];
+			}
+			attn = inline_fast_max(attn, (T)0.0);
+			T attn2 = attn * attn;
+			T attn3 = attn2 * attn;
+			out.value += attn2 * attn2 * e;
+			for (int j = 0; j < N; ++j) {
+				out.gradient[j] += attn3 * (attn * g[j] - (T)8.0 * e * d[j]);
+			}
+			T outer = (T)48.0 * attn2 * e;
+			T cross = (T)8.0 * attn3;
+			int h = 0;
+			for (int j = 0; j < N; ++j) {
+				for (int k = j; k < N; ++k, ++h) {
+					T term = outer * d[j] * d[k] - cross * (g[j] * d[k] + g[k] * d[j]);
+					if (j == k) { term -= cross * e; }
+					out.hessian[h] += term;
+				}
+			}
+		}
+
+		// As above, without the Hessian.
+		template <int N, typename T>
+		static inline void addDerivatives(const T (&g)[N], const T (&d)[N], ValueGradient<T, N> & out) {
+			T attn = (T)2.0;
+			T e = (T)0.0;
+			for (int j = 0; j < N; ++j) {
+				attn -= d[j] * d[j];
+				e += g[j] * d[j];
+			}
+			attn = inline_fast_max(attn, (T)0.0);
+			T attn2 = attn * attn;
+			T attn3 = attn2 * attn;
+			out.value += attn2 * attn2 * e;
+			for (int j = 0; j < N; ++j) {
+				out.gradient[j] += attn3 * (attn * g[j] - (T)8.0 * e * d[j]);
+			}
+		}
+
+		// Clears out, ready for addDerivatives.
+		template <int N, typename T>
+		static inline void clearDerivatives(Derivatives<T, N> & out) {
+			out.value = (T)0.0;
+			for (int j = 0; j < N; ++j) { out.gradient[j] = (T)0.0; }
+			for (int h = 0; h < N * (N + 1) / 2; ++h) { out.hessian[h] = (T)0.0; }
+		}
+
+		template <int N, typename T>
+		static inline void clearDerivatives(ValueGradient<T, N> & out) {
+			out.value = (T)0.0;
+			for (int j = 0; j < N; ++j) { out.gradient[j] = (T)0.0; }
+		}
+
+		// Multiplies everything in out by the generator's normalization.
+		template <int N, typename T>
+		static inline void scaleDerivatives(Derivatives<T, N> & out, T scale) {
+			out.value *= scale;
+			for (int j = 0; j < N; ++j) { out.gradient[j] *= scale; }
+			for (int h = 0; h < N * (N + 1) / 2; ++h) { out.hessian[h] *= scale; }
+		}
+
+		template <int N, typename T>
+		static inline void scaleDerivatives(ValueGradient<T, N> & out, T scale) {
+			out.value *= scale;
+			for (int j = 0; j < N; ++j) { out.gradient[j] *= scale; }
 		}
 
 	};
 
 
+	// Lattice points that can contribute to the generic N-dimensional kernel.
+	//
+	// In stretched space a point's position relative to its super-cell origin
+	// is its fractional coordinates ins, and its squared distance to the
+	// lattice point at offset v is |u|^2 + (sum u)^2 with u = ins - v. That
+	// distance is symmetric under permuting the axes, so only points with
+	// ins sorted in descending order need to be considered; the kernel sorts
+	// the axes and maps the offsets back. That region is further split into
+	// slabs by floor(sum ins), as the hand-written kernels do, and for each
+	// slab the table lists every offset that can come within the radius
+	// sqrt(2) of the attenuation function.
 	template <int N>
-	class Noise : public NoiseBase {
+	class LatticeTable {
+
+	public:
+
+		static const LatticeTable & instance(void) {
+			static const LatticeTable table;
+			return table;
+		}
+
+		// For each slab, N offsets per lattice point, followed by their sums.
+		// The offsets are kept both as integers, to hash the lattice point,
+		// and as doubles, so that the distance test needs no conversions.
+		std::vector<signed char> offsets[N];
+		std::vector<double> offsetValues[N];
+		std::vector<double> offsetSums[N];
+
+	private:
+
+		LatticeTable(void) {
+			// The slab between sum ins = slab and slab + 1 is the convex hull of
+			// these points: the two corners of the ordered region that lie on its
+			// boundary planes and the crossings of those planes with the region's
+			// edges.
+			for (int slab = 0; slab < N; ++slab) {
+				std::vector<double> vertices;
+				for (int level = slab; level <= slab + 1; ++level) {
+					for (int a = 0; a <= N; ++a) {
+						for (int b = a; b <= N; ++b) {
+							if ((a == b) ? (a != level) : !(a < level && level < b)) { continue; }
+							double t = (a == b) ? 0.0 : (double) (level - a) / (b - a);
+							for (int i = 0; i < N; ++i) {
+								vertices.push_back(((i < a) ? 1.0 : 0.0) + t * (((i < b) ? 1.0 : 0.0) - ((i < a) ? 1.0 : 0.0)));
+							}
+						}
+					}
+				}
+				// Every axis offset of a contributing point lies in -1..2.
+				int offset[N];
+				for (int i = 0; i < N; ++i) { offset[i] = -1; }
+				for (;;) {
+					if (minDistanceSquared(offset, vertices) < 2.0) {
+						int sum = 0;
+						for (int i = 0; i < N; ++i) {
+							offsets[slab].push_back((signed char) offset[i]);
+							offsetValues[slab].push_back(offset[i]);
+							sum += offset[i];
+						}
+						offsetSums[slab].push_back(sum);
+					}
+					int i = 0;
+					while (i < N && offset[i] == 2) { offset[i++] = -1; }
+					if (i == N) { break; }
+					++offset[i];
+				}
+			}
+		}
+
+		// A lower bound on the squared distance from lattice offset v to the
+		// polytope with the given vertices. Uses Frank-Wolfe iterations, whose
+		// duality gap bounds the distance from below, and stops as soon as the
+		// answer to "is it less than 2?" is certain.
+		static double minDistanceSquared(const int * v, const std::vector<double> & vertices) {
+			const size_t count = vertices.size() / N;
+			double x[N];
+			for (int i = 0; i < N; ++i) {
+				x[i] = 0.0;
+				for (size_t k = 0; k < count; ++k) { x[i] += vertices[k * N + i] / count; }
+			}
+			double bound = 0.0;
+			for (int iteration = 0; iteration < 10000; ++iteration) {
+				double u[N], g[N], su = 0.0, f = 0.0;
+				for (int i = 0; i < N; ++i) { u[i] = x[i] - v[i]; su += u[i]; }
+				for (int i = 0; i < N; ++i) { g[i] = 2.0 * (u[i] + su); f += u[i] * u[i]; }
+				f += su * su;
+				if (f < 2.0) { return f; }
+				size_t best = 0;
+				double bestDot = 0.0;
+				for (size_t k = 0; k < count; ++k) {
+					double dot = 0.0;
+					for (int i = 0; i < N; ++i) { dot += g[i] * vertices[k * N + i]; }
+					if (k == 0 || dot < bestDot) { best = k; bestDot = dot; }
+				}
+				double d[N], sd = 0.0, dd = 0.0, gd = 0.0;
+				for (int i = 0; i < N; ++i) {
+					d[i] = vertices[best * N + i] - x[i];
+					sd += d[i];
+					dd += d[i] * d[i];
+					gd += g[i] * d[i];
+				}
+				bound = f + gd;
+				if (bound >= 2.0) { return bound; }
+				dd += sd * sd;
+				if (dd <= 0.0) { return f; }
+				double t = inline_fast_max(-gd / (2.0 * dd), 0.0);
+				if (t > 1.0) { t = 1.0; }
+				for (int i = 0; i < N; ++i) { x[i] += t * d[i]; }
+			}
+			return bound;
+		}
+
+	};
+
+	// Generic N-dimensional implementation of the OpenSimplexNoise generator.
+	// It evaluates the same simplectic honeycomb and attenuation as the
+	// hand-written kernels, visiting only the lattice points listed in
+	// LatticeTable<N>. Gradients are the 2^N diagonals (+-1, ..., +-1) selected
+	// by the bits of the permutation hash, which limits N to 8. For N = 2..4 it
+	// therefore produces different (but equally valid) noise than Noise<N>.
+	//
+	// It is a slow reference path: it walks every lattice point that can be
+	// in reach of the slab rather than only those of the point's simplex, and
+	// takes one and a half to two and a half times as long as Noise<N> in 2D
+	// to 4D. Use it for N > 4, or to check the hand-written kernels.
+	template <int N, typename Policy = DefaultPolicy>
+	class LatticeNoise : public NoiseBase<Policy> {
+	private:
+
+		static_assert(N >= 2 && N <= 8, "The generic OpenSimplexNoise kernel supports 2 to 8 dimensions");
+
+		typedef NoiseBase<Policy> Base;
+		typedef typename Policy::Index inttype;
+		using Base::perm;
+		using Base::floorMode;
+
+		// Scale that keeps the output within [-1, 1]. Each lattice point adds
+		// at most attn^4 times the sum of |d[i]|, when every gradient sign
+		// matches its displacement; the largest total of that over the input
+		// lies on the main diagonal of the super-cell, found by a fine search
+		// along it and confirmed by hill climbing from random starts, and is
+		// rounded up here.
+		template <typename T>
+		static T normConstant(void) {
+			static const double NORM[9] = { 0.0, 0.0, 10.35, 13.04, 15.40, 17.73, 20.07, 22.45, 24.87 };
+			return (T) (1.0 / NORM[N]);
+		}
+
+		// Dispatch eval to the kernel for Policy::Floor.
+		template <typename T>
+		T evalFloor(RuntimeFloor, const T * x) const {
+			return (floorMode == FLOOR_STRICT) ? evalKernel<StrictFloor>(x) : evalKernel<FastFloor>(x);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, const T * x) const {
+			return evalKernel<Floor>(x);
+		}
+
+	public:
+
+		LatticeNoise(int64_t seed = 0LL) : Base(seed) {}
+		LatticeNoise(const int * p) : Base(p) {}
+
+
+		// Evaluates the noise at the N coordinates pointed to by x.
+		template <typename T>
+		T eval(const T * x) const {
+			return evalFloor(typename Policy::Floor(), x);
+		}
+
+		// Evaluates the noise at N coordinates given as separate arguments.
+		template <typename T, typename... Ts>
+		T eval(T x0, T x1, Ts... xs) const {
+			static_assert(sizeof...(Ts) + 2 == N, "eval takes one coordinate per dimension");
+			const T x[N] = { x0, x1, xs... };
+			return eval(x);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(const T * x) const {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+
+			static const T STRETCH_CONSTANT = (T) ((1.0 / std::sqrt(N + 1.0) - 1.0) / N);
+			static const T SQUISH_CONSTANT = (T) ((std::sqrt(N + 1.0) - 1.0) / N);
+
+			const LatticeTable<N> & table = LatticeTable<N>::instance();
+
+			// Place input coordinates on simplectic honeycomb.
+			T stretchOffset = 0;
+			for (int i = 0; i < N; ++i) { stretchOffset += x[i]; }
+			stretchOffset *= STRETCH_CONSTANT;
+
+			// Floor to get simplectic honeycomb coordinates of the super-cell
+			// origin, and sort the axes by descending position within it.
+			inttype sb[N];
+			T ins[N];
+			int order[N];
+			T inSum = 0;
+			for (int i = 0; i < N; ++i) {
+				T s = x[i] + stretchOffset;
+				ins[i] = s - Floor::floor(s, sb[i]);
+				inSum += ins[i];
+				int k = i;
+				for (; k > 0 && ins[order[k - 1]] < ins[i]; --k) { order[k] = order[k - 1]; }
+				order[k] = i;
+			}
+
+			int slab = (int) inSum;
+			if (slab > N - 1) { slab = N - 1; }
+
+			const signed char * offset = &table.offsets[slab][0];
+			const double * offsetValue = &table.offsetValues[slab][0];
+			const double * offsetSum = &table.offsetSums[slab][0];
+			const size_t count = table.offsetSums[slab].size();
+
+			// Gather the sorted coordinates once rather than per lattice point.
+			T sorted[N];
+			for (int k = 0; k < N; ++k) { sorted[k] = ins[order[k]]; }
+
+			T value = 0;
+			for (size_t c = 0; c < count; ++c, offset += N, offsetValue += N) {
+				T su = inSum - (T) offsetSum[c];
+				T attn = su * su;
+				T u[N];
+				for (int k = 0; k < N; ++k) {
+					u[k] = sorted[k] - (T) offsetValue[k];
+					attn += u[k] * u[k];
+				}
+				attn = (T)2.0 - attn;
+				if (attn <= (T)0.0) { continue; }
+
+				// Hash the lattice point and dot the gradient with the
+				// unstretched displacement to it.
+				inttype lattice[N];
+				T d[N];
+				for (int k = 0; k < N; ++k) {
+					lattice[order[k]] = sb[order[k]] + offset[k];
+					d[order[k]] = u[k] + su * SQUISH_CONSTANT;
+				}
+				unsigned int hash = 0;
+				for (int i = 0; i < N; ++i) { hash = perm[(hash + lattice[i]) & 0xFF]; }
+				T ext = 0;
+				for (int i = 0; i < N; ++i) { ext += ((hash >> i) & 1) ? -d[i] : d[i]; }
+
+				value += pow4(attn) * ext;
+			}
+
+			return (value * normConstant<T>());
+		}
+
+	};
+
+	// Dimensions without a hand-written kernel use the generic one.
+	template <int N, typename Policy = DefaultPolicy>
+	class Noise : public LatticeNoise<N, Policy> {
+	public:
+
+		Noise(int64_t seed = 0LL) : LatticeNoise<N, Policy>(seed) {}
+		Noise(const int * p) : LatticeNoise<N, Policy>(p) {}
+
+	};
+
+	// 1D Implementation of the OpenSimplexNoise generator.
+	// The lattice is the integers, so there is nothing to stretch or squish:
+	// each sample sums the attenuated gradients of the (at most three)
+	// lattice points within the same radius as the other dimensions use.
+	template <typename Policy>
+	class Noise <1, Policy> : public NoiseBase<Policy> {
+	private:
+
+		typedef NoiseBase<Policy> Base;
+		typedef typename Policy::Index inttype;
+		typedef typename Policy::Gradient GradientType;
+		typedef typename Base::PermType PermType;
+		using Base::perm;
+		using Base::floorMode;
+
+		// Array of gradient values for 1D. Values are defined below the class definition.
+		static const GradientType gradients[16];
+
+		inline GradientType gradient(inttype xsb) const {
+			return gradients[perm[xsb & 0xFF] & 0x0F];
+		}
+
+		// Contributions from the lattice points at offsets -1, 0, 1 and 2 from
+		// the base point, given the gradients there and the offset dx0 of the
+		// input from the base point. The outer two are only ever in range on
+		// their own side of the cell.
+		template <typename T>
+		static inline T contribute(const T (&g)[4], T dx0) {
+			T value = 0;
+			T dx = dx0 + (T)1.0;
+			T attn = (T)2.0 - dx * dx;
+			if (attn > (T)0.0) { value += pow4(attn) * g[0] * dx; }
+			attn = (T)2.0 - dx0 * dx0;
+			value += pow4(attn) * g[1] * dx0;
+			dx = dx0 - (T)1.0;
+			attn = (T)2.0 - dx * dx;
+			value += pow4(attn) * g[2] * dx;
+			dx = dx0 - (T)2.0;
+			attn = (T)2.0 - dx * dx;
+			if (attn > (T)0.0) { value += pow4(attn) * g[3] * dx; }
+			return value;
+		}
+
+		// The largest possible sum (slopes of 8 and -8 at the ends of a cell,
+		// sampled at its midpoint), so the output spans [-1, 1].
+		template <typename T>
+		static inline T normConstant(void) {
+			return (T) (1.0 / 75.03125);
+		}
+
+		// Dispatch eval and evalTrack to the kernel for Policy::Floor.
+		template <typename T>
+		T evalFloor(RuntimeFloor, T x) const {
+			return (floorMode == FLOOR_STRICT) ? evalKernel<StrictFloor>(x) : evalKernel<FastFloor>(x);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T x) const {
+			return evalKernel<Floor>(x);
+		}
+
+		template <typename T>
+		void evalTrackFloor(RuntimeFloor, T start, T step, T * out, size_t count) const {
+			if (floorMode == FLOOR_STRICT) { evalTrackKernel<StrictFloor>(start, step, out, count); }
+			else { evalTrackKernel<FastFloor>(start, step, out, count); }
+		}
+
+		template <typename Floor, typename T>
+		void evalTrackFloor(Floor, T start, T step, T * out, size_t count) const {
+			evalTrackKernel<Floor>(start, step, out, count);
+		}
+
+	public:
+
+		Noise(int64_t seed = 0LL) : Base(seed) {}
+		Noise(const int * p) : Base(p) {}
+
+
+		template <typename T>
+		T eval(T x) const {
+			return evalFloor(typename Policy::Floor(), x);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(T x) const {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_1D_SAMPLES, 1);
+
+			inttype xsb;
+			T dx0 = x - Floor::floor(x, xsb);
+
+			const T g[4] = {
+				(T) gradient(xsb - 1), (T) gradient(xsb),
+				(T) gradient(xsb + 1), (T) gradient(xsb + 2)
+			};
+
+			return (contribute(g, dx0) * normConstant<T>());
+		}
+
+		// Evaluates count samples start, start + step, start + 2 * step, ...,
+		// such as an animation track, without needing an array of inputs.
+		// Multiversioned in OpenSimplexNoise.cpp, like evalBatch.
+		void evalTrack(double start, double step, double * out, size_t count) const;
+		void evalTrack(float start, float step, float * out, size_t count) const;
+
+		// As evalTrack, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		void evalTrackKernel(T start, T step, T * out, size_t count) const {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_1D_SAMPLES, (int64_t) count);
+
+			for (size_t i = 0; i < count; ++i) {
+				// Computed from the start each time so that rounding does not
+				// accumulate. Signed conversion is a single instruction.
+				T x = start + step * (T) (int64_t) i;
+				inttype xsb;
+				T dx0 = x - Floor::floor(x, xsb);
+				const T g[4] = {
+					(T) gradient(xsb - 1), (T) gradient(xsb),
+					(T) gradient(xsb + 1), (T) gradient(xsb + 2)
+				};
+				out[i] = contribute(g, dx0) * normConstant<T>();
+			}
+		}
+
+		// Evaluates count points given in an array.
+		// Defined in OpenSimplexNoise.cpp, where it is built for several instruction
+		// set levels with the best one selected when the program is loaded.
+		void evalBatch(const double * x, double * out, size_t count) const;
+		void evalBatch(const float * x, float * out, size_t count) const;
+
 	};
 
 	// 2D Implementation of the OpenSimplexNoise generator.
-	template <>
-	class Noise <2> : public NoiseBase{
+	template <typename Policy>
+	class Noise <2, Policy> : public NoiseBase<Policy> {
 	private:
 
-		static const int gradients[16];
+		typedef NoiseBase<Policy> Base;
+		typedef typename Policy::Index inttype;
+		typedef typename Policy::Gradient GradientType;
+		typedef typename Base::PermType PermType;
+		using Base::perm;
+		using Base::floorMode;
+
+		// Array of gradient values for 2D. Values are defined below the class definition.
+		static const GradientType gradients[16];
 
 		template <typename T>
 		inline T extrapolate(inttype xsb, inttype ysb, T dx, T dy) const {
@@ -129,28 +726,48 @@ namespace OSN {
 				(v[1] = gradients[index + 1]) * dy;
 		}
 
-	public:
+		// What the lattice point at (xsb, ysb) adds to eval, from (dx, dy)
+		// away. Every 2D path that returns a value sums these, so they agree.
+		template <typename T>
+		inline T contribution(inttype xsb, inttype ysb, T dx, T dy) const {
+			return pow4(inline_fast_max((T)2.0 - (pow2(dx) + pow2(dy)), (T)0.0)) * extrapolate(xsb, ysb, dx, dy);
+		}
 
-		Noise(int64_t seed = 0LL) : NoiseBase(seed) {}
-		Noise(const int * p) : NoiseBase(p) {}
+		// Dispatch eval and deval to the kernel for Policy::Floor.
+		template <typename T>
+		T evalFloor(RuntimeFloor, T x, T y) const {
+			return (floorMode == FLOOR_STRICT) ? evalKernel<StrictFloor>(x, y) : evalKernel<FastFloor>(x, y);
+		}
 
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T x, T y) const {
+			return evalKernel<Floor>(x, y);
+		}
 
 		template <typename T>
-		T eval(T x, T y) const {
+		void devalFloor(RuntimeFloor, T x, T y, T(&v)[2]) const {
+			if (floorMode == FLOOR_STRICT) { devalKernel<StrictFloor>(x, y, v); }
+			else { devalKernel<FastFloor>(x, y, v); }
+		}
 
-			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+		template <typename Floor, typename T>
+		void devalFloor(Floor, T x, T y, T(&v)[2]) const {
+			devalKernel<Floor>(x, y, v);
+		}
+
+		// The four lattice points eval sums over at (x, y), chosen the same way:
+		// (1,0), (0,1), then (0,0) or (1,1) and the extra vertex, with the
+		// position of (x, y) relative to each.
+		template <typename Floor, typename T>
+		void latticePoints(T x, T y, inttype (&xsv)[4], inttype (&ysv)[4], T (&dx)[4], T (&dy)[4]) const {
 
 			static const T STRETCH_CONSTANT = (T) ((1.0 / std::sqrt(2.0 + 1.0) - 1.0) * 0.5);
 			static const T SQUISH_CONSTANT = (T) ((std::sqrt(2.0 + 1.0) - 1.0) * 0.5);
-			static const T NORM_CONSTANT = (T) (1.0 / 47.0);
 
-			inttype xsb, ysb, xsv_ext, ysv_ext;
-			T dx0, dy0, dx_ext, dy_ext;
+			inttype xsb, ysb;
+			T dx0, dy0;
 			T xins, yins;
 
-			// Parameters for the four contributions
-			T contr_m[4], contr_ext[4];
-
 			{
 				// Place input coordinates on a grid.
 				T stretchOffset = (x + y) * STRETCH_CONSTANT;
@@ -158,313 +775,418 @@ namespace OSN {
 				T ys = y + stretchOffset;
 
 				// Floor to get grid coordinates of rhombus super-cell origin.
-#ifdef __FAST_MATH__
-				T xsbd = std::floor(xs);
-				T ysbd = std::floor(ys);
-				xsb = (inttype)xsbd;
-				ysb = (inttype)ysbd;
-#else
-				xsb = fastFloori(xs);
-				ysb = fastFloori(ys);
-				T xsbd = (T) xsb;
-				T ysbd = (T) ysb;
-#endif
+				T xsbd = Floor::floor(xs, xsb);
+				T ysbd = Floor::floor(ys, ysb);
 
 				// Skew out to get actual coordinates of rhombohedron origin.
 				T squishOffset = (xsbd + ysbd) * SQUISH_CONSTANT;
-				T xb = xsbd + squishOffset;
-				T yb = ysbd + squishOffset;
-
-				// Positions relative to origin point.
-				dx0 = x - xb;
-				dy0 = y - yb;
+				dx0 = x - (xsbd + squishOffset);
+				dy0 = y - (ysbd + squishOffset);
 
 				// Compute grid coordinates relative to rhomboidal origin.
 				xins = xs - xsbd;
 				yins = ys - ysbd;
 			}
 
-			// Contribution (1,0).
-	{
-		T dx1 = dx0 - (T)1.0 - SQUISH_CONSTANT;
-		T dy1 = dy0 - SQUISH_CONSTANT;
-		contr_m[0] = pow2(dx1) + pow2(dy1);
-		contr_ext[0] = extrapolate(xsb + 1, ysb, dx1, dy1);
-	}
-
-	// Contribution (0,1).
-	{
-		T dx2 = dx0 - SQUISH_CONSTANT;
-		T dy2 = dy0 - (T)1.0 - SQUISH_CONSTANT;
-		contr_m[1] = pow2(dx2) + pow2(dy2);
-		contr_ext[1] = extrapolate(xsb, ysb + 1, dx2, dy2);
-	}
-
-	if ((xins + yins) <= (T)1.0) {
-		// Inside the triangle (2-Simplex) at (0,0).
-		T zins = (T)1.0 - (xins + yins);
-		if (zins > xins || zins > yins) {
-			// (0,0) is one of the closest two triangular vertices.
-			if (xins > yins) {
-				xsv_ext = xsb + 1;
-				ysv_ext = ysb - 1;
-				dx_ext = dx0 - (T)1.0;
-				dy_ext = dy0 + (T)1.0;
+			xsv[0] = xsb + 1;
+			ysv[0] = ysb;
+			dx[0] = dx0 - (T)1.0 - SQUISH_CONSTANT;
+			dy[0] = dy0 - SQUISH_CONSTANT;
+
+			xsv[1] = xsb;
+			ysv[1] = ysb + 1;
+			dx[1] = dx0 - SQUISH_CONSTANT;
+			dy[1] = dy0 - (T)1.0 - SQUISH_CONSTANT;
+
+			if ((xins + yins) <= (T)1.0) {
+				// Inside the triangle (2-Simplex) at (0,0).
+				T zins = (T)1.0 - (xins + yins);
+				if (zins > xins || zins > yins) {
+					// (0,0) is one of the closest two triangular vertices.
+					if (xins > yins) {
+						xsv[3] = xsb + 1;
+						ysv[3] = ysb - 1;
+						dx[3] = dx0 - (T)1.0;
+						dy[3] = dy0 + (T)1.0;
+					}
+					else {
+						xsv[3] = xsb - 1;
+						ysv[3] = ysb + 1;
+						dx[3] = dx0 + (T)1.0;
+						dy[3] = dy0 - (T)1.0;
+					}
+				}
+				else {
+					// (1,0) and (0,1) are the closest two vertices.
+					xsv[3] = xsb + 1;
+					ysv[3] = ysb + 1;
+					dx[3] = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
+					dy[3] = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
+				}
+				xsv[2] = xsb;
+				ysv[2] = ysb;
+				dx[2] = dx0;
+				dy[2] = dy0;
 			}
 			else {
-				xsv_ext = xsb - 1;
-				ysv_ext = ysb + 1;
-				dx_ext = dx0 + (T)1.0;
-				dy_ext = dy0 - (T)1.0;
+				// Inside the triangle (2-Simplex) at (1,1).
+				T zins = (T)2.0 - (xins + yins);
+				if (zins < xins || zins < yins) {
+					// (0,0) is one of the closest two triangular vertices.
+					if (xins > yins) {
+						xsv[3] = xsb + 2;
+						ysv[3] = ysb;
+						dx[3] = dx0 - (T)2.0 - (SQUISH_CONSTANT * (T)2.0);
+						dy[3] = dy0 - (SQUISH_CONSTANT * (T)2.0);
+					}
+					else {
+						xsv[3] = xsb;
+						ysv[3] = ysb + 2;
+						dx[3] = dx0 - (SQUISH_CONSTANT * (T)2.0);
+						dy[3] = dy0 - (T)2.0 - (SQUISH_CONSTANT * (T)2.0);
+					}
+				}
+				else {
+					// (1,0) and (0,1) are the closest two vertices.
+					xsv[3] = xsb;
+					ysv[3] = ysb;
+					dx[3] = dx0;
+					dy[3] = dy0;
+				}
+				xsv[2] = xsb + 1;
+				ysv[2] = ysb + 1;
+				dx[2] = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
+				dy[2] = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
 			}
 		}
-		else {
-			// (1,0) and (0,1) are the closest two vertices.
-			xsv_ext = xsb + 1;
-			ysv_ext = ysb + 1;
-			dx_ext = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
-			dy_ext = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
-		}
-	}
-	else {
-		// Inside the triangle (2-Simplex) at (1,1).
-		T zins = (T)2.0 - (xins + yins);
-		if (zins < xins || zins < yins) {
-			// (0,0) is one of the closest two triangular vertices.
-			if (xins > yins) {
-				xsv_ext = xsb + 2;
-				ysv_ext = ysb;
-				dx_ext = dx0 - (T)2.0 - (SQUISH_CONSTANT * (T)2.0);
-				dy_ext = dy0 - (SQUISH_CONSTANT * (T)2.0);
+
+		// Sums the contributions of the lattice points and their derivatives
+		// into out, a ValueGradient or Derivatives.
+		template <typename Floor, typename T, typename Out>
+		void derivativesKernel(T x, T y, Out & out) const {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(DERIVATIVES_2D_SAMPLES, 1);
+
+			static const T NORM_CONSTANT = (T) (1.0 / 47.0);
+
+			inttype xsv[4], ysv[4];
+			T dx[4], dy[4];
+			latticePoints<Floor>(x, y, xsv, ysv, dx, dy);
+
+			// The value is summed as eval sums it, which rounds differently
+			// from addDerivatives.
+			Base::clearDerivatives(out);
+			T value = 0.0;
+			for (int i = 0; i < 4; ++i) {
+				T g[2];
+				const T d[2] = { dx[i], dy[i] };
+				extrapolate(xsv[i], ysv[i], dx[i], dy[i], g);
+				Base::addDerivatives(g, d, out);
+				value += contribution(xsv[i], ysv[i], dx[i], dy[i]);
 			}
-			else {
-				xsv_ext = xsb;
-				ysv_ext = ysb + 2;
-				dx_ext = dx0 - (SQUISH_CONSTANT * (T)2.0);
-				dy_ext = dy0 - (T)2.0 - (SQUISH_CONSTANT * (T)2.0);
+			Base::scaleDerivatives(out, NORM_CONSTANT);
+			out.value = value * NORM_CONSTANT;
+		}
+
+		template <typename Floor, typename T>
+		static void channelsKernel(const Noise * const * generators, size_t channels, const T * x, const T * y, T * const * out, size_t count) {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_2D_SAMPLES, (int64_t) (count * channels));
+
+			static const T NORM_CONSTANT = (T) (1.0 / 47.0);
+
+			for (size_t i = 0; i < count; ++i) {
+				inttype xsv[4], ysv[4];
+				T dx[4], dy[4];
+				generators[0]->template latticePoints<Floor>(x[i], y[i], xsv, ysv, dx, dy);
+				T attn[4];
+				for (int k = 0; k < 4; ++k) {
+					attn[k] = pow4(inline_fast_max((T)2.0 - (pow2(dx[k]) + pow2(dy[k])), (T)0.0));
+				}
+				for (size_t c = 0; c < channels; ++c) {
+					T value = 0.0;
+					for (int k = 0; k < 4; ++k) {
+						value += attn[k] * generators[c]->extrapolate(xsv[k], ysv[k], dx[k], dy[k]);
+					}
+					out[c][i] = value * NORM_CONSTANT;
+				}
 			}
 		}
-		else {
-			// (1,0) and (0,1) are the closest two vertices.
-			xsv_ext = xsb;
-			ysv_ext = ysb;
-			dx_ext = dx0;
-			dy_ext = dy0;
-		}
-		xsb += 1;
-		ysb += 1;
-		dx0 = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
-		dy0 = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
-	}
 
-	// Contribution (0,0) or (1,1).
-	{
-		contr_m[2] = pow2(dx0) + pow2(dy0);
-		contr_ext[2] = extrapolate(xsb, ysb, dx0, dy0);
-	}
+		template <typename T>
+		static void channelsFloor(RuntimeFloor, const Noise * const * generators, size_t channels, const T * x, const T * y, T * const * out, size_t count) {
+			if (generators[0]->floorMode == FLOOR_STRICT) { channelsKernel<StrictFloor>(generators, channels, x, y, out, count); }
+			else { channelsKernel<FastFloor>(generators, channels, x, y, out, count); }
+		}
 
-	// Extra vertex.
-	{
-		contr_m[3] = pow2(dx_ext) + pow2(dy_ext);
-		contr_ext[3] = extrapolate(xsv_ext, ysv_ext, dx_ext, dy_ext);
-	}
+		template <typename Floor, typename T>
+		static void channelsFloor(Floor, const Noise * const * generators, size_t channels, const T * x, const T * y, T * const * out, size_t count) {
+			channelsKernel<Floor>(generators, channels, x, y, out, count);
+		}
 
-	T value = 0.0;
-	for (int i = 0; i < 4; ++i) {
-		value += pow4(inline_fast_max((T)2.0 - contr_m[i], (T)0.0)) * contr_ext[i];
-	}
+		// Dispatch evalGradient and hessian to the kernel for Policy::Floor.
+		template <typename T, typename Out>
+		void derivativesFloor(RuntimeFloor, T x, T y, Out & out) const {
+			if (floorMode == FLOOR_STRICT) { derivativesKernel<StrictFloor>(x, y, out); }
+			else { derivativesKernel<FastFloor>(x, y, out); }
+		}
 
-	return (value * NORM_CONSTANT);
+		template <typename Floor, typename T, typename Out>
+		void derivativesFloor(Floor, T x, T y, Out & out) const {
+			derivativesKernel<Floor>(x, y, out);
 		}
 
+	public:
+
+		Noise(int64_t seed = 0LL) : Base(seed) {}
+		Noise(const int * p) : Base(p) {}
+
+
 		template <typename T>
-		void deval(T x, T y, T(&v)[2]) const {
+		T eval(T x, T y) const {
+			return evalFloor(typename Policy::Floor(), x, y);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(T x, T y) const {
 
 			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_2D_SAMPLES, 1);
 
-			static const T STRETCH_CONSTANT = (T) ((1.0 / std::sqrt(2.0 + 1.0) - 1.0) * 0.5);
-			static const T SQUISH_CONSTANT = (T) ((std::sqrt(2.0 + 1.0) - 1.0) * 0.5);
 			static const T NORM_CONSTANT = (T) (1.0 / 47.0);
 
-			inttype xsb, ysb, xsv_ext, ysv_ext;
-			T dx0, dy0, dx_ext, dy_ext;
-			T xins, yins;
+			inttype xsv[4], ysv[4];
+			T dx[4], dy[4];
+			latticePoints<Floor>(x, y, xsv, ysv, dx, dy);
 
-			{
-				// Place input coordinates on a grid.
-				T stretchOffset = (x + y) * STRETCH_CONSTANT;
-				T xs = x + stretchOffset;
-				T ys = y + stretchOffset;
+			T value = 0.0;
+			for (int i = 0; i < 4; ++i) {
+				value += contribution(xsv[i], ysv[i], dx[i], dy[i]);
+			}
 
-				// Floor to get grid coordinates of rhombus super-cell origin.
-#ifdef __FAST_MATH__
-				T xsbd = std::floor(xs);
-				T ysbd = std::floor(ys);
-				xsb = (inttype)xsbd;
-				ysb = (inttype)ysbd;
-#else
-				xsb = fastFloori(xs);
-				ysb = fastFloori(ys);
-				T xsbd = (T) xsb;
-				T ysbd = (T) ysb;
-#endif
+			return (value * NORM_CONSTANT);
+		}
 
-				// Skew out to get actual coordinates of rhombohedron origin.
-				T squishOffset = (xsbd + ysbd) * SQUISH_CONSTANT;
-				T xb = xsbd + squishOffset;
-				T yb = ysbd + squishOffset;
+		template <typename T>
+		void deval(T x, T y, T(&v)[2]) const {
+			devalFloor(typename Policy::Floor(), x, y, v);
+		}
 
-				// Positions relative to origin point.
-				dx0 = x - xb;
-				dy0 = y - yb;
+		// As deval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		void devalKernel(T x, T y, T(&v)[2]) const {
 
-				// Compute grid coordinates relative to rhomboidal origin.
-				xins = xs - xsbd;
-				yins = ys - ysbd;
-			}
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(DEVAL_2D_SAMPLES, 1);
 
-			T dv[2] = { 0.0, 0.0 };
+			static const T NORM_CONSTANT = (T) (1.0 / 47.0);
 
-			// Contribution (1,0).
-			{
-				T dx1 = dx0 - (T)1.0 - SQUISH_CONSTANT;
-				T dy1 = dy0 - SQUISH_CONSTANT;
-				T attn1 = inline_fast_max((T)2.0 - ((dx1 * dx1) + (dy1 * dy1)), (T)0.0);
+			inttype xsv[4], ysv[4];
+			T dx[4], dy[4];
+			latticePoints<Floor>(x, y, xsv, ysv, dx, dy);
+
+			T dv[2] = { 0.0, 0.0 };
+			for (int i = 0; i < 4; ++i) {
+				T attn = inline_fast_max((T)2.0 - ((dx[i] * dx[i]) + (dy[i] * dy[i])), (T)0.0);
 				T de[2];
-				T ext = extrapolate(xsb + 1, ysb, dx1, dy1, de);
-				dv[0] += pow2(attn1) * (pow2(attn1) * de[0] - ((T)8.0)*attn1*dx1*ext);
-				dv[1] += pow2(attn1) * (pow2(attn1) * de[1] - ((T)8.0)*attn1*dy1*ext);
+				T ext = extrapolate(xsv[i], ysv[i], dx[i], dy[i], de);
+				dv[0] += pow2(attn) * (pow2(attn) * de[0] - ((T)8.0)*attn*dx[i]*ext);
+				dv[1] += pow2(attn) * (pow2(attn) * de[1] - ((T)8.0)*attn*dy[i]*ext);
 			}
 
-			// Contribution (0,1).
-	{
-		T dx2 = dx0 - SQUISH_CONSTANT;
-		T dy2 = dy0 - (T)1.0 - SQUISH_CONSTANT;
-		T attn2 = inline_fast_max((T)2.0 - ((dx2 * dx2) + (dy2 * dy2)), (T)0.0);
-		T de[2];
-		T ext = extrapolate(xsb, ysb + 1, dx2, dy2, de);
-		dv[0] += pow2(attn2) * (pow2(attn2) * de[0] - ((T)8.0)*attn2*dx2*ext);
-		dv[1] += pow2(attn2) * (pow2(attn2) * de[1] - ((T)8.0)*attn2*dy2*ext);
-	}
+			v[0] = dv[0] * NORM_CONSTANT;
+			v[1] = dv[1] * NORM_CONSTANT;
+		}
 
-	if ((xins + yins) <= (T)1.0) {
-		// Inside the triangle (2-Simplex) at (0,0).
-		T zins = (T)1.0 - (xins + yins);
-		if (zins > xins || zins > yins) {
-			// (0,0) is one of the closest two triangular vertices.
-			if (xins > yins) {
-				xsv_ext = xsb + 1;
-				ysv_ext = ysb - 1;
-				dx_ext = dx0 - (T)1.0;
-				dy_ext = dy0 + (T)1.0;
-			}
-			else {
-				xsv_ext = xsb - 1;
-				ysv_ext = ysb + 1;
-				dx_ext = dx0 + (T)1.0;
-				dy_ext = dy0 - (T)1.0;
-			}
+		// Value and gradient at (x, y) in one pass over the lattice points,
+		// where eval and deval would walk them twice.
+		template <typename T>
+		void evalGradient(T x, T y, ValueGradient<T, 2> & out) const {
+			derivativesFloor(typename Policy::Floor(), x, y, out);
 		}
-		else {
-			// (1,0) and (0,1) are the closest two vertices.
-			xsv_ext = xsb + 1;
-			ysv_ext = ysb + 1;
-			dx_ext = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
-			dy_ext = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
+
+		// As evalGradient, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		void evalGradientKernel(T x, T y, ValueGradient<T, 2> & out) const {
+			derivativesKernel<Floor>(x, y, out);
 		}
-	}
-	else {
-		// Inside the triangle (2-Simplex) at (1,1).
-		T zins = (T)2.0 - (xins + yins);
-		if (zins < xins || zins < yins) {
-			// (0,0) is one of the closest two triangular vertices.
-			if (xins > yins) {
-				xsv_ext = xsb + 2;
-				ysv_ext = ysb;
-				dx_ext = dx0 - (T)2.0 - (SQUISH_CONSTANT * (T)2.0);
-				dy_ext = dy0 - (SQUISH_CONSTANT * (T)2.0);
-			}
-			else {
-				xsv_ext = xsb;
-				ysv_ext = ysb + 2;
-				dx_ext = dx0 - (SQUISH_CONSTANT * (T)2.0);
-				dy_ext = dy0 - (T)2.0 - (SQUISH_CONSTANT * (T)2.0);
-			}
+
+		// Value, gradient and Hessian at (x, y) in one pass over the lattice
+		// points, for curvature without a stencil of eval calls.
+		template <typename T>
+		void hessian(T x, T y, Derivatives<T, 2> & out) const {
+			derivativesFloor(typename Policy::Floor(), x, y, out);
 		}
-		else {
-			// (1,0) and (0,1) are the closest two vertices.
-			xsv_ext = xsb;
-			ysv_ext = ysb;
-			dx_ext = dx0;
-			dy_ext = dy0;
-		}
-		xsb += 1;
-		ysb += 1;
-		dx0 = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
-		dy0 = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
-	}
 
-	// Contribution (0,0) or (1,1).
-	{
-		T attn = inline_fast_max((T)2.0 - ((dx0 * dx0) + (dy0 * dy0)), (T)0.0);
-		T de[2];
-		T ext = extrapolate(xsb, ysb, dx0, dy0, de);
-		dv[0] += pow2(attn) * (pow2(attn) * de[0] - ((T)8.0)*attn*dx0*ext);
-		dv[1] += pow2(attn) * (pow2(attn) * de[1] - ((T)8.0)*attn*dy0*ext);
-	}
+		// As hessian, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		void hessianKernel(T x, T y, Derivatives<T, 2> & out) const {
+			derivativesKernel<Floor>(x, y, out);
+		}
 
-	// Extra vertex.
-	{
-		T attn = inline_fast_max((T)2.0 - ((dx_ext * dx_ext) + (dy_ext * dy_ext)), (T)0.0);
-		T de[2];
-		T ext = extrapolate(xsv_ext, ysv_ext, dx_ext, dy_ext, de);
-		dv[0] += pow2(attn) * (pow2(attn) * de[0] - ((T)8.0)*attn*dx_ext*ext);
-		dv[1] += pow2(attn) * (pow2(attn) * de[1] - ((T)8.0)*attn*dy_ext*ext);
-	}
+		// Evaluates count points whose coordinates are given in separate arrays.
+		// Defined in OpenSimplexNoise.cpp, where it is built for several instruction
+		// set levels with the best one selected when the program is loaded.
+		void evalBatch(const double * x, const double * y, double * out, size_t count) const;
+		void evalBatch(const float * x, const float * y, float * out, size_t count) const;
 
-	v[0] = dv[0] * NORM_CONSTANT;
-	v[1] = dv[1] * NORM_CONSTANT;
+		// Evaluates count points with each of channels generators, writing
+		// generator c's values to out[c]. The lattice walk depends only on the
+		// point, so it is done once and only the gradient lookups are repeated
+		// per generator. Uses the first generator's floor mode.
+		template <typename T>
+		static void evalChannels(const Noise * const * generators, size_t channels, const T * x, const T * y, T * const * out, size_t count) {
+			if (channels == 0) { return; }
+			channelsFloor(typename Policy::Floor(), generators, channels, x, y, out, count);
 		}
 
+		// As evalGradient and hessian, for count points. See evalBatch.
+		void evalGradientBatch(const double * x, const double * y, ValueGradient<double, 2> * out, size_t count) const;
+		void evalGradientBatch(const float * x, const float * y, ValueGradient<float, 2> * out, size_t count) const;
+		void hessianBatch(const double * x, const double * y, Derivatives<double, 2> * out, size_t count) const;
+		void hessianBatch(const float * x, const float * y, Derivatives<float, 2> * out, size_t count) const;
+
 	};
 
 
 
 	// 3D Implementation of the OpenSimplexNoise generator.
-	template <>
-	class Noise <3> : public NoiseBase{
+	template <typename Policy>
+	class Noise <3, Policy> : public NoiseBase<Policy> {
 	private:
 
+		typedef NoiseBase<Policy> Base;
+		typedef typename Policy::Index inttype;
+		typedef typename Policy::Gradient GradientType;
+		typedef typename Base::PermType PermType;
+		using Base::perm;
+		using Base::floorMode;
+		using Base::LCG_STEP;
+
 		// Array of gradient values for 3D. Values are defined below the class definition.
-		static const int gradients[72];
+		static const GradientType gradients[72];
 
 		// Because 72 is not a power of two, extrapolate cannot use a bitmask to index
 		// into the perm array. Pre-calculate and store the indices instead.
-		int permGradIndex[256];
+		PermType permGradIndex[256];
 
-		template <typename T>
-		inline T extrapolate(inttype xsb, inttype ysb, inttype zsb, T dx, T dy, T dz) const {
+		template <typename Lattice, typename T>
+		inline T extrapolate(const Lattice & lattice, inttype xsb, inttype ysb, inttype zsb, T dx, T dy, T dz) const {
+			lattice.wrap(xsb, ysb, zsb);
 			unsigned int index = permGradIndex[(perm[(perm[xsb & 0xFF] + ysb) & 0xFF] + zsb) & 0xFF];
 			return gradients[index] * dx +
 				gradients[index + 1] * dy +
 				gradients[index + 2] * dz;
 		}
 
-		template <typename T>
-		inline T extrapolate(inttype xsb, inttype ysb, inttype zsb, T dx, T dy, T dz, T(&de)[3]) const {
+		template <typename Lattice, typename T>
+		inline T extrapolate(const Lattice & lattice, inttype xsb, inttype ysb, inttype zsb, T dx, T dy, T dz, T(&de)[3]) const {
+			lattice.wrap(xsb, ysb, zsb);
 			unsigned int index = permGradIndex[(perm[(perm[xsb & 0xFF] + ysb) & 0xFF] + zsb) & 0xFF];
 			return (de[0] = gradients[index]) * dx +
 				(de[1] = gradients[index + 1]) * dy +
 				(de[2] = gradients[index + 2]) * dz;
 		}
 
+		// Dispatch eval to the kernel for Policy::Floor.
+		template <typename T>
+		T evalFloor(RuntimeFloor, T x, T y, T z) const {
+			return (floorMode == FLOOR_STRICT) ? evalKernel<StrictFloor>(x, y, z) : evalKernel<FastFloor>(x, y, z);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T x, T y, T z) const {
+			return evalKernel<Floor>(x, y, z);
+		}
+
+		// Sums the derivatives of the kernel's contributions into out, a
+		// ValueGradient or Derivatives.
+		//
+		// The 3D kernel has too many cases to repeat, so this runs it once to
+		// find its lattice points and then differentiates their contributions.
+		// The kernel leaves out a few points whose contributions are below
+		// 1e-4, so eval steps slightly where its choice changes; away from those
+		// steps these are its exact derivatives. The value comes from
+		// evalLattice, so each sample also counts as an eval sample.
+		template <typename Floor, typename T, typename Out>
+		void derivativesKernel(T x, T y, T z, Out & out) const {
+			OSN_METRICS_ADD(DERIVATIVES_3D_SAMPLES, 1);
+
+			static const T SQUISH_CONSTANT = (T) (1.0 / 3.0);
+			static const T NORM_CONSTANT = (T) (1.0 / 103.0);
+
+			RecordingLattice recorder;
+			recorder.count = 0;
+			T value = evalLattice<Floor>(x, y, z, recorder);
+
+			Base::clearDerivatives(out);
+			for (int k = 0; k < recorder.count; ++k) {
+				const inttype * p = recorder.points[k];
+				T squishOffset = (T) (p[0] + p[1] + p[2]) * SQUISH_CONSTANT;
+				const T d[3] = {
+					x - ((T) p[0] + squishOffset),
+					y - ((T) p[1] + squishOffset),
+					z - ((T) p[2] + squishOffset)
+				};
+				const GradientType * gradient = gradientAt(gradientIndex(p[0], p[1], p[2]));
+				const T g[3] = { (T) gradient[0], (T) gradient[1], (T) gradient[2] };
+				Base::addDerivatives(g, d, out);
+			}
+			Base::scaleDerivatives(out, NORM_CONSTANT);
+			// The kernel's own sum, so that value matches eval exactly.
+			out.value = value;
+		}
+
+		template <typename Floor, typename T>
+		static void channelsKernel(const Noise * const * generators, size_t channels, const T * x, const T * y, const T * z, T * const * out, size_t count) {
+			// Channels beyond what a lattice can sum take another walk.
+			for (size_t first = 0; first < channels; first += ChannelLattice<T>::MAX_CHANNELS) {
+				ChannelLattice<T> lattice;
+				lattice.generators = generators + first;
+				lattice.channels = channels - first;
+				if (lattice.channels > ChannelLattice<T>::MAX_CHANNELS) { lattice.channels = ChannelLattice<T>::MAX_CHANNELS; }
+				OSN_METRICS_ADD(EVAL_3D_SAMPLES, (int64_t) (count * (lattice.channels - 1)));
+				for (size_t i = 0; i < count; ++i) {
+					for (size_t c = 1; c < lattice.channels; ++c) { lattice.sums[c] = (T)0.0; }
+					out[first][i] = lattice.generators[0]->template evalLattice<Floor>(x[i], y[i], z[i], lattice);
+					for (size_t c = 1; c < lattice.channels; ++c) { out[first + c][i] = lattice.sums[c] * (T) (1.0 / 103.0); }
+				}
+			}
+		}
+
+		template <typename T>
+		static void channelsFloor(RuntimeFloor, const Noise * const * generators, size_t channels, const T * x, const T * y, const T * z, T * const * out, size_t count) {
+			if (generators[0]->floorMode == FLOOR_STRICT) { channelsKernel<StrictFloor>(generators, channels, x, y, z, out, count); }
+			else { channelsKernel<FastFloor>(generators, channels, x, y, z, out, count); }
+		}
+
+		template <typename Floor, typename T>
+		static void channelsFloor(Floor, const Noise * const * generators, size_t channels, const T * x, const T * y, const T * z, T * const * out, size_t count) {
+			channelsKernel<Floor>(generators, channels, x, y, z, out, count);
+		}
+
+		// Dispatch evalGradient and hessian to the kernel for Policy::Floor.
+		template <typename T, typename Out>
+		void derivativesFloor(RuntimeFloor, T x, T y, T z, Out & out) const {
+			if (floorMode == FLOOR_STRICT) { derivativesKernel<StrictFloor>(x, y, z, out); }
+			else { derivativesKernel<FastFloor>(x, y, z, out); }
+		}
+
+		template <typename Floor, typename T, typename Out>
+		void derivativesFloor(Floor, T x, T y, T z, Out & out) const {
+			derivativesKernel<Floor>(x, y, z, out);
+		}
+
 	public:
 
 		// Initializes the class using a permutation array generated from a 64-bit seed.
 		// Generates a proper permutation (i.e. doesn't merely perform N successive
 		// pair swaps on a base array).
 		// Uses a simple 64-bit LCG.
-		Noise(int64_t seed = 0LL) : NoiseBase() {
+		Noise(int64_t seed = 0LL) : Base() {
 			int source[256];
 			for (int i = 0; i < 256; ++i) { source[i] = i; }
 			LCG_STEP(seed);
@@ -472,27 +1194,150 @@ namespace OSN {
 			LCG_STEP(seed);
 			for (int i = 255; i >= 0; --i) {
 				LCG_STEP(seed);
-				int r = (int) ((seed + 31) % (i + 1));
+				int r = (int) ((int64_t) ((uint64_t) seed + 31) % (i + 1));
 				if (r < 0) { r += (i + 1); }
-				perm[i] = source[r];
-				permGradIndex[i] = (int) ((perm[i] % (72 / 3)) * 3);
+				perm[i] = (PermType) source[r];
+				permGradIndex[i] = (PermType) ((perm[i] % (72 / 3)) * 3);
 				source[r] = source[i];
 			}
 		}
 
-		Noise(const int * p) : NoiseBase() {
+		Noise(const int * p) : Base() {
 			// Copy the supplied permutation array into this instance.
 			for (int i = 0; i < 256; ++i) {
-				perm[i] = p[i];
-				permGradIndex[i] = (int) ((perm[i] % (72 / 3)) * 3);
+				perm[i] = (PermType) p[i];
+				permGradIndex[i] = (PermType) ((perm[i] % (72 / 3)) * 3);
 			}
 		}
 
 
 		template <typename T>
 		T eval(T x, T y, T z) const {
+			return evalFloor(typename Policy::Floor(), x, y, z);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(T x, T y, T z) const {
+			return evalLattice<Floor>(x, y, z, FreeLattice());
+		}
+
+		// Value and gradient at (x, y, z). See Noise<2>::evalGradient.
+		template <typename T>
+		void evalGradient(T x, T y, T z, ValueGradient<T, 3> & out) const {
+			derivativesFloor(typename Policy::Floor(), x, y, z, out);
+		}
+
+		// As evalGradient, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		void evalGradientKernel(T x, T y, T z, ValueGradient<T, 3> & out) const {
+			derivativesKernel<Floor>(x, y, z, out);
+		}
+
+		// Value, gradient and Hessian at (x, y, z). See Noise<2>::hessian.
+		template <typename T>
+		void hessian(T x, T y, T z, Derivatives<T, 3> & out) const {
+			derivativesFloor(typename Policy::Floor(), x, y, z, out);
+		}
+
+		// As hessian, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		void hessianKernel(T x, T y, T z, Derivatives<T, 3> & out) const {
+			derivativesKernel<Floor>(x, y, z, out);
+		}
+
+		// Evaluates count points whose coordinates are given in separate arrays.
+		// See Noise<2>::evalBatch.
+		//
+		// For animated 2D noise, pass time as z and evaluate every frame. A
+		// per-pixel cache of lattice data kept across frames, with only the
+		// time terms recomputed, was measured slower than this: 71 against
+		// 63 ns a sample at a time step of 0.02, with 18% of points changing
+		// cell per frame. Reading and writing the cache costs about as much as
+		// the kernel it skips, so none is provided.
+		void evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const;
+		void evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const;
+
+		// Evaluates count points with each of channels generators. See
+		// Noise<2>::evalChannels. The first generator runs the kernel, and the
+		// others add their contributions as it visits each lattice point, so
+		// they match their own eval up to rounding.
+		template <typename T>
+		static void evalChannels(const Noise * const * generators, size_t channels, const T * x, const T * y, const T * z, T * const * out, size_t count) {
+			if (channels == 0) { return; }
+			channelsFloor(typename Policy::Floor(), generators, channels, x, y, z, out, count);
+		}
+
+		// As evalGradient and hessian, for count points. See Noise<2>::evalBatch.
+		void evalGradientBatch(const double * x, const double * y, const double * z, ValueGradient<double, 3> * out, size_t count) const;
+		void evalGradientBatch(const float * x, const float * y, const float * z, ValueGradient<float, 3> * out, size_t count) const;
+		void hessianBatch(const double * x, const double * y, const double * z, Derivatives<double, 3> * out, size_t count) const;
+		void hessianBatch(const float * x, const float * y, const float * z, Derivatives<float, 3> * out, size_t count) const;
+
+	protected:
+
+		// Chooses which lattice point's gradient each lattice point uses:
+		// wrapBase is applied to the base of the cell being evaluated, and wrap
+		// to every vertex hashed from it. Every point uses its own gradient here;
+		// see LoopingNoise for a lattice that repeats.
+		struct FreeLattice {
+			inline void wrapBase(inttype &, inttype &, inttype &) const {}
+			inline void wrap(inttype &, inttype &, inttype &) const {}
+		};
+
+		// Where the gradient of a lattice point starts in the gradient table,
+		// and the three components of the gradient starting there.
+		inline unsigned int gradientIndex(inttype xsb, inttype ysb, inttype zsb) const {
+			return permGradIndex[(perm[(perm[xsb & 0xFF] + ysb) & 0xFF] + zsb) & 0xFF];
+		}
+
+		static inline const GradientType * gradientAt(unsigned int index) {
+			return &gradients[index];
+		}
+
+		// Records the lattice points the kernel hashes, in order. They are
+		// distinct, and include every point that contributes.
+		struct RecordingLattice {
+			mutable inttype points[9][3];
+			mutable int count;
+			inline void wrapBase(inttype &, inttype &, inttype &) const {}
+			inline void wrap(inttype & xsb, inttype & ysb, inttype & zsb) const {
+				points[count][0] = xsb;
+				points[count][1] = ysb;
+				points[count][2] = zsb;
+				++count;
+			}
+		};
+
+		// Sums the unscaled contributions of generators 1 to channels - 1 into
+		// sums as the kernel visits each lattice point, for evalChannels. See
+		// the extrapolate overload that takes it.
+		template <typename T>
+		struct ChannelLattice {
+			static const size_t MAX_CHANNELS = 8;
+			const Noise * const * generators;
+			size_t channels;
+			mutable T sums[MAX_CHANNELS];
+			inline void wrapBase(inttype &, inttype &, inttype &) const {}
+			inline void wrap(inttype &, inttype &, inttype &) const {}
+		};
+
+		template <typename T>
+		inline T extrapolate(const ChannelLattice<T> & lattice, inttype xsb, inttype ysb, inttype zsb, T dx, T dy, T dz) const {
+			T attn = pow4(inline_fast_max((T)2.0 - (pow2(dx) + pow2(dy) + pow2(dz)), (T)0.0));
+			for (size_t c = 1; c < lattice.channels; ++c) {
+				const GradientType * g = gradientAt(lattice.generators[c]->gradientIndex(xsb, ysb, zsb));
+				lattice.sums[c] += attn * (g[0] * dx + g[1] * dy + g[2] * dz);
+			}
+			return extrapolate(FreeLattice(), xsb, ysb, zsb, dx, dy, dz);
+		}
+
+		// As evalKernel, with gradients assigned through the given lattice.
+		template <typename Floor, typename Lattice, typename T>
+		T evalLattice(T x, T y, T z, const Lattice & lattice) const {
 
 			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_3D_SAMPLES, 1);
 
 			static const T STRETCH_CONSTANT = (T) (-1.0 / 6.0); // (1 / sqrt(3 + 1) - 1) / 3
 			static const T SQUISH_CONSTANT = (T) (1.0 / 3.0);  // (sqrt(3 + 1) - 1) / 3
@@ -514,21 +1359,10 @@ namespace OSN {
 
 				// Floor to get simplectic lattice coordinates of rhombohedron
 				// (stretched cube) super-cell.
-#ifdef __FAST_MATH__
-				T xsbd = std::floor(xs);
-				T ysbd = std::floor(ys);
-				T zsbd = std::floor(zs);
-				xsb = (inttype)xsbd;
-				ysb = (inttype)ysbd;
-				zsb = (inttype)zsbd;
-#else
-				xsb = fastFloori(xs);
-				ysb = fastFloori(ys);
-				zsb = fastFloori(zs);
-				T xsbd = (T) xsb;
-				T ysbd = (T) ysb;
-				T zsbd = (T) zsb;
-#endif
+				T xsbd = Floor::floor(xs, xsb);
+				T ysbd = Floor::floor(ys, ysb);
+				T zsbd = Floor::floor(zs, zsb);
+				lattice.wrapBase(xsb, ysb, zsb);
 
 				// Skew out to get actual coordinates of rhombohedron origin.
 				T squishOffset = (xsbd + ysbd + zsbd) * SQUISH_CONSTANT;
@@ -775,42 +1609,42 @@ namespace OSN {
 				T dy1 = dy0 - SQUISH_CONSTANT;
 				T dz1 = dz0 - SQUISH_CONSTANT;
 				contr_m[1] = pow2(dx1) + pow2(dy1) + pow2(dz1);
-				contr_ext[1] = extrapolate(xsb + 1, ysb, zsb, dx1, dy1, dz1);
+				contr_ext[1] = extrapolate(lattice, xsb + 1, ysb, zsb, dx1, dy1, dz1);
 
 				// Contribution (0,1,0).
 				T dx2 = dx0 - SQUISH_CONSTANT;
 				T dy2 = dy0 - (T)1.0 - SQUISH_CONSTANT;
 				T dz2 = dz1;
 				contr_m[2] = pow2(dx2) + pow2(dy2) + pow2(dz2);
-				contr_ext[2] = extrapolate(xsb, ysb + 1, zsb, dx2, dy2, dz2);
+				contr_ext[2] = extrapolate(lattice, xsb, ysb + 1, zsb, dx2, dy2, dz2);
 
 				// Contribution (1,0,0).
 				T dx3 = dx2;
 				T dy3 = dy1;
 				T dz3 = dz0 - (T)1.0 - SQUISH_CONSTANT;
 				contr_m[3] = pow2(dx3) + pow2(dy3) + pow2(dz3);
-				contr_ext[3] = extrapolate(xsb, ysb, zsb + 1, dx3, dy3, dz3);
+				contr_ext[3] = extrapolate(lattice, xsb, ysb, zsb + 1, dx3, dy3, dz3);
 
 				// Contribution (1,1,0).
 				T dx4 = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
 				T dy4 = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
 				T dz4 = dz0 - (SQUISH_CONSTANT * (T)2.0);
 				contr_m[4] = pow2(dx4) + pow2(dy4) + pow2(dz4);
-				contr_ext[4] = extrapolate(xsb + 1, ysb + 1, zsb, dx4, dy4, dz4);
+				contr_ext[4] = extrapolate(lattice, xsb + 1, ysb + 1, zsb, dx4, dy4, dz4);
 
 				// Contribution (1,0,1).
 				T dx5 = dx4;
 				T dy5 = dy0 - (SQUISH_CONSTANT * (T)2.0);
 				T dz5 = dz0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
 				contr_m[5] = pow2(dx5) + pow2(dy5) + pow2(dz5);
-				contr_ext[5] = extrapolate(xsb + 1, ysb, zsb + 1, dx5, dy5, dz5);
+				contr_ext[5] = extrapolate(lattice, xsb + 1, ysb, zsb + 1, dx5, dy5, dz5);
 
 				// Contribution (0,1,1).
 				T dx6 = dx0 - (SQUISH_CONSTANT * (T)2.0);
 				T dy6 = dy4;
 				T dz6 = dz5;
 				contr_m[6] = pow2(dx6) + pow2(dy6) + pow2(dz6);
-				contr_ext[6] = extrapolate(xsb, ysb + 1, zsb + 1, dx6, dy6, dz6);
+				contr_ext[6] = extrapolate(lattice, xsb, ysb + 1, zsb + 1, dx6, dy6, dz6);
 
 			}
 			else if (inSum <= (T)1.0) {
@@ -924,7 +1758,7 @@ namespace OSN {
 				// Contribution (0,0,0)
 	  {
 		  contr_m[0] = pow2(dx0) + pow2(dy0) + pow2(dz0);
-		  contr_ext[0] = extrapolate(xsb, ysb, zsb, dx0, dy0, dz0);
+		  contr_ext[0] = extrapolate(lattice, xsb, ysb, zsb, dx0, dy0, dz0);
 	  }
 
 	  // Contribution (0,0,1)
@@ -932,21 +1766,21 @@ namespace OSN {
 	  T dy1 = dy0 - SQUISH_CONSTANT;
 	  T dz1 = dz0 - SQUISH_CONSTANT;
 	  contr_m[1] = pow2(dx1) + pow2(dy1) + pow2(dz1);
-	  contr_ext[1] = extrapolate(xsb + 1, ysb, zsb, dx1, dy1, dz1);
+	  contr_ext[1] = extrapolate(lattice, xsb + 1, ysb, zsb, dx1, dy1, dz1);
 
 	  // Contribution (0,1,0)
 	  T dx2 = dx0 - SQUISH_CONSTANT;
 	  T dy2 = dy0 - (T)1.0 - SQUISH_CONSTANT;
 	  T dz2 = dz1;
 	  contr_m[2] = pow2(dx2) + pow2(dy2) + pow2(dz2);
-	  contr_ext[2] = extrapolate(xsb, ysb + 1, zsb, dx2, dy2, dz2);
+	  contr_ext[2] = extrapolate(lattice, xsb, ysb + 1, zsb, dx2, dy2, dz2);
 
 	  // Contribution (1,0,0)
 	  T dx3 = dx2;
 	  T dy3 = dy1;
 	  T dz3 = dz0 - (T)1.0 - SQUISH_CONSTANT;
 	  contr_m[3] = pow2(dx3) + pow2(dy3) + pow2(dz3);
-	  contr_ext[3] = extrapolate(xsb, ysb, zsb + 1, dx3, dy3, dz3);
+	  contr_ext[3] = extrapolate(lattice, xsb, ysb, zsb + 1, dx3, dy3, dz3);
 
 	  contr_m[4] = contr_m[5] = contr_m[6] = 0.0;
 	  contr_ext[4] = contr_ext[5] = contr_ext[6] = 0.0;
@@ -1066,14 +1900,14 @@ namespace OSN {
 				T dy3 = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
 				T dz3 = dz0 - (SQUISH_CONSTANT * (T)2.0);
 				contr_m[3] = pow2(dx3) + pow2(dy3) + pow2(dz3);
-				contr_ext[3] = extrapolate(xsb + 1, ysb + 1, zsb, dx3, dy3, dz3);
+				contr_ext[3] = extrapolate(lattice, xsb + 1, ysb + 1, zsb, dx3, dy3, dz3);
 
 				// Contribution (1,0,1)
 				T dx2 = dx3;
 				T dy2 = dy0 - (SQUISH_CONSTANT * (T)2.0);
 				T dz2 = dz0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
 				contr_m[2] = pow2(dx2) + pow2(dy2) + pow2(dz2);
-				contr_ext[2] = extrapolate(xsb + 1, ysb, zsb + 1, dx2, dy2, dz2);
+				contr_ext[2] = extrapolate(lattice, xsb + 1, ysb, zsb + 1, dx2, dy2, dz2);
 
 				// Contribution (0,1,1)
 				{
@@ -1081,7 +1915,7 @@ namespace OSN {
 					T dy1 = dy3;
 					T dz1 = dz2;
 					contr_m[1] = pow2(dx1) + pow2(dy1) + pow2(dz1);
-					contr_ext[1] = extrapolate(xsb, ysb + 1, zsb + 1, dx1, dy1, dz1);
+					contr_ext[1] = extrapolate(lattice, xsb, ysb + 1, zsb + 1, dx1, dy1, dz1);
 				}
 
 				// Contribution (1,1,1)
@@ -1090,7 +1924,7 @@ namespace OSN {
 		  dy0 = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)3.0);
 		  dz0 = dz0 - (T)1.0 - (SQUISH_CONSTANT * (T)3.0);
 		  contr_m[0] = pow2(dx0) + pow2(dy0) + pow2(dz0);
-		  contr_ext[0] = extrapolate(xsb + 1, ysb + 1, zsb + 1, dx0, dy0, dz0);
+		  contr_ext[0] = extrapolate(lattice, xsb + 1, ysb + 1, zsb + 1, dx0, dy0, dz0);
 	  }
 
 	  contr_m[4] = contr_m[5] = contr_m[6] = 0.0;
@@ -1100,11 +1934,11 @@ namespace OSN {
 
 			// First extra vertex.
 			contr_m[7] = pow2(dx_ext0) + pow2(dy_ext0) + pow2(dz_ext0);
-			contr_ext[7] = extrapolate(xsv_ext0, ysv_ext0, zsv_ext0, dx_ext0, dy_ext0, dz_ext0);
+			contr_ext[7] = extrapolate(lattice, xsv_ext0, ysv_ext0, zsv_ext0, dx_ext0, dy_ext0, dz_ext0);
 
 			// Second extra vertex.
 			contr_m[8] = pow2(dx_ext1) + pow2(dy_ext1) + pow2(dz_ext1);
-			contr_ext[8] = extrapolate(xsv_ext1, ysv_ext1, zsv_ext1, dx_ext1, dy_ext1, dz_ext1);
+			contr_ext[8] = extrapolate(lattice, xsv_ext1, ysv_ext1, zsv_ext1, dx_ext1, dy_ext1, dz_ext1);
 
 			T value = 0.0;
 			for (int i = 0; i < 9; ++i) {
@@ -1119,12 +1953,19 @@ namespace OSN {
 
 
 	// 4D Implementation of the OpenSimplexNoise generator.
-	template <>
-	class Noise <4> : public NoiseBase{
+	template <typename Policy>
+	class Noise <4, Policy> : public NoiseBase<Policy> {
 	private:
 
+		typedef NoiseBase<Policy> Base;
+		typedef typename Policy::Index inttype;
+		typedef typename Policy::Gradient GradientType;
+		typedef typename Base::PermType PermType;
+		using Base::perm;
+		using Base::floorMode;
+
 		// Array of gradient values for 4D. Values are defined below the class definition.
-		static const int gradients[256];
+		static const GradientType gradients[256];
 
 		template <typename T>
 		inline T extrapolate(inttype xsb, inttype ysb, inttype zsb, inttype wsb, T dx, T dy, T dz, T dw) const {
@@ -1135,16 +1976,34 @@ namespace OSN {
 				gradients[index + 3] * dw;
 		}
 
+		// Dispatch eval to the kernel for Policy::Floor.
+		template <typename T>
+		T evalFloor(RuntimeFloor, T x, T y, T z, T w) const {
+			return (floorMode == FLOOR_STRICT) ? evalKernel<StrictFloor>(x, y, z, w) : evalKernel<FastFloor>(x, y, z, w);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T x, T y, T z, T w) const {
+			return evalKernel<Floor>(x, y, z, w);
+		}
+
 	public:
 
-		Noise(int64_t seed = 0LL) : NoiseBase(seed) {}
-		Noise(const int * p) : NoiseBase(p) {}
+		Noise(int64_t seed = 0LL) : Base(seed) {}
+		Noise(const int * p) : Base(p) {}
 
 
 		template <typename T>
 		T eval(T x, T y, T z, T w) const {
+			return evalFloor(typename Policy::Floor(), x, y, z, w);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(T x, T y, T z, T w) const {
 
 			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_4D_SAMPLES, 1);
 
 			static const T STRETCH_CONSTANT = (T) ((1.0 / std::sqrt(4.0 + 1.0) - 1.0) * 0.25);
 			static const T SQUISH_CONSTANT = (T) ((std::sqrt(4.0 + 1.0) - 1.0) * 0.25);
@@ -1163,25 +2022,10 @@ namespace OSN {
 				T ws = w + stretchOffset;
 
 				// Floor to get simplectic honeycomb coordinates of rhombo-hypercube origin.
-#ifdef __FAST_MATH__
-				T xsbd = std::floor(xs);
-				T ysbd = std::floor(ys);
-				T zsbd = std::floor(zs);
-				T wsbd = std::floor(ws);
-				xsb = (inttype)xsbd;
-				ysb = (inttype)ysbd;
-				zsb = (inttype)zsbd;
-				wsb = (inttype)wsbd;
-#else
-				xsb = fastFloori(xs);
-				ysb = fastFloori(ys);
-				zsb = fastFloori(zs);
-				wsb = fastFloori(ws);
-				T xsbd = (T) xsb;
-				T ysbd = (T) ysb;
-				T zsbd = (T) zsb;
-				T wsbd = (T) wsb;
-#endif
+				T xsbd = Floor::floor(xs, xsb);
+				T ysbd = Floor::floor(ys, ysb);
+				T zsbd = Floor::floor(zs, zsb);
+				T wsbd = Floor::floor(ws, wsb);
 
 				// Skew out to get actual coordinates of stretched rhombo-hypercube origin.
 				T squishOffset = (xsbd + ysbd + zsbd + wsbd) * SQUISH_CONSTANT;
@@ -2571,6 +3415,331 @@ namespace OSN {
 	return (value * NORM_CONSTANT);
 		}
 
+		// Evaluates count points whose coordinates are given in separate arrays.
+		// See Noise<2>::evalBatch.
+		void evalBatch(const double * x, const double * y, const double * z, const double * w, double * out, size_t count) const;
+		void evalBatch(const float * x, const float * y, const float * z, const float * w, float * out, size_t count) const;
+
+	};
+
+
+	// Animated 2D noise that loops seamlessly in time.
+	//
+	// eval(x, y, t) is 3D noise whose gradients repeat every period() units of
+	// t, so frame t and frame t + period() are identical and every frame in
+	// between is ordinary 3D noise. This is much cheaper than the usual
+	// approach of sampling 4D noise around a circle, (x, y, r cos t, r sin t).
+	//
+	// A step of 6 * length along t is the lattice vector (-length, -length,
+	// 5 * length) in stretched space, so the loop is made by hashing each
+	// lattice point as its representative modulo that vector. The period is
+	// therefore a multiple of 6; scale t to fit the wanted number of
+	// features per loop.
+	//
+	// It is built on Noise<3> but does not expose its interface, whose
+	// evaluators do not loop; only the entry points below wrap the lattice.
+	template <typename Policy = DefaultPolicy>
+	class LoopingNoise : protected Noise<3, Policy> {
+	private:
+
+		typedef Noise<3, Policy> Base;
+		typedef typename Policy::Index inttype;
+
+		// Picks the representative with 0 <= xsb + ysb + 4 * zsb < span; that
+		// sum changes by span = 18 * length along the loop vector.
+		struct LoopLattice {
+
+			inttype length;
+			inttype span;
+
+			inline void wrapBase(inttype & xsb, inttype & ysb, inttype & zsb) const {
+				inttype m = xsb + ysb + 4 * zsb;
+				inttype q = m / span;
+				if (m - q * span < 0) { --q; }
+				xsb += q * length;
+				ysb += q * length;
+				zsb -= q * 5 * length;
+			}
+
+			// Vertices are within a few units of the wrapped base, so at most
+			// one step is needed.
+			inline void wrap(inttype & xsb, inttype & ysb, inttype & zsb) const {
+				inttype m = xsb + ysb + 4 * zsb;
+				inttype q = (m < 0) ? -1 : (m >= span) ? 1 : 0;
+				xsb += q * length;
+				ysb += q * length;
+				zsb -= q * 5 * length;
+			}
+
+		};
+
+		LoopLattice lattice;
+
+		// Dispatch eval and evalFrames to the kernel for Policy::Floor.
+		template <typename T>
+		T evalFloor(RuntimeFloor, T x, T y, T t) const {
+			return (this->getFloorMode() == FLOOR_STRICT) ?
+				this->template evalLattice<StrictFloor>(x, y, t, lattice) :
+				this->template evalLattice<FastFloor>(x, y, t, lattice);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T x, T y, T t) const {
+			return this->template evalLattice<Floor>(x, y, t, lattice);
+		}
+
+		template <typename Floor, typename T>
+		void evalFramesKernel(const T * x, const T * y, T * out, size_t count, size_t frames) const {
+			// Frames are written in blocks of points, so that each point's frames
+			// are evaluated together while every frame's output stays contiguous.
+			const size_t BLOCK = 64;
+			const T step = period<T>() / (T) (int64_t) frames;
+			for (size_t begin = 0; begin < count; begin += BLOCK) {
+				size_t end = (count - begin < BLOCK) ? count : begin + BLOCK;
+				for (size_t f = 0; f < frames; ++f) {
+					T t = step * (T) (int64_t) f;
+					T * frame = out + f * count;
+					for (size_t i = begin; i < end; ++i) {
+						frame[i] = this->template evalLattice<Floor>(x[i], y[i], t, lattice);
+					}
+				}
+			}
+		}
+
+		template <typename T>
+		void evalFramesFloor(RuntimeFloor, const T * x, const T * y, T * out, size_t count, size_t frames) const {
+			if (this->getFloorMode() == FLOOR_STRICT) { evalFramesKernel<StrictFloor>(x, y, out, count, frames); }
+			else { evalFramesKernel<FastFloor>(x, y, out, count, frames); }
+		}
+
+		template <typename Floor, typename T>
+		void evalFramesFloor(Floor, const T * x, const T * y, T * out, size_t count, size_t frames) const {
+			evalFramesKernel<Floor>(x, y, out, count, frames);
+		}
+
+		void setLength(int length) {
+			lattice.length = (length < 1) ? 1 : length;
+			lattice.span = 18 * lattice.length;
+		}
+
+	public:
+
+		// The noise repeats every 6 * length units of t.
+		LoopingNoise(int64_t seed = 0LL, int length = 1) : Base(seed) { setLength(length); }
+		LoopingNoise(const int * p, int length = 1) : Base(p) { setLength(length); }
+
+		using Base::setFloorMode;
+		using Base::getFloorMode;
+
+		template <typename T>
+		T period(void) const {
+			return (T) (6 * lattice.length);
+		}
+
+		template <typename T>
+		T eval(T x, T y, T t) const {
+			return evalFloor(typename Policy::Floor(), x, y, t);
+		}
+
+		// Evaluates count points whose coordinates are given in separate
+		// arrays, so that the fills can sample the loop. See Noise<3>::evalBatch.
+		void evalBatch(const double * x, const double * y, const double * t, double * out, size_t count) const;
+		void evalBatch(const float * x, const float * y, const float * t, float * out, size_t count) const;
+
+		// Evaluates count points through a whole loop of frames, with frame f
+		// at t = f * period() / frames. The output holds frames consecutive
+		// arrays of count values.
+		// Multiversioned in OpenSimplexNoise.cpp, like evalBatch.
+		void evalFrames(const double * x, const double * y, double * out, size_t count, size_t frames) const;
+		void evalFrames(const float * x, const float * y, float * out, size_t count, size_t frames) const;
+
+	};
+
+
+
+	// Array of gradient values for 1D: eight slopes of each sign.
+	template <typename Policy>
+	const typename Policy::Gradient Noise<1, Policy>::gradients [] = {
+		1, 2, 3, 4, 5, 6, 7, 8, -1, -2, -3, -4, -5, -6, -7, -8
 	};
 
+	// Array of gradient values for 2D. They approximate the directions to the
+	// vertices of a octagon from its center.
+	// Gradient set 2014-10-06.
+	template <typename Policy>
+	const typename Policy::Gradient Noise<2, Policy>::gradients [] = {
+		5, 2, 2, 5, -5, 2, -2, 5,
+		5, -2, 2, -5, -5, -2, -2, -5
+	};
+
+	// Array of gradient values for 3D. They approximate the directions to the
+	// vertices of a rhombicuboctahedron from its center, skewed so that the
+	// triangular and square facets can be inscribed in circles of the same radius.
+	// New gradient set 2014-10-06.
+	template <typename Policy>
+	const typename Policy::Gradient Noise<3, Policy>::gradients [] = {
+		-11, 4, 4, -4, 11, 4, -4, 4, 11, 11, 4, 4, 4, 11, 4, 4, 4, 11,
+		-11, -4, 4, -4, -11, 4, -4, -4, 11, 11, -4, 4, 4, -11, 4, 4, -4, 11,
+		-11, 4, -4, -4, 11, -4, -4, 4, -11, 11, 4, -4, 4, 11, -4, 4, 4, -11,
+		-11, -4, -4, -4, -11, -4, -4, -4, -11, 11, -4, -4, 4, -11, -4, 4, -4, -11
+	};
+
+	// Array of gradient values for 4D. They approximate the directions to the
+	// vertices of a disprismatotesseractihexadecachoron from its center, skewed so that the
+	// tetrahedral and cubic facets can be inscribed in spheres of the same radius.
+	// Gradient set 2014-10-06.
+	template <typename Policy>
+	const typename Policy::Gradient Noise<4, Policy>::gradients [] = {
+		3, 1, 1, 1, 1, 3, 1, 1, 1, 1, 3, 1, 1, 1, 1, 3,
+		-3, 1, 1, 1, -1, 3, 1, 1, -1, 1, 3, 1, -1, 1, 1, 3,
+		3, -1, 1, 1, 1, -3, 1, 1, 1, -1, 3, 1, 1, -1, 1, 3,
+		-3, -1, 1, 1, -1, -3, 1, 1, -1, -1, 3, 1, -1, -1, 1, 3,
+		3, 1, -1, 1, 1, 3, -1, 1, 1, 1, -3, 1, 1, 1, -1, 3,
+		-3, 1, -1, 1, -1, 3, -1, 1, -1, 1, -3, 1, -1, 1, -1, 3,
+		3, -1, -1, 1, 1, -3, -1, 1, 1, -1, -3, 1, 1, -1, -1, 3,
+		-3, -1, -1, 1, -1, -3, -1, 1, -1, -1, -3, 1, -1, -1, -1, 3,
+		3, 1, 1, -1, 1, 3, 1, -1, 1, 1, 3, -1, 1, 1, 1, -3,
+		-3, 1, 1, -1, -1, 3, 1, -1, -1, 1, 3, -1, -1, 1, 1, -3,
+		3, -1, 1, -1, 1, -3, 1, -1, 1, -1, 3, -1, 1, -1, 1, -3,
+		-3, -1, 1, -1, -1, -3, 1, -1, -1, -1, 3, -1, -1, -1, 1, -3,
+		3, 1, -1, -1, 1, 3, -1, -1, 1, 1, -3, -1, 1, 1, -1, -3,
+		-3, 1, -1, -1, -1, 3, -1, -1, -1, 1, -3, -1, -1, 1, -1, -3,
+		3, -1, -1, -1, 1, -3, -1, -1, 1, -1, -3, -1, 1, -1, -1, -3,
+		-3, -1, -1, -1, -1, -3, -1, -1, -1, -1, -3, -1, -1, -1, -1, -3
+	};
+
+	template <typename Policy>
+	void Noise<1, Policy>::evalBatch(const double * x, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<1, Policy>::evalBatch(const float * x, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<1, Policy>::evalTrack(double start, double step, double * out, size_t count) const {
+		evalTrackFloor(typename Policy::Floor(), start, step, out, count);
+	}
+
+	template <typename Policy>
+	void Noise<1, Policy>::evalTrack(float start, float step, float * out, size_t count) const {
+		evalTrackFloor(typename Policy::Floor(), start, step, out, count);
+	}
+
+	template <typename Policy>
+	void Noise<2, Policy>::evalBatch(const double * x, const double * y, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<2, Policy>::evalBatch(const float * x, const float * y, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<3, Policy>::evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<3, Policy>::evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<2, Policy>::evalGradientBatch(const double * x, const double * y, ValueGradient<double, 2> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { evalGradient(x[i], y[i], out[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<2, Policy>::evalGradientBatch(const float * x, const float * y, ValueGradient<float, 2> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { evalGradient(x[i], y[i], out[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<3, Policy>::evalGradientBatch(const double * x, const double * y, const double * z, ValueGradient<double, 3> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { evalGradient(x[i], y[i], z[i], out[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<3, Policy>::evalGradientBatch(const float * x, const float * y, const float * z, ValueGradient<float, 3> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { evalGradient(x[i], y[i], z[i], out[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<2, Policy>::hessianBatch(const double * x, const double * y, Derivatives<double, 2> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { hessian(x[i], y[i], out[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<2, Policy>::hessianBatch(const float * x, const float * y, Derivatives<float, 2> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { hessian(x[i], y[i], out[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<3, Policy>::hessianBatch(const double * x, const double * y, const double * z, Derivatives<double, 3> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { hessian(x[i], y[i], z[i], out[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<3, Policy>::hessianBatch(const float * x, const float * y, const float * z, Derivatives<float, 3> * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { hessian(x[i], y[i], z[i], out[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<4, Policy>::evalBatch(const double * x, const double * y, const double * z, const double * w, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i], w[i]); }
+	}
+
+	template <typename Policy>
+	void Noise<4, Policy>::evalBatch(const float * x, const float * y, const float * z, const float * w, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i], w[i]); }
+	}
+
+	template <typename Policy>
+	void LoopingNoise<Policy>::evalBatch(const double * x, const double * y, const double * t, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], t[i]); }
+	}
+
+	template <typename Policy>
+	void LoopingNoise<Policy>::evalBatch(const float * x, const float * y, const float * t, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], t[i]); }
+	}
+
+	template <typename Policy>
+	void LoopingNoise<Policy>::evalFrames(const double * x, const double * y, double * out, size_t count, size_t frames) const {
+		evalFramesFloor(typename Policy::Floor(), x, y, out, count, frames);
+	}
+
+	template <typename Policy>
+	void LoopingNoise<Policy>::evalFrames(const float * x, const float * y, float * out, size_t count, size_t frames) const {
+		evalFramesFloor(typename Policy::Floor(), x, y, out, count, frames);
+	}
+
+	// The default generators' batch kernels are multiversioned in OpenSimplexNoise.cpp.
+	template <> void Noise<1>::evalBatch(const double * x, double * out, size_t count) const;
+	template <> void Noise<1>::evalBatch(const float * x, float * out, size_t count) const;
+	template <> void Noise<1>::evalTrack(double start, double step, double * out, size_t count) const;
+	template <> void Noise<1>::evalTrack(float start, float step, float * out, size_t count) const;
+	template <> void Noise<2>::evalBatch(const double * x, const double * y, double * out, size_t count) const;
+	template <> void Noise<2>::evalBatch(const float * x, const float * y, float * out, size_t count) const;
+	template <> void Noise<3>::evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const;
+	template <> void Noise<3>::evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const;
+	template <> void Noise<2>::evalGradientBatch(const double * x, const double * y, ValueGradient<double, 2> * out, size_t count) const;
+	template <> void Noise<2>::evalGradientBatch(const float * x, const float * y, ValueGradient<float, 2> * out, size_t count) const;
+	template <> void Noise<3>::evalGradientBatch(const double * x, const double * y, const double * z, ValueGradient<double, 3> * out, size_t count) const;
+	template <> void Noise<3>::evalGradientBatch(const float * x, const float * y, const float * z, ValueGradient<float, 3> * out, size_t count) const;
+	template <> void Noise<2>::hessianBatch(const double * x, const double * y, Derivatives<double, 2> * out, size_t count) const;
+	template <> void Noise<2>::hessianBatch(const float * x, const float * y, Derivatives<float, 2> * out, size_t count) const;
+	template <> void Noise<3>::hessianBatch(const double * x, const double * y, const double * z, Derivatives<double, 3> * out, size_t count) const;
+	template <> void Noise<3>::hessianBatch(const float * x, const float * y, const float * z, Derivatives<float, 3> * out, size_t count) const;
+	template <> void Noise<4>::evalBatch(const double * x, const double * y, const double * z, const double * w, double * out, size_t count) const;
+	template <> void Noise<4>::evalBatch(const float * x, const float * y, const float * z, const float * w, float * out, size_t count) const;
+	template <> void LoopingNoise<>::evalBatch(const double * x, const double * y, const double * t, double * out, size_t count) const;
+	template <> void LoopingNoise<>::evalBatch(const float * x, const float * y, const float * t, float * out, size_t count) const;
+	template <> void LoopingNoise<>::evalFrames(const double * x, const double * y, double * out, size_t count, size_t frames) const;
+	template <> void LoopingNoise<>::evalFrames(const float * x, const float * y, float * out, size_t count, size_t frames) const;
+
 }
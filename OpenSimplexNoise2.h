@@ -0,0 +1,863 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * OpenSimplex2 engine
+ *
+ * Generators on the lattices of OpenSimplex2 by Kurt Spencer:
+ *   https://github.com/KdotJPG/OpenSimplex2
+ *
+ * Noise2F ("fast") and Noise2S ("smooth") are alternatives to the original
+ * 2014 generators in OpenSimplexNoise.h, with the same eval and evalBatch
+ * interface. They sum fewer, better-placed contributions (Noise2F<3> at most
+ * 6 where Noise<3> examines 9, Noise2F<4> at most 7) and choose them with
+ * far less branching. Gradients
+ * are picked by hashing the lattice point with a 64-bit seed rather than
+ * through a 256-entry permutation, so every seed gives a distinct pattern
+ * and the pattern does not repeat every 256 cells.
+ *
+ * Noise2S uses a larger attenuation radius than Noise2F and so sums more
+ * contributions; it is smoother, without the faint directional artifacts of
+ * the fast variant, at somewhat higher cost. In 3D and 4D the fast variant's
+ * squared radius is 0.6, as in the reference implementation, but every point
+ * in range is summed. (The reference drops the weakest of them, which makes
+ * its output slightly discontinuous.)
+ *
+ * These generators produce different noise from Noise<N>, and their gradient
+ * tables and hash-to-gradient order are this file's own, so their output
+ * does not match the reference OpenSimplex2 implementations bit for bit.
+ * Keep using Noise<N> wherever existing output has to be reproduced.
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "OpenSimplexNoise.h"
+
+
+namespace OSN {
+
+	// Hashing and gradient tables shared by the OpenSimplex2 generators. Of
+	// the generator Policy, Floor and Index apply; Perm and Gradient do not,
+	// since there is no permutation and the gradients are not integers.
+	template <typename Policy = DefaultPolicy>
+	class Noise2Base {
+
+	public:
+
+		// As NoiseBase::setFloorMode.
+		void setFloorMode(FloorMode mode) { floorMode = mode; }
+		FloorMode getFloorMode(void) const { return floorMode; }
+
+	protected:
+
+		typedef typename Policy::Index inttype;
+
+		// Lattice coordinates are multiplied by these before being hashed.
+		// Arithmetic on them wraps, so it is done unsigned.
+		static const uint64_t PRIME_X = 0x5205402B9270C86FULL;
+		static const uint64_t PRIME_Y = 0x598CD327003817B5ULL;
+		static const uint64_t PRIME_Z = 0x5BCC226E9FA0BACBULL;
+		static const uint64_t PRIME_W = 0x56CC5227E58F554BULL;
+		static const uint64_t HASH_MULTIPLIER = 0x53A3F72DEEC546F5ULL;
+
+		// Gradients, replicated to fill a power-of-two table so that the top bits
+		// of a hash select one. 3D and 4D entries are padded to four components.
+		template <typename T>
+		struct Tables {
+
+			T gradients2[128 * 2];
+			T gradients3[256 * 4];
+			T gradients4[512 * 4];
+
+			Tables(void) {
+				// Unit vectors at 22.5 + 45k degrees, then at 7.5 + 15k degrees for k
+				// not a multiple of 3.
+				static const double directions2[24 * 2] = {
+					 0.382683432365090,  0.923879532511287,
+					 0.923879532511287,  0.382683432365090,
+					 0.923879532511287, -0.382683432365090,
+					 0.382683432365090, -0.923879532511287,
+					-0.382683432365090, -0.923879532511287,
+					-0.923879532511287, -0.382683432365090,
+					-0.923879532511287,  0.382683432365090,
+					-0.382683432365090,  0.923879532511287,
+					 0.130526192220052,  0.991444861373810,
+					 0.608761429008721,  0.793353340291235,
+					 0.793353340291235,  0.608761429008721,
+					 0.991444861373810,  0.130526192220052,
+					 0.991444861373810, -0.130526192220052,
+					 0.793353340291235, -0.608761429008721,
+					 0.608761429008721, -0.793353340291235,
+					 0.130526192220052, -0.991444861373810,
+					-0.130526192220052, -0.991444861373810,
+					-0.608761429008721, -0.793353340291235,
+					-0.793353340291235, -0.608761429008721,
+					-0.991444861373810, -0.130526192220052,
+					-0.991444861373810,  0.130526192220052,
+					-0.793353340291235,  0.608761429008721,
+					-0.608761429008721,  0.793353340291235,
+					-0.130526192220052,  0.991444861373810
+				};
+				for (int i = 0; i < 128 * 2; ++i) { gradients2[i] = (T) directions2[i % (24 * 2)]; }
+
+				// 48 vectors of length sqrt(10.9): for each pair of axes and each sign
+				// of those two, two with components (2.22, 2.22, -+1) and two with
+				// (3.09, 1.17, 0), the last component on the remaining axis.
+				static const double A = 2.22474487139, B = 3.0862664687972017, C = 1.1721513422464978;
+				static const double pattern3[4][3] = { { A, A, -1.0 }, { A, A, 1.0 }, { B, C, 0.0 }, { C, B, 0.0 } };
+				static const int axes3[3][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 2, 0 } };
+				double directions3[48 * 4];
+				int n = 0;
+				for (int pair = 0; pair < 3; ++pair) {
+					for (int signs = 0; signs < 4; ++signs) {
+						for (int p = 0; p < 4; ++p, ++n) {
+							double * g = &directions3[n * 4];
+							g[axes3[pair][0]] = (signs & 1) ? -pattern3[p][0] : pattern3[p][0];
+							g[axes3[pair][1]] = (signs & 2) ? -pattern3[p][1] : pattern3[p][1];
+							g[axes3[pair][2]] = pattern3[p][2];
+							g[3] = 0.0;
+						}
+					}
+				}
+				for (int i = 0; i < 256 * 4; ++i) { gradients3[i] = (T) directions3[i % (48 * 4)]; }
+
+				// 64 unit vectors along (+-3, +-1, +-1, +-1) and its permutations.
+				const double major = 3.0 / std::sqrt(12.0), minor = 1.0 / std::sqrt(12.0);
+				double directions4[64 * 4];
+				for (int i = 0; i < 64; ++i) {
+					for (int d = 0; d < 4; ++d) {
+						double magnitude = (d == (i >> 4)) ? major : minor;
+						directions4[i * 4 + d] = ((i >> d) & 1) ? -magnitude : magnitude;
+					}
+				}
+				for (int i = 0; i < 512 * 4; ++i) { gradients4[i] = (T) directions4[i % (64 * 4)]; }
+			}
+
+		};
+
+		template <typename T>
+		static const Tables<T> & tables(void) {
+			static const Tables<T> t;
+			return t;
+		}
+
+		template <typename T>
+		static inline T gradient(uint64_t seed, uint64_t xsvp, uint64_t ysvp, T dx, T dy) {
+			uint64_t hash = (seed ^ xsvp ^ ysvp) * HASH_MULTIPLIER;
+			hash ^= hash >> (64 - 7 + 1);
+			const T * g = &tables<T>().gradients2[(unsigned int) hash & (127 << 1)];
+			return g[0] * dx + g[1] * dy;
+		}
+
+		template <typename T>
+		static inline T gradient(uint64_t seed, uint64_t xsvp, uint64_t ysvp, uint64_t zsvp, T dx, T dy, T dz) {
+			uint64_t hash = ((seed ^ xsvp) ^ (ysvp ^ zsvp)) * HASH_MULTIPLIER;
+			hash ^= hash >> (64 - 8 + 2);
+			const T * g = &tables<T>().gradients3[(unsigned int) hash & (255 << 2)];
+			return g[0] * dx + g[1] * dy + g[2] * dz;
+		}
+
+		template <typename T>
+		static inline T gradient(uint64_t seed, uint64_t xsvp, uint64_t ysvp, uint64_t zsvp, uint64_t wsvp, T dx, T dy, T dz, T dw) {
+			uint64_t hash = ((seed ^ xsvp) ^ (ysvp ^ zsvp) ^ wsvp) * HASH_MULTIPLIER;
+			hash ^= hash >> (64 - 9 + 2);
+			const T * g = &tables<T>().gradients4[(unsigned int) hash & (511 << 2)];
+			return (g[0] * dx + g[1] * dy) + (g[2] * dz + g[3] * dw);
+		}
+
+		uint64_t seed;
+		FloorMode floorMode;
+
+		Noise2Base(int64_t seed) : seed((uint64_t) seed), floorMode(FLOOR_DEFAULT) {}
+
+	};
+
+	template <int N, typename Policy = DefaultPolicy>
+	class Noise2F;
+
+	template <int N, typename Policy = DefaultPolicy>
+	class Noise2S;
+
+	// 2D OpenSimplex2 fast generator: each point lies in a triangle of the
+	// simplex lattice, and only that triangle's three vertices contribute.
+	template <typename Policy>
+	class Noise2F <2, Policy> : public Noise2Base<Policy> {
+	private:
+
+		typedef Noise2Base<Policy> Base;
+		typedef typename Base::inttype inttype;
+		using Base::PRIME_X;
+		using Base::PRIME_Y;
+		using Base::seed;
+		using Base::floorMode;
+
+		template <typename T>
+		T evalFloor(RuntimeFloor, T x, T y) const {
+			return (floorMode == FLOOR_STRICT) ? evalKernel<StrictFloor>(x, y) : evalKernel<FastFloor>(x, y);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T x, T y) const {
+			return evalKernel<Floor>(x, y);
+		}
+
+	public:
+
+		Noise2F(int64_t seed = 0LL) : Base(seed) {}
+
+		template <typename T>
+		T eval(T x, T y) const {
+			return evalFloor(typename Policy::Floor(), x, y);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(T x, T y) const {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_2D_SAMPLES, 1);
+
+			// (sqrt(3) - 1) / 2 and (1 / sqrt(3) - 1) / 2.
+			const T SKEW = (T) 0.366025403784439;
+			const T UNSKEW = (T) -0.21132486540518713;
+			const T RSQUARED = (T) 0.5;
+			const T NORM_CONSTANT = (T) (1.0 / 0.01001634121365712);
+
+			T s = (x + y) * SKEW;
+			T xs = x + s, ys = y + s;
+			inttype xsb, ysb;
+			T xi = xs - Floor::floor(xs, xsb);
+			T yi = ys - Floor::floor(ys, ysb);
+			uint64_t xsbp = (uint64_t) xsb * PRIME_X, ysbp = (uint64_t) ysb * PRIME_Y;
+
+			// Position relative to the cell origin, unskewed.
+			T t = (xi + yi) * UNSKEW;
+			T dx0 = xi + t, dy0 = yi + t;
+
+			T value = (T)0.0;
+			T a0 = RSQUARED - dx0 * dx0 - dy0 * dy0;
+			if (a0 > 0) { value += pow4(a0) * Base::gradient(seed, xsbp, ysbp, dx0, dy0); }
+
+			T dx1 = dx0 - ((T)1.0 + (T)2.0 * UNSKEW), dy1 = dy0 - ((T)1.0 + (T)2.0 * UNSKEW);
+			T a1 = RSQUARED - dx1 * dx1 - dy1 * dy1;
+			if (a1 > 0) { value += pow4(a1) * Base::gradient(seed, xsbp + PRIME_X, ysbp + PRIME_Y, dx1, dy1); }
+
+			if (dy0 > dx0) {
+				T dx2 = dx0 - UNSKEW, dy2 = dy0 - (UNSKEW + (T)1.0);
+				T a2 = RSQUARED - dx2 * dx2 - dy2 * dy2;
+				if (a2 > 0) { value += pow4(a2) * Base::gradient(seed, xsbp, ysbp + PRIME_Y, dx2, dy2); }
+			}
+			else {
+				T dx2 = dx0 - (UNSKEW + (T)1.0), dy2 = dy0 - UNSKEW;
+				T a2 = RSQUARED - dx2 * dx2 - dy2 * dy2;
+				if (a2 > 0) { value += pow4(a2) * Base::gradient(seed, xsbp + PRIME_X, ysbp, dx2, dy2); }
+			}
+
+			return value * NORM_CONSTANT;
+		}
+
+		// See Noise<2>::evalBatch.
+		void evalBatch(const double * x, const double * y, double * out, size_t count) const;
+		void evalBatch(const float * x, const float * y, float * out, size_t count) const;
+
+	};
+
+	// 2D OpenSimplex2 smooth generator: the two vertices of the point's cell
+	// on its long diagonal, plus the nearer of the two candidates on each side.
+	template <typename Policy>
+	class Noise2S <2, Policy> : public Noise2Base<Policy> {
+	private:
+
+		typedef Noise2Base<Policy> Base;
+		typedef typename Base::inttype inttype;
+		using Base::PRIME_X;
+		using Base::PRIME_Y;
+		using Base::seed;
+		using Base::floorMode;
+
+		template <typename T>
+		T evalFloor(RuntimeFloor, T x, T y) const {
+			return (floorMode == FLOOR_STRICT) ? evalKernel<StrictFloor>(x, y) : evalKernel<FastFloor>(x, y);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T x, T y) const {
+			return evalKernel<Floor>(x, y);
+		}
+
+		template <typename T>
+		static inline T contribution(uint64_t seed, uint64_t xsvp, uint64_t ysvp, T dx, T dy) {
+			T a = (T) (2.0 / 3.0) - dx * dx - dy * dy;
+			return (a > 0) ? pow4(a) * Base::gradient(seed, xsvp, ysvp, dx, dy) : (T)0.0;
+		}
+
+	public:
+
+		Noise2S(int64_t seed = 0LL) : Base(seed) {}
+
+		template <typename T>
+		T eval(T x, T y) const {
+			return evalFloor(typename Policy::Floor(), x, y);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(T x, T y) const {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_2D_SAMPLES, 1);
+
+			const T SKEW = (T) 0.366025403784439;
+			const T UNSKEW = (T) -0.21132486540518713;
+			const T NORM_CONSTANT = (T) (1.0 / 0.05481866495625118);
+
+			T s = (x + y) * SKEW;
+			T xs = x + s, ys = y + s;
+			inttype xsb, ysb;
+			T xi = xs - Floor::floor(xs, xsb);
+			T yi = ys - Floor::floor(ys, ysb);
+			uint64_t xsbp = (uint64_t) xsb * PRIME_X, ysbp = (uint64_t) ysb * PRIME_Y;
+
+			T t = (xi + yi) * UNSKEW;
+			T dx0 = xi + t, dy0 = yi + t;
+
+			// Both ends of the long diagonal are always in range.
+			T value = contribution(seed, xsbp, ysbp, dx0, dy0);
+			value += contribution(seed, xsbp + PRIME_X, ysbp + PRIME_Y,
+				dx0 - ((T)1.0 + (T)2.0 * UNSKEW), dy0 - ((T)1.0 + (T)2.0 * UNSKEW));
+
+			T xmyi = xi - yi;
+			if (xi + yi > (T)1.0) {
+				if (xi + xmyi > (T)1.0) {
+					value += contribution(seed, xsbp + (PRIME_X << 1), ysbp + PRIME_Y,
+						dx0 - ((T)3.0 * UNSKEW + (T)2.0), dy0 - ((T)3.0 * UNSKEW + (T)1.0));
+				}
+				else {
+					value += contribution(seed, xsbp, ysbp + PRIME_Y, dx0 - UNSKEW, dy0 - (UNSKEW + (T)1.0));
+				}
+				if (yi - xmyi > (T)1.0) {
+					value += contribution(seed, xsbp + PRIME_X, ysbp + (PRIME_Y << 1),
+						dx0 - ((T)3.0 * UNSKEW + (T)1.0), dy0 - ((T)3.0 * UNSKEW + (T)2.0));
+				}
+				else {
+					value += contribution(seed, xsbp + PRIME_X, ysbp, dx0 - (UNSKEW + (T)1.0), dy0 - UNSKEW);
+				}
+			}
+			else {
+				if (xi + xmyi < (T)0.0) {
+					value += contribution(seed, xsbp - PRIME_X, ysbp, dx0 + ((T)1.0 + UNSKEW), dy0 + UNSKEW);
+				}
+				else {
+					value += contribution(seed, xsbp + PRIME_X, ysbp, dx0 - (UNSKEW + (T)1.0), dy0 - UNSKEW);
+				}
+				if (yi < xmyi) {
+					value += contribution(seed, xsbp, ysbp - PRIME_Y, dx0 + UNSKEW, dy0 + ((T)1.0 + UNSKEW));
+				}
+				else {
+					value += contribution(seed, xsbp, ysbp + PRIME_Y, dx0 - UNSKEW, dy0 - (UNSKEW + (T)1.0));
+				}
+			}
+
+			return value * NORM_CONSTANT;
+		}
+
+		// See Noise<2>::evalBatch.
+		void evalBatch(const double * x, const double * y, double * out, size_t count) const;
+		void evalBatch(const float * x, const float * y, float * out, size_t count) const;
+
+	};
+
+	// 3D OpenSimplex2 fast generator on the body-centered cubic lattice,
+	// taken as two cubic lattices offset by half a cell. From each it sums
+	// the nearest point and those of its neighbours one or two axis steps
+	// toward the input that are in range, at most four points.
+	//
+	// eval treats the three axes alike, as Noise<3> does; evalImproveXY
+	// rotates the lattice so that xy slices look better, for when z is time
+	// or height.
+	template <typename Policy>
+	class Noise2F <3, Policy> : public Noise2Base<Policy> {
+	private:
+
+		typedef Noise2Base<Policy> Base;
+		typedef typename Base::inttype inttype;
+		using Base::PRIME_X;
+		using Base::PRIME_Y;
+		using Base::PRIME_Z;
+		using Base::seed;
+		using Base::floorMode;
+
+		static const uint64_t SEED_FLIP = 0xAD2AB84D169129D7ULL;
+
+		template <typename T>
+		T evalFloor(RuntimeFloor, T xr, T yr, T zr) const {
+			return (floorMode == FLOOR_STRICT) ? evalRotated<StrictFloor>(xr, yr, zr) : evalRotated<FastFloor>(xr, yr, zr);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T xr, T yr, T zr) const {
+			return evalRotated<Floor>(xr, yr, zr);
+		}
+
+	public:
+
+		Noise2F(int64_t seed = 0LL) : Base(seed) {}
+
+		template <typename T>
+		T eval(T x, T y, T z) const {
+			T r = (T) (2.0 / 3.0) * (x + y + z);
+			return evalFloor(typename Policy::Floor(), r - x, r - y, r - z);
+		}
+
+		template <typename T>
+		T evalImproveXY(T x, T y, T z) const {
+			T xy = x + y;
+			T s2 = xy * (T) -0.211324865405187;
+			T zz = z * (T) 0.577350269189626;
+			return evalFloor(typename Policy::Floor(), x + s2 + zz, y + s2 + zz, xy * (T) -0.577350269189626 + zz);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(T x, T y, T z) const {
+			T r = (T) (2.0 / 3.0) * (x + y + z);
+			return evalRotated<Floor>(r - x, r - y, r - z);
+		}
+
+		// Noise at coordinates already rotated onto the lattice.
+		template <typename Floor, typename T>
+		T evalRotated(T xr, T yr, T zr) const {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_3D_SAMPLES, 1);
+
+			const T RSQUARED = (T) 0.6;
+			const T NORM_CONSTANT = (T) (1.0 / 0.079698376689353);
+
+			// Nearest point of the first lattice.
+			inttype xrb, yrb, zrb;
+			T xri = xr - Floor::floor(xr + (T)0.5, xrb);
+			T yri = yr - Floor::floor(yr + (T)0.5, yrb);
+			T zri = zr - Floor::floor(zr + (T)0.5, zrb);
+			uint64_t xrbp = (uint64_t) xrb * PRIME_X, yrbp = (uint64_t) yrb * PRIME_Y, zrbp = (uint64_t) zrb * PRIME_Z;
+			uint64_t latticeSeed = seed;
+
+			T value = (T)0.0;
+			for (int l = 0; ; ++l) {
+				T a = RSQUARED - xri * xri - yri * yri - zri * zri;
+				if (a > 0) {
+					value += pow4(a) * Base::gradient(latticeSeed, xrbp, yrbp, zrbp, xri, yri, zri);
+
+					// Stepping toward the input along an axis changes the attenuation
+					// by 2 |offset| - 1 on that axis. One or two such steps may stay in
+					// range; three never do. No other point is in range when the
+					// nearest one is not.
+					T bx = std::fabs(xri) * (T)2.0 - (T)1.0;
+					T by = std::fabs(yri) * (T)2.0 - (T)1.0;
+					T bz = std::fabs(zri) * (T)2.0 - (T)1.0;
+					uint64_t xnp = (xri > 0) ? xrbp + PRIME_X : xrbp - PRIME_X;
+					uint64_t ynp = (yri > 0) ? yrbp + PRIME_Y : yrbp - PRIME_Y;
+					uint64_t znp = (zri > 0) ? zrbp + PRIME_Z : zrbp - PRIME_Z;
+					T xn = (xri > 0) ? xri - (T)1.0 : xri + (T)1.0;
+					T yn = (yri > 0) ? yri - (T)1.0 : yri + (T)1.0;
+					T zn = (zri > 0) ? zri - (T)1.0 : zri + (T)1.0;
+
+					T b = a + bx;
+					if (b > 0) {
+						value += pow4(b) * Base::gradient(latticeSeed, xnp, yrbp, zrbp, xn, yri, zri);
+						T c = b + by;
+						if (c > 0) { value += pow4(c) * Base::gradient(latticeSeed, xnp, ynp, zrbp, xn, yn, zri); }
+						c = b + bz;
+						if (c > 0) { value += pow4(c) * Base::gradient(latticeSeed, xnp, yrbp, znp, xn, yri, zn); }
+					}
+					b = a + by;
+					if (b > 0) {
+						value += pow4(b) * Base::gradient(latticeSeed, xrbp, ynp, zrbp, xri, yn, zri);
+						T c = b + bz;
+						if (c > 0) { value += pow4(c) * Base::gradient(latticeSeed, xrbp, ynp, znp, xri, yn, zn); }
+					}
+					b = a + bz;
+					if (b > 0) { value += pow4(b) * Base::gradient(latticeSeed, xrbp, yrbp, znp, xri, yri, zn); }
+				}
+
+				if (l == 1) { break; }
+
+				// The nearest point of the second lattice is the corner half a step
+				// toward the input on every axis. Its point at p + 0.5 is indexed p + 1.
+				if (xri > 0) { xrbp += PRIME_X; xri -= (T)0.5; } else { xri += (T)0.5; }
+				if (yri > 0) { yrbp += PRIME_Y; yri -= (T)0.5; } else { yri += (T)0.5; }
+				if (zri > 0) { zrbp += PRIME_Z; zri -= (T)0.5; } else { zri += (T)0.5; }
+				latticeSeed ^= SEED_FLIP;
+			}
+
+			return value * NORM_CONSTANT;
+		}
+
+		// See Noise<2>::evalBatch. Evaluates eval, not evalImproveXY.
+		void evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const;
+		void evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const;
+
+	};
+
+	// 3D OpenSimplex2 smooth generator on the same lattice as Noise2F<3>, with
+	// a larger attenuation radius: up to 8 points of each cubic lattice are in
+	// range, all corners of the cell of that lattice containing the input.
+	template <typename Policy>
+	class Noise2S <3, Policy> : public Noise2Base<Policy> {
+	private:
+
+		typedef Noise2Base<Policy> Base;
+		typedef typename Base::inttype inttype;
+		using Base::PRIME_X;
+		using Base::PRIME_Y;
+		using Base::PRIME_Z;
+		using Base::seed;
+		using Base::floorMode;
+
+		static const uint64_t SEED_FLIP = 0xAD2AB84D169129D7ULL;
+
+		template <typename T>
+		T evalFloor(RuntimeFloor, T xr, T yr, T zr) const {
+			return (floorMode == FLOOR_STRICT) ? evalRotated<StrictFloor>(xr, yr, zr) : evalRotated<FastFloor>(xr, yr, zr);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T xr, T yr, T zr) const {
+			return evalRotated<Floor>(xr, yr, zr);
+		}
+
+		template <typename T>
+		static inline T contribution(uint64_t seed, uint64_t xsvp, uint64_t ysvp, uint64_t zsvp, T dx, T dy, T dz, T a) {
+			return pow4(a) * Base::gradient(seed, xsvp, ysvp, zsvp, dx, dy, dz);
+		}
+
+	public:
+
+		Noise2S(int64_t seed = 0LL) : Base(seed) {}
+
+		// See Noise2F<3>::eval and evalImproveXY.
+		template <typename T>
+		T eval(T x, T y, T z) const {
+			T r = (T) (2.0 / 3.0) * (x + y + z);
+			return evalFloor(typename Policy::Floor(), r - x, r - y, r - z);
+		}
+
+		template <typename T>
+		T evalImproveXY(T x, T y, T z) const {
+			T xy = x + y;
+			T s2 = xy * (T) -0.211324865405187;
+			T zz = z * (T) 0.577350269189626;
+			return evalFloor(typename Policy::Floor(), x + s2 + zz, y + s2 + zz, xy * (T) -0.577350269189626 + zz);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(T x, T y, T z) const {
+			T r = (T) (2.0 / 3.0) * (x + y + z);
+			return evalRotated<Floor>(r - x, r - y, r - z);
+		}
+
+		// Noise at coordinates already rotated onto the lattice.
+		template <typename Floor, typename T>
+		T evalRotated(T xr, T yr, T zr) const {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_3D_SAMPLES, 1);
+
+			const T RSQUARED = (T) 0.75;
+			const T NORM_CONSTANT = (T) (1.0 / 0.2781926117527186);
+
+			T value = (T)0.0;
+			uint64_t latticeSeed = seed;
+			for (int l = 0; l < 2; ++l) {
+				// The second lattice's points are at p + 0.5, indexed p.
+				T offset = l ? (T)0.5 : (T)0.0;
+				inttype xb, yb, zb;
+				T xi = (xr - offset) - Floor::floor(xr - offset, xb);
+				T yi = (yr - offset) - Floor::floor(yr - offset, yb);
+				T zi = (zr - offset) - Floor::floor(zr - offset, zb);
+				uint64_t xbp = (uint64_t) xb * PRIME_X, ybp = (uint64_t) yb * PRIME_Y, zbp = (uint64_t) zb * PRIME_Z;
+
+				// Offsets from the nearest corner, and from the far corner on each axis.
+				bool xu = xi > (T)0.5, yu = yi > (T)0.5, zu = zi > (T)0.5;
+				T dx = xu ? xi - (T)1.0 : xi, dy = yu ? yi - (T)1.0 : yi, dz = zu ? zi - (T)1.0 : zi;
+				T fx = xu ? xi : xi - (T)1.0, fy = yu ? yi : yi - (T)1.0, fz = zu ? zi : zi - (T)1.0;
+				uint64_t xp = xu ? xbp + PRIME_X : xbp, yp = yu ? ybp + PRIME_Y : ybp, zp = zu ? zbp + PRIME_Z : zbp;
+				uint64_t xf = xu ? xbp : xbp + PRIME_X, yf = yu ? ybp : ybp + PRIME_Y, zf = zu ? zbp : zbp + PRIME_Z;
+
+				// The nearest corner is always in range. Switching to the far corner
+				// on an axis lowers the attenuation by 1 - 2 |offset| on that axis,
+				// so a corner can only be in range if each corner between it and
+				// the nearest one is too.
+				T a = RSQUARED - dx * dx - dy * dy - dz * dz;
+				T cx = (T)1.0 - std::fabs(dx + dx), cy = (T)1.0 - std::fabs(dy + dy), cz = (T)1.0 - std::fabs(dz + dz);
+				value += contribution(latticeSeed, xp, yp, zp, dx, dy, dz, a);
+				T ax = a - cx, ay = a - cy, az = a - cz;
+				if (ax > 0) {
+					value += contribution(latticeSeed, xf, yp, zp, fx, dy, dz, ax);
+					T axy = ax - cy, axz = ax - cz;
+					if (axy > 0) {
+						value += contribution(latticeSeed, xf, yf, zp, fx, fy, dz, axy);
+						T axyz = axy - cz;
+						if (axyz > 0) { value += contribution(latticeSeed, xf, yf, zf, fx, fy, fz, axyz); }
+					}
+					if (axz > 0) { value += contribution(latticeSeed, xf, yp, zf, fx, dy, fz, axz); }
+				}
+				if (ay > 0) {
+					value += contribution(latticeSeed, xp, yf, zp, dx, fy, dz, ay);
+					T ayz = ay - cz;
+					if (ayz > 0) { value += contribution(latticeSeed, xp, yf, zf, dx, fy, fz, ayz); }
+				}
+				if (az > 0) { value += contribution(latticeSeed, xp, yp, zf, dx, dy, fz, az); }
+
+				latticeSeed ^= SEED_FLIP;
+			}
+
+			return value * NORM_CONSTANT;
+		}
+
+		// See Noise<2>::evalBatch. Evaluates eval, not evalImproveXY.
+		void evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const;
+		void evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const;
+
+	};
+
+	// 4D OpenSimplex2 fast generator. The lattice is the union of five copies
+	// of the A4 lattice, each shifted 0.2 further along the main diagonal in
+	// skewed space, and at most two points of each copy are in range: the
+	// nearest vertex of the simplex that contains the input and one of its
+	// neighbours. Moving from one copy to the next only needs that search
+	// repeated from the previous copy's point.
+	template <typename Policy>
+	class Noise2F <4, Policy> : public Noise2Base<Policy> {
+	private:
+
+		typedef Noise2Base<Policy> Base;
+		typedef typename Base::inttype inttype;
+		using Base::PRIME_X;
+		using Base::PRIME_Y;
+		using Base::PRIME_Z;
+		using Base::PRIME_W;
+		using Base::seed;
+		using Base::floorMode;
+
+		static const uint64_t SEED_OFFSET = 0x0E83DC3E0DA7164DULL;
+
+		template <typename T>
+		T evalFloor(RuntimeFloor, T x, T y, T z, T w) const {
+			return (floorMode == FLOOR_STRICT) ? evalKernel<StrictFloor>(x, y, z, w) : evalKernel<FastFloor>(x, y, z, w);
+		}
+
+		template <typename Floor, typename T>
+		T evalFloor(Floor, T x, T y, T z, T w) const {
+			return evalKernel<Floor>(x, y, z, w);
+		}
+
+	public:
+
+		Noise2F(int64_t seed = 0LL) : Base(seed) {}
+
+		template <typename T>
+		T eval(T x, T y, T z, T w) const {
+			return evalFloor(typename Policy::Floor(), x, y, z, w);
+		}
+
+		// As eval, with the floor policy fixed at compile time.
+		template <typename Floor, typename T>
+		T evalKernel(T x, T y, T z, T w) const {
+
+			static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+			OSN_METRICS_ADD(EVAL_4D_SAMPLES, 1);
+
+			// (1 / sqrt(5) - 1) / 4 and (sqrt(5) - 1) / 4.
+			const T SKEW = (T) -0.138196601125011;
+			const T UNSKEW = (T) 0.309016994374947;
+			const T LATTICE_STEP = (T) 0.2;
+			const T RSQUARED = (T) 0.6;
+			const T NORM_CONSTANT = (T) (1.0 / 0.022238082235449);
+
+			T s = SKEW * ((x + y) + (z + w));
+			T xs = x + s, ys = y + s, zs = z + s, ws = w + s;
+			inttype xsb, ysb, zsb, wsb;
+			T xsi = xs - Floor::floor(xs, xsb);
+			T ysi = ys - Floor::floor(ys, ysb);
+			T zsi = zs - Floor::floor(zs, zsb);
+			T wsi = ws - Floor::floor(ws, wsb);
+
+			// Start from the copy whose base simplex is sure to hold a point in
+			// range, judged by which diagonal slab of the cell the input is in.
+			// Copy k is shifted by 0.2 k and hashed with seed + k * SEED_OFFSET.
+			T siSum = (xsi + ysi) + (zsi + wsi);
+			int startingLattice = (int) (siSum * (T)1.25);
+			uint64_t latticeSeed = seed + (uint64_t) startingLattice * SEED_OFFSET;
+			T startingOffset = (T) startingLattice * -LATTICE_STEP;
+			xsi += startingOffset;
+			ysi += startingOffset;
+			zsi += startingOffset;
+			wsi += startingOffset;
+			T ssi = (siSum + startingOffset * (T)4.0) * UNSKEW;
+
+			uint64_t xsvp = (uint64_t) xsb * PRIME_X, ysvp = (uint64_t) ysb * PRIME_Y;
+			uint64_t zsvp = (uint64_t) zsb * PRIME_Z, wsvp = (uint64_t) wsb * PRIME_W;
+
+			T value = (T)0.0;
+			for (int i = 0; ; ++i) {
+				// Step to the nearest vertex of the simplex based at the current point.
+				T score0 = (T)1.0 + ssi * (T) (-1.0 / 0.309016994374947);
+				if (xsi >= ysi && xsi >= zsi && xsi >= wsi && xsi >= score0) {
+					xsvp += PRIME_X;
+					xsi -= (T)1.0;
+					ssi -= UNSKEW;
+				}
+				else if (ysi > xsi && ysi >= zsi && ysi >= wsi && ysi >= score0) {
+					ysvp += PRIME_Y;
+					ysi -= (T)1.0;
+					ssi -= UNSKEW;
+				}
+				else if (zsi > xsi && zsi > ysi && zsi >= wsi && zsi >= score0) {
+					zsvp += PRIME_Z;
+					zsi -= (T)1.0;
+					ssi -= UNSKEW;
+				}
+				else if (wsi > xsi && wsi > ysi && wsi > zsi && wsi >= score0) {
+					wsvp += PRIME_W;
+					wsi -= (T)1.0;
+					ssi -= UNSKEW;
+				}
+
+				T dx = xsi + ssi, dy = ysi + ssi, dz = zsi + ssi, dw = wsi + ssi;
+				T a = RSQUARED - ((dx * dx + dy * dy) + (dz * dz + dw * dw));
+				if (a > 0) {
+					value += pow4(a) * Base::gradient(latticeSeed, xsvp, ysvp, zsvp, wsvp, dx, dy, dz, dw);
+
+					// At most one neighbour is also in range, the one along the lattice
+					// vector e that best matches the offset d, since its attenuation is
+					// a + 2 d.e - 2. The 20 such vectors are the unit steps on a skewed
+					// axis, whose d.e is the offset on that axis plus UNSKEW times the
+					// offsets' sum, and the differences of two of them.
+					T ms = ((dx + dy) + (dz + dw)) * UNSKEW;
+					T m[4] = { dx + ms, dy + ms, dz + ms, dw + ms };
+					int hi = 0, lo = 0;
+					for (int k = 1; k < 4; ++k) {
+						if (m[k] > m[hi]) { hi = k; }
+						if (m[k] < m[lo]) { lo = k; }
+					}
+					bool up = m[hi] >= 0, down = m[lo] <= 0;
+					T dot = (up ? m[hi] : (T)0.0) - (down ? m[lo] : (T)0.0);
+					T b = a + dot + dot - (T)2.0;
+					if (b > 0) {
+						const uint64_t primes[4] = { PRIME_X, PRIME_Y, PRIME_Z, PRIME_W };
+						uint64_t vp[4] = { xsvp, ysvp, zsvp, wsvp };
+						T d[4] = { dx, dy, dz, dw };
+						T shift = (T)0.0;
+						if (up) { vp[hi] += primes[hi]; d[hi] -= (T)1.0; shift -= UNSKEW; }
+						if (down) { vp[lo] -= primes[lo]; d[lo] += (T)1.0; shift += UNSKEW; }
+						value += pow4(b) * Base::gradient(latticeSeed, vp[0], vp[1], vp[2], vp[3],
+							d[0] + shift, d[1] + shift, d[2] + shift, d[3] + shift);
+					}
+				}
+
+				if (i == 4) { break; }
+
+				// On to the next copy down, wrapping from copy 0 to copy 4.
+				xsi += LATTICE_STEP;
+				ysi += LATTICE_STEP;
+				zsi += LATTICE_STEP;
+				wsi += LATTICE_STEP;
+				ssi += LATTICE_STEP * (T)4.0 * UNSKEW;
+				latticeSeed -= SEED_OFFSET;
+				if (i == startingLattice) {
+					xsvp -= PRIME_X;
+					ysvp -= PRIME_Y;
+					zsvp -= PRIME_Z;
+					wsvp -= PRIME_W;
+					latticeSeed += SEED_OFFSET * 5;
+				}
+			}
+
+			return value * NORM_CONSTANT;
+		}
+
+		// See Noise<2>::evalBatch.
+		void evalBatch(const double * x, const double * y, const double * z, const double * w, double * out, size_t count) const;
+		void evalBatch(const float * x, const float * y, const float * z, const float * w, float * out, size_t count) const;
+
+	};
+
+	template <typename Policy>
+	void Noise2F<2, Policy>::evalBatch(const double * x, const double * y, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <typename Policy>
+	void Noise2F<2, Policy>::evalBatch(const float * x, const float * y, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <typename Policy>
+	void Noise2S<2, Policy>::evalBatch(const double * x, const double * y, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <typename Policy>
+	void Noise2S<2, Policy>::evalBatch(const float * x, const float * y, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i]); }
+	}
+
+	template <typename Policy>
+	void Noise2F<3, Policy>::evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <typename Policy>
+	void Noise2F<3, Policy>::evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <typename Policy>
+	void Noise2S<3, Policy>::evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <typename Policy>
+	void Noise2S<3, Policy>::evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i]); }
+	}
+
+	template <typename Policy>
+	void Noise2F<4, Policy>::evalBatch(const double * x, const double * y, const double * z, const double * w, double * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i], w[i]); }
+	}
+
+	template <typename Policy>
+	void Noise2F<4, Policy>::evalBatch(const float * x, const float * y, const float * z, const float * w, float * out, size_t count) const {
+		for (size_t i = 0; i < count; ++i) { out[i] = eval(x[i], y[i], z[i], w[i]); }
+	}
+
+	// The default generators' batch kernels are multiversioned in OpenSimplexNoise.cpp.
+	template <> void Noise2F<2>::evalBatch(const double * x, const double * y, double * out, size_t count) const;
+	template <> void Noise2F<2>::evalBatch(const float * x, const float * y, float * out, size_t count) const;
+	template <> void Noise2S<2>::evalBatch(const double * x, const double * y, double * out, size_t count) const;
+	template <> void Noise2S<2>::evalBatch(const float * x, const float * y, float * out, size_t count) const;
+	template <> void Noise2F<3>::evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const;
+	template <> void Noise2F<3>::evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const;
+	template <> void Noise2S<3>::evalBatch(const double * x, const double * y, const double * z, double * out, size_t count) const;
+	template <> void Noise2S<3>::evalBatch(const float * x, const float * y, const float * z, float * out, size_t count) const;
+	template <> void Noise2F<4>::evalBatch(const double * x, const double * y, const double * z, const double * w, double * out, size_t count) const;
+	template <> void Noise2F<4>::evalBatch(const float * x, const float * y, const float * z, const float * w, float * out, size_t count) const;
+
+}
@@ -0,0 +1,1625 @@
+/*
+ * OpenSimplex (Simplectic) Noise Benchmark in C++
+ *
+ * This file measures the throughput of the OpenSimplexNoise.h generators
+ * and prints one line per benchmark, in nanoseconds per sample. Whether the
+ * paths it times agree is checked by OpenSimplexNoiseCheck.cc.
+ *
+ * Compile with:
+ *   g++ -o OpenSimplexNoiseBench -O2 -pthread OpenSimplexNoiseBench.cc OpenSimplexNoise.cpp
+ *
+ * Add -DOSN_ENABLE_TRACE to also write a Chrome trace of the multithreaded
+ * benchmarks to bench_trace.json.
+ *
+ * Add -DOSN_ENABLE_METRICS to count samples while benchmarking and
+ * print a metrics snapshot at the end. Comparing the eval timings of builds
+ * with and without it gives the overhead of the instrumented hot paths.
+ *
+ * The evalBatch kernels in OpenSimplexNoise.cpp are multiversioned for the
+ * x86-64-v2/v3/v4 levels. Add -DOSN_NO_MULTIVERSIONING (optionally with
+ * -march=x86-64-vN) to benchmark a single version. A profile-guided build
+ * uses this benchmark as the training run:
+ *   g++ -o OpenSimplexNoiseBench -O2 -pthread -fprofile-generate OpenSimplexNoiseBench.cc OpenSimplexNoise.cpp
+ *   ./OpenSimplexNoiseBench
+ *   g++ -o OpenSimplexNoiseBench -O2 -pthread -fprofile-use -fprofile-partial-training OpenSimplexNoiseBench.cc OpenSimplexNoise.cpp
+ * With Clang, use -fprofile-instr-generate, merge the default.profraw with
+ * llvm-profdata merge -o default.profdata, and rebuild with -fprofile-instr-use.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OpenSimplexNoise.h"
+#include "OpenSimplexNoise2.h"
+#include "OpenSimplexNoiseCompressed.h"
+#include "OpenSimplexNoiseDistance.h"
+#include "OpenSimplexNoiseFill.h"
+#include "OpenSimplexNoiseFractal.h"
+#include "OpenSimplexNoiseGraph.h"
+#include "OpenSimplexNoiseGraphFile.h"
+#include "OpenSimplexNoiseMetrics.h"
+#include "OpenSimplexNoiseTrace.h"
+#include "OpenSimplexNoiseTransform.h"
+
+
+const int WIDTH = 512;
+const int HEIGHT = 512;
+const double FEATURE_SIZE = 24.0;
+const int REPEATS = 5;
+
+// Prevents the optimizer from discarding benchmark results.
+volatile double sink;
+
+// Runs fn REPEATS times and reports the fastest run.
+template <typename F>
+double bench (const char * name, long samples, F fn) {
+  double best = 1e300;
+  for (int r = 0; r < REPEATS; ++r) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - begin;
+    best = std::min(best, elapsed.count());
+  }
+  double ns = best / samples;
+  std::cout << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << ns << " ns/sample" << std::setw(10) << (1000.0 / ns) << " Msamples/s" << std::endl;
+  return ns;
+}
+
+void bench_eval (void) {
+
+  OSN::Noise<2> noise2;
+  OSN::Noise<3> noise3;
+  OSN::Noise<4> noise4;
+
+  bench("Noise<2>::eval<double>", (long)WIDTH * HEIGHT, [&] () {
+    double sum = 0.0;
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        sum += noise2.eval(xi / FEATURE_SIZE, yi / FEATURE_SIZE);
+      }
+    }
+    sink = sum;
+  });
+
+  bench("Noise<2>::eval<float>", (long)WIDTH * HEIGHT, [&] () {
+    float sum = 0.0f;
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        sum += noise2.eval(xi / (float)FEATURE_SIZE, yi / (float)FEATURE_SIZE);
+      }
+    }
+    sink = sum;
+  });
+
+  bench("Noise<3>::eval<double>", (long)WIDTH * HEIGHT, [&] () {
+    double sum = 0.0;
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        sum += noise3.eval(xi / FEATURE_SIZE, yi / FEATURE_SIZE, 0.5);
+      }
+    }
+    sink = sum;
+  });
+
+  bench("Noise<4>::eval<double>", (long)WIDTH * HEIGHT, [&] () {
+    double sum = 0.0;
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        sum += noise4.eval(xi / FEATURE_SIZE, yi / FEATURE_SIZE, 0.5, 0.25);
+      }
+    }
+    sink = sum;
+  });
+
+}
+
+// Strict and fast floor policies side by side, selected per generator.
+void bench_floor_modes (void) {
+
+  OSN::Noise<2> noise2;
+  OSN::Noise<3> noise3;
+  OSN::Noise<4> noise4;
+
+  const OSN::FloorMode modes[] = { OSN::FLOOR_STRICT, OSN::FLOOR_FAST };
+  const char * const names[][3] = {
+    { "Noise<2>::eval<double> FLOOR_STRICT", "Noise<3>::eval<double> FLOOR_STRICT", "Noise<4>::eval<double> FLOOR_STRICT" },
+    { "Noise<2>::eval<double> FLOOR_FAST", "Noise<3>::eval<double> FLOOR_FAST", "Noise<4>::eval<double> FLOOR_FAST" }
+  };
+
+  for (int m = 0; m < 2; ++m) {
+    noise2.setFloorMode(modes[m]);
+    noise3.setFloorMode(modes[m]);
+    noise4.setFloorMode(modes[m]);
+    // Offset into negative space so that the fast path's correction runs.
+    bench(names[m][0], (long)WIDTH * HEIGHT, [&] () {
+      double sum = 0.0;
+      for (int yi = 0; yi < HEIGHT; ++yi) {
+        for (int xi = 0; xi < WIDTH; ++xi) {
+          sum += noise2.eval((xi - WIDTH / 2) / FEATURE_SIZE, (yi - HEIGHT / 2) / FEATURE_SIZE);
+        }
+      }
+      sink = sum;
+    });
+    bench(names[m][1], (long)WIDTH * HEIGHT, [&] () {
+      double sum = 0.0;
+      for (int yi = 0; yi < HEIGHT; ++yi) {
+        for (int xi = 0; xi < WIDTH; ++xi) {
+          sum += noise3.eval((xi - WIDTH / 2) / FEATURE_SIZE, (yi - HEIGHT / 2) / FEATURE_SIZE, 0.5);
+        }
+      }
+      sink = sum;
+    });
+    bench(names[m][2], (long)WIDTH * HEIGHT, [&] () {
+      double sum = 0.0;
+      for (int yi = 0; yi < HEIGHT; ++yi) {
+        for (int xi = 0; xi < WIDTH; ++xi) {
+          sum += noise4.eval((xi - WIDTH / 2) / FEATURE_SIZE, (yi - HEIGHT / 2) / FEATURE_SIZE, 0.5, 0.25);
+        }
+      }
+      sink = sum;
+    });
+  }
+
+}
+
+// Positive-only coordinates, 32-bit indices and compact tables for textures.
+struct TexturePolicy : OSN::DefaultPolicy {
+  typedef OSN::PositiveFloor Floor;
+  typedef int32_t Index;
+  typedef uint8_t Perm;
+  typedef float Gradient;
+};
+
+// Exact floor over the full coordinate range for terrain.
+struct TerrainPolicy : OSN::DefaultPolicy {
+  typedef OSN::StrictFloor Floor;
+  typedef double Gradient;
+};
+
+template <typename Policy, typename T>
+T eval_at (const OSN::Noise<2, Policy> & noise, const T * p) { return noise.eval(p[0], p[1]); }
+
+template <typename Policy, typename T>
+T eval_at (const OSN::Noise<3, Policy> & noise, const T * p) { return noise.eval(p[0], p[1], p[2]); }
+
+template <int N, typename Policy, typename T>
+void bench_policy (const char * name) {
+  OSN::Noise<N, Policy> noise;
+  bench(name, (long)WIDTH * HEIGHT, [&] () {
+    T sum = 0;
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        T coords[4] = { (T)(xi / FEATURE_SIZE), (T)(yi / FEATURE_SIZE), (T)0.5, (T)0.25 };
+        sum += eval_at(noise, coords);
+      }
+    }
+    sink = sum;
+  });
+}
+
+void bench_policies (void) {
+  bench_policy<2, OSN::DefaultPolicy, float>("Noise<2, DefaultPolicy>::eval<float>");
+  bench_policy<2, TexturePolicy, float>("Noise<2, TexturePolicy>::eval<float>");
+  bench_policy<2, TerrainPolicy, double>("Noise<2, TerrainPolicy>::eval<double>");
+  bench_policy<3, OSN::DefaultPolicy, float>("Noise<3, DefaultPolicy>::eval<float>");
+  bench_policy<3, TexturePolicy, float>("Noise<3, TexturePolicy>::eval<float>");
+  bench_policy<3, TerrainPolicy, double>("Noise<3, TerrainPolicy>::eval<double>");
+}
+
+// The generic lattice kernel for N = 2..8, to compare with the hand-written
+// kernels at N = 2..4 (the same honeycomb, with different gradients).
+template <int N>
+void bench_lattice (const char * name) {
+  OSN::LatticeNoise<N> noise;
+  bench(name, (long)WIDTH * HEIGHT, [&] () {
+    double sum = 0.0;
+    double x[N];
+    for (int i = 2; i < N; ++i) x[i] = 0.5 / i;
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      x[1] = yi / FEATURE_SIZE;
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        x[0] = xi / FEATURE_SIZE;
+        sum += noise.eval(x);
+      }
+    }
+    sink = sum;
+  });
+}
+
+void bench_generic (void) {
+  bench_lattice<2>("LatticeNoise<2>::eval<double>");
+  bench_lattice<3>("LatticeNoise<3>::eval<double>");
+  bench_lattice<4>("LatticeNoise<4>::eval<double>");
+  bench_lattice<5>("LatticeNoise<5>::eval<double>");
+  bench_lattice<6>("LatticeNoise<6>::eval<double>");
+  bench_lattice<7>("LatticeNoise<7>::eval<double>");
+  bench_lattice<8>("LatticeNoise<8>::eval<double>");
+}
+
+// Animation tracks: 1D noise sampled at a fixed rate, against the common
+// workaround of sampling a 2D generator along a line.
+void bench_tracks (void) {
+
+  const int TRACKS = 64;
+  const int FRAMES = 4096;
+  const double STEP = 1.0 / 60.0;
+
+  OSN::Noise<1> noise1;
+  OSN::Noise<2> noise2;
+  std::vector<double> t(FRAMES), out(FRAMES);
+  for (int i = 0; i < FRAMES; ++i) t[i] = i * STEP;
+
+  bench("Noise<2>::eval<double>(t, constant)", (long)TRACKS * FRAMES, [&] () {
+    double sum = 0.0;
+    for (int k = 0; k < TRACKS; ++k) {
+      for (int i = 0; i < FRAMES; ++i) sum += noise2.eval(t[i], k * 7.31);
+    }
+    sink = sum;
+  });
+
+  bench("Noise<1>::eval<double>", (long)TRACKS * FRAMES, [&] () {
+    double sum = 0.0;
+    for (int k = 0; k < TRACKS; ++k) {
+      for (int i = 0; i < FRAMES; ++i) sum += noise1.eval(t[i] + k * 7.31);
+    }
+    sink = sum;
+  });
+
+  bench("Noise<1>::evalBatch<double>", (long)TRACKS * FRAMES, [&] () {
+    for (int k = 0; k < TRACKS; ++k) noise1.evalBatch(t.data(), out.data(), FRAMES);
+    sink = out[FRAMES - 1];
+  });
+
+  bench("Noise<1>::evalTrack<double>", (long)TRACKS * FRAMES, [&] () {
+    for (int k = 0; k < TRACKS; ++k) noise1.evalTrack(k * 7.31, STEP, out.data(), FRAMES);
+    sink = out[FRAMES - 1];
+  });
+
+}
+
+// A 64-frame seamless loop of a 512x512 image: 4D noise sampled around a
+// circle frame by frame, against the looping 3D generator's frame batch.
+void bench_loop (void) {
+
+  const int FRAMES = 64;
+  const size_t COUNT = (size_t)WIDTH * HEIGHT;
+  const double RADIUS = 2.0;
+
+  OSN::Noise<4> noise4;
+  OSN::LoopingNoise<> loop(int64_t(0), 2);
+  std::vector<double> x(COUNT), y(COUNT), out(COUNT * FRAMES);
+  for (size_t i = 0; i < COUNT; ++i) {
+    x[i] = (i % WIDTH) / FEATURE_SIZE;
+    y[i] = (i / WIDTH) / FEATURE_SIZE;
+  }
+
+  double ns = bench("Noise<4>::eval<double> circle loop", (long)COUNT * FRAMES, [&] () {
+    for (int f = 0; f < FRAMES; ++f) {
+      double angle = 2.0 * M_PI * f / FRAMES;
+      double z = RADIUS * std::cos(angle), w = RADIUS * std::sin(angle);
+      double * frame = &out[f * COUNT];
+      for (size_t i = 0; i < COUNT; ++i) frame[i] = noise4.eval(x[i], y[i], z, w);
+    }
+  });
+  std::cout << "  " << 1e9 / (ns * COUNT) << " frames/s" << std::endl;
+
+  ns = bench("LoopingNoise::evalFrames<double>", (long)COUNT * FRAMES, [&] () {
+    loop.evalFrames(x.data(), y.data(), out.data(), COUNT, FRAMES);
+  });
+  std::cout << "  " << 1e9 / (ns * COUNT) << " frames/s" << std::endl;
+
+}
+
+// The OpenSimplex2 generators against the 2014 ones, on the same grid as
+// bench_eval and bench_batch.
+void bench_simplex2 (void) {
+
+  const size_t COUNT = (size_t)WIDTH * HEIGHT;
+
+  OSN::Noise<2> noise2;
+  OSN::Noise<3> noise3;
+  OSN::Noise<4> noise4;
+  OSN::Noise2F<2> fast2;
+  OSN::Noise2S<2> smooth2;
+  OSN::Noise2F<3> fast3;
+  OSN::Noise2S<3> smooth3;
+  OSN::Noise2F<4> fast4;
+
+  std::vector<double> x(COUNT), y(COUNT), z(COUNT, 0.5), w(COUNT, 0.25), out(COUNT);
+  for (size_t i = 0; i < COUNT; ++i) {
+    x[i] = (i % WIDTH) / FEATURE_SIZE;
+    y[i] = (i / WIDTH) / FEATURE_SIZE;
+  }
+
+  bench("Noise<2>::eval<double>", (long)COUNT, [&] () {
+    double sum = 0.0;
+    for (size_t i = 0; i < COUNT; ++i) sum += noise2.eval(x[i], y[i]);
+    sink = sum;
+  });
+
+  bench("Noise2F<2>::eval<double>", (long)COUNT, [&] () {
+    double sum = 0.0;
+    for (size_t i = 0; i < COUNT; ++i) sum += fast2.eval(x[i], y[i]);
+    sink = sum;
+  });
+
+  bench("Noise2S<2>::eval<double>", (long)COUNT, [&] () {
+    double sum = 0.0;
+    for (size_t i = 0; i < COUNT; ++i) sum += smooth2.eval(x[i], y[i]);
+    sink = sum;
+  });
+
+  bench("Noise<3>::eval<double>", (long)COUNT, [&] () {
+    double sum = 0.0;
+    for (size_t i = 0; i < COUNT; ++i) sum += noise3.eval(x[i], y[i], 0.5);
+    sink = sum;
+  });
+
+  bench("Noise2F<3>::eval<double>", (long)COUNT, [&] () {
+    double sum = 0.0;
+    for (size_t i = 0; i < COUNT; ++i) sum += fast3.eval(x[i], y[i], 0.5);
+    sink = sum;
+  });
+
+  bench("Noise2S<3>::eval<double>", (long)COUNT, [&] () {
+    double sum = 0.0;
+    for (size_t i = 0; i < COUNT; ++i) sum += smooth3.eval(x[i], y[i], 0.5);
+    sink = sum;
+  });
+
+  bench("Noise<4>::eval<double>", (long)COUNT, [&] () {
+    double sum = 0.0;
+    for (size_t i = 0; i < COUNT; ++i) sum += noise4.eval(x[i], y[i], 0.5, 0.25);
+    sink = sum;
+  });
+
+  bench("Noise2F<4>::eval<double>", (long)COUNT, [&] () {
+    double sum = 0.0;
+    for (size_t i = 0; i < COUNT; ++i) sum += fast4.eval(x[i], y[i], 0.5, 0.25);
+    sink = sum;
+  });
+
+  bench("Noise2F<2>::evalBatch<double>", (long)COUNT, [&] () {
+    fast2.evalBatch(x.data(), y.data(), out.data(), COUNT);
+  });
+
+  bench("Noise2S<2>::evalBatch<double>", (long)COUNT, [&] () {
+    smooth2.evalBatch(x.data(), y.data(), out.data(), COUNT);
+  });
+
+  bench("Noise2F<3>::evalBatch<double>", (long)COUNT, [&] () {
+    fast3.evalBatch(x.data(), y.data(), z.data(), out.data(), COUNT);
+  });
+
+  bench("Noise2S<3>::evalBatch<double>", (long)COUNT, [&] () {
+    smooth3.evalBatch(x.data(), y.data(), z.data(), out.data(), COUNT);
+  });
+
+  bench("Noise2F<4>::evalBatch<double>", (long)COUNT, [&] () {
+    fast4.evalBatch(x.data(), y.data(), z.data(), w.data(), out.data(), COUNT);
+  });
+
+}
+
+// Planet textures: a 6 x 256x256 cube map and a 1024x512 equirectangular
+// map of the unit sphere at radius 8, with trig and normalization done per
+// pixel around eval, against the fills.
+void bench_sphere (void) {
+
+  const size_t FACE = 256;
+  const size_t EQ_WIDTH = 1024, EQ_HEIGHT = 512;
+  const double RADIUS = 8.0;
+  const double PI = 3.141592653589793;
+
+  OSN::Noise<3> noise;
+  OSN::Fractal<OSN::Noise<3> > fractal(noise, 4);
+  std::vector<double> pixels(std::max(6 * FACE * FACE, EQ_WIDTH * EQ_HEIGHT));
+  OSN::ImageView<double> faces[6] = {
+    OSN::ImageView<double>(&pixels[0 * FACE * FACE], FACE, FACE),
+    OSN::ImageView<double>(&pixels[1 * FACE * FACE], FACE, FACE),
+    OSN::ImageView<double>(&pixels[2 * FACE * FACE], FACE, FACE),
+    OSN::ImageView<double>(&pixels[3 * FACE * FACE], FACE, FACE),
+    OSN::ImageView<double>(&pixels[4 * FACE * FACE], FACE, FACE),
+    OSN::ImageView<double>(&pixels[5 * FACE * FACE], FACE, FACE)
+  };
+  OSN::ImageView<double> equirect(pixels.data(), EQ_WIDTH, EQ_HEIGHT);
+
+  // Per face: major axis, then the axes along columns and rows.
+  static const int AXES[6][3][3] = {
+    { {  1,  0,  0 }, {  0,  0, -1 }, {  0, -1,  0 } },
+    { { -1,  0,  0 }, {  0,  0,  1 }, {  0, -1,  0 } },
+    { {  0,  1,  0 }, {  1,  0,  0 }, {  0,  0,  1 } },
+    { {  0, -1,  0 }, {  1,  0,  0 }, {  0,  0, -1 } },
+    { {  0,  0,  1 }, {  1,  0,  0 }, {  0, -1,  0 } },
+    { {  0,  0, -1 }, { -1,  0,  0 }, {  0, -1,  0 } }
+  };
+
+  bench("cube map, per-pixel eval", (long)(6 * FACE * FACE), [&] () {
+    for (int f = 0; f < 6; ++f) {
+      for (size_t j = 0; j < FACE; ++j) {
+        for (size_t i = 0; i < FACE; ++i) {
+          double u = (i + 0.5) * 2.0 / FACE - 1.0, v = (j + 0.5) * 2.0 / FACE - 1.0;
+          double p[3];
+          for (int d = 0; d < 3; ++d) p[d] = AXES[f][0][d] + u * AXES[f][1][d] + v * AXES[f][2][d];
+          double scale = RADIUS / std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+          faces[f](i, j) = noise.eval(p[0] * scale, p[1] * scale, p[2] * scale);
+        }
+      }
+    }
+  });
+
+  bench("fillCubeMap<double>", (long)(6 * FACE * FACE), [&] () {
+    OSN::fillCubeMap(noise, RADIUS, faces);
+  });
+
+  bench("equirect, per-pixel eval", (long)EQ_WIDTH * EQ_HEIGHT, [&] () {
+    for (size_t j = 0; j < EQ_HEIGHT; ++j) {
+      for (size_t i = 0; i < EQ_WIDTH; ++i) {
+        double longitude = -PI + (i + 0.5) * 2.0 * PI / EQ_WIDTH;
+        double latitude = 0.5 * PI - (j + 0.5) * PI / EQ_HEIGHT;
+        equirect(i, j) = noise.eval(RADIUS * std::cos(latitude) * std::cos(longitude),
+                                    RADIUS * std::cos(latitude) * std::sin(longitude),
+                                    RADIUS * std::sin(latitude));
+      }
+    }
+  });
+
+  bench("fillEquirect<double>", (long)EQ_WIDTH * EQ_HEIGHT, [&] () {
+    OSN::fillEquirect(noise, RADIUS, equirect);
+  });
+
+  bench("equirect 4 octaves, per-pixel eval", (long)EQ_WIDTH * EQ_HEIGHT, [&] () {
+    for (size_t j = 0; j < EQ_HEIGHT; ++j) {
+      for (size_t i = 0; i < EQ_WIDTH; ++i) {
+        double longitude = -PI + (i + 0.5) * 2.0 * PI / EQ_WIDTH;
+        double latitude = 0.5 * PI - (j + 0.5) * PI / EQ_HEIGHT;
+        equirect(i, j) = fractal.eval(RADIUS * std::cos(latitude) * std::cos(longitude),
+                                      RADIUS * std::cos(latitude) * std::sin(longitude),
+                                      RADIUS * std::sin(latitude));
+      }
+    }
+  });
+
+  bench("fillEquirect<double> 4 octaves", (long)EQ_WIDTH * EQ_HEIGHT, [&] () {
+    OSN::fillEquirect(fractal, RADIUS, equirect);
+  });
+
+}
+
+// Terrain curvature: value, gradient and Hessian of every texel, from a
+// finite-difference stencil of eval calls (9 in 2D, 19 in 3D) against the
+// analytic hessian and fillHessianGrid.
+void bench_hessian (void) {
+
+  const double STEP = 1.0 / FEATURE_SIZE;
+  const double H = 1e-3;
+
+  OSN::Noise<2> noise2;
+  OSN::Noise<3> noise3;
+  std::vector<OSN::Derivatives<double, 2> > grid2((size_t)WIDTH * HEIGHT);
+  std::vector<OSN::Derivatives<double, 3> > grid3((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<OSN::Derivatives<double, 2> > view2(grid2.data(), WIDTH, HEIGHT);
+  OSN::ImageView<OSN::Derivatives<double, 3> > view3(grid3.data(), WIDTH, HEIGHT);
+
+  bench("Noise<2> 9-sample stencil", (long)WIDTH * HEIGHT, [&] () {
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        double x = xi * STEP, y = yi * STEP;
+        double s[3][3];
+        for (int j = 0; j < 3; ++j) {
+          for (int i = 0; i < 3; ++i) { s[j][i] = noise2.eval(x + (i - 1) * H, y + (j - 1) * H); }
+        }
+        OSN::Derivatives<double, 2> & d = view2(xi, yi);
+        d.value = s[1][1];
+        d.gradient[0] = (s[1][2] - s[1][0]) / (2.0 * H);
+        d.gradient[1] = (s[2][1] - s[0][1]) / (2.0 * H);
+        d.hessian[0] = (s[1][2] - 2.0 * s[1][1] + s[1][0]) / (H * H);
+        d.hessian[1] = (s[2][2] - s[2][0] - s[0][2] + s[0][0]) / (4.0 * H * H);
+        d.hessian[2] = (s[2][1] - 2.0 * s[1][1] + s[0][1]) / (H * H);
+      }
+    }
+  });
+
+  bench("Noise<2>::hessian<double>", (long)WIDTH * HEIGHT, [&] () {
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) { noise2.hessian(xi * STEP, yi * STEP, view2(xi, yi)); }
+    }
+  });
+
+  bench("fillHessianGrid<double> 2D", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillHessianGrid(noise2, 0.0, 0.0, STEP, view2);
+  });
+
+  bench("Noise<3> 19-sample stencil", (long)WIDTH * HEIGHT, [&] () {
+    const double z = 0.5;
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        double p[3] = { xi * STEP, yi * STEP, z };
+        OSN::Derivatives<double, 3> & d = view3(xi, yi);
+        double center = noise3.eval(p[0], p[1], p[2]);
+        d.value = center;
+        int h = 0;
+        for (int j = 0; j < 3; ++j) {
+          double q[3] = { p[0], p[1], p[2] };
+          q[j] += H;
+          double forward = noise3.eval(q[0], q[1], q[2]);
+          q[j] -= 2.0 * H;
+          double backward = noise3.eval(q[0], q[1], q[2]);
+          d.gradient[j] = (forward - backward) / (2.0 * H);
+          d.hessian[h++] = (forward - 2.0 * center + backward) / (H * H);
+          for (int k = j + 1; k < 3; ++k) {
+            double sum = 0.0;
+            for (int a = -1; a <= 1; a += 2) {
+              for (int b = -1; b <= 1; b += 2) {
+                double r[3] = { p[0], p[1], p[2] };
+                r[j] += a * H;
+                r[k] += b * H;
+                sum += a * b * noise3.eval(r[0], r[1], r[2]);
+              }
+            }
+            d.hessian[h++] = sum / (4.0 * H * H);
+          }
+        }
+      }
+    }
+  });
+
+  bench("Noise<3>::hessian<double>", (long)WIDTH * HEIGHT, [&] () {
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) { noise3.hessian(xi * STEP, yi * STEP, 0.5, view3(xi, yi)); }
+    }
+  });
+
+  bench("fillHessianGrid<double> 3D", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillHessianGrid(noise3, 0.0, 0.0, 0.5, STEP, view3);
+  });
+
+  sink = grid2[WIDTH + 1].hessian[1] + grid3[WIDTH + 1].hessian[4];
+
+}
+
+// Derivative-damped fBm over a 512x512 grid, 6 octaves: per octave an eval
+// and a deval (2D) or an eval and three forward differences (3D), against
+// the fused DerivativeFractal kernel.
+void bench_derivative_fractal (void) {
+
+  const int OCTAVES = 6;
+  const double DAMPING = 1.0;
+  const double STEP = 1.0 / FEATURE_SIZE;
+
+  OSN::Noise<2> noise2;
+  OSN::Noise<3> noise3;
+  OSN::DerivativeFractal<OSN::Noise<2> > fractal2(noise2, OCTAVES, 2.0, 0.5, DAMPING);
+  OSN::DerivativeFractal<OSN::Noise<3> > fractal3(noise3, OCTAVES, 2.0, 0.5, DAMPING);
+  const double normalization = 1.0 / (2.0 - std::pow(0.5, OCTAVES - 1));
+  std::vector<OSN::ValueGradient<double, 2> > grid2((size_t)WIDTH * HEIGHT);
+  std::vector<OSN::ValueGradient<double, 3> > grid3((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<OSN::ValueGradient<double, 2> > view2(grid2.data(), WIDTH, HEIGHT);
+  OSN::ImageView<OSN::ValueGradient<double, 3> > view3(grid3.data(), WIDTH, HEIGHT);
+
+  bench("damped fBm 2D, eval + deval per octave", (long)WIDTH * HEIGHT, [&] () {
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        OSN::ValueGradient<double, 2> & sum = view2(xi, yi);
+        sum.value = sum.gradient[0] = sum.gradient[1] = 0.0;
+        double frequency = 1.0, amplitude = normalization;
+        for (int o = 0; o < OCTAVES; ++o) {
+          double x = xi * STEP * frequency, y = yi * STEP * frequency;
+          double gradient[2];
+          double value = noise2.eval(x, y);
+          noise2.deval(x, y, gradient);
+          double weight = amplitude / (1.0 + DAMPING * (sum.gradient[0] * sum.gradient[0] + sum.gradient[1] * sum.gradient[1]));
+          sum.value += weight * value;
+          sum.gradient[0] += weight * frequency * gradient[0];
+          sum.gradient[1] += weight * frequency * gradient[1];
+          frequency *= 2.0;
+          amplitude *= 0.5;
+        }
+      }
+    }
+  });
+
+  bench("DerivativeFractal<Noise<2>>::evalGradient", (long)WIDTH * HEIGHT, [&] () {
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) { fractal2.evalGradient(xi * STEP, yi * STEP, view2(xi, yi)); }
+    }
+  });
+
+  bench("fillGradientGrid<double> 2D damped fBm", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGradientGrid(fractal2, 0.0, 0.0, STEP, view2);
+  });
+
+  bench("damped fBm 3D, 4 evals per octave", (long)WIDTH * HEIGHT, [&] () {
+    const double H = 1e-4;
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        OSN::ValueGradient<double, 3> & sum = view3(xi, yi);
+        sum.value = sum.gradient[0] = sum.gradient[1] = sum.gradient[2] = 0.0;
+        double frequency = 1.0, amplitude = normalization;
+        for (int o = 0; o < OCTAVES; ++o) {
+          double x = xi * STEP * frequency, y = yi * STEP * frequency, z = 0.5 * frequency;
+          double value = noise3.eval(x, y, z);
+          double gradient[3] = {
+            (noise3.eval(x + H, y, z) - value) / H,
+            (noise3.eval(x, y + H, z) - value) / H,
+            (noise3.eval(x, y, z + H) - value) / H
+          };
+          double slope = sum.gradient[0] * sum.gradient[0] + sum.gradient[1] * sum.gradient[1] + sum.gradient[2] * sum.gradient[2];
+          double weight = amplitude / (1.0 + DAMPING * slope);
+          sum.value += weight * value;
+          for (int d = 0; d < 3; ++d) { sum.gradient[d] += weight * frequency * gradient[d]; }
+          frequency *= 2.0;
+          amplitude *= 0.5;
+        }
+      }
+    }
+  });
+
+  bench("fillGradientGrid<double> 3D damped fBm", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGradientGrid(fractal3, 0.0, 0.0, 0.5, STEP, view3);
+  });
+
+  // Undamped heights only: the same sum as Fractal.
+  OSN::DerivativeFractal<OSN::Noise<2> > undamped(noise2, OCTAVES);
+  OSN::Fractal<OSN::Noise<2> > plain(noise2, OCTAVES);
+  std::vector<double> heights((size_t)WIDTH * HEIGHT), reference((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> heightView(heights.data(), WIDTH, HEIGHT), referenceView(reference.data(), WIDTH, HEIGHT);
+  bench("fillGrid<double> 2D fBm, Fractal", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGrid(plain, 0.0, 0.0, STEP, referenceView);
+  });
+  bench("fillGrid<double> 2D fBm, DerivativeFractal", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGrid(undamped, 0.0, 0.0, STEP, heightView);
+  });
+  sink = grid2[WIDTH + 1].gradient[0] + grid3[WIDTH + 1].gradient[2];
+
+}
+
+// Fills heights with a one-texel border, then finds each texel's normal
+// with a Sobel filter. Keeps the normals as doubles, for comparison, as
+// well as packing them.
+template <typename Source>
+void heights_then_sobel (const Source & source, double step, double strength, const OSN::ImageView<double> & heights,
+                         std::vector<double> & normals, const OSN::ImageView<OSN::NormalRGB8> & out) {
+  OSN::fillGrid(source, -step, -step, step, heights);
+  const double scale = strength / (8.0 * step);
+  for (size_t yi = 0; yi < out.height; ++yi) {
+    const double * above = heights.row(yi);
+    const double * here = heights.row(yi + 1);
+    const double * below = heights.row(yi + 2);
+    for (size_t xi = 0; xi < out.width; ++xi) {
+      double dx = (above[xi + 2] + 2.0 * here[xi + 2] + below[xi + 2]) - (above[xi] + 2.0 * here[xi] + below[xi]);
+      double dy = (below[xi] + 2.0 * below[xi + 1] + below[xi + 2]) - (above[xi] + 2.0 * above[xi + 1] + above[xi + 2]);
+      double nx = -scale * dx, ny = -scale * dy;
+      double length = 1.0 / std::sqrt(nx * nx + ny * ny + 1.0);
+      double * n = &normals[3 * (yi * out.width + xi)];
+      n[0] = nx * length;
+      n[1] = ny * length;
+      n[2] = length;
+      OSN::NormalRGB8 & texel = out(xi, yi);
+      texel.r = (uint8_t)((n[0] * 0.5 + 0.5) * 255.0 + 0.5);
+      texel.g = (uint8_t)((n[1] * 0.5 + 0.5) * 255.0 + 0.5);
+      texel.b = (uint8_t)((n[2] * 0.5 + 0.5) * 255.0 + 0.5);
+    }
+  }
+}
+
+// 512x512 normal maps of one octave and of 6 octaves of fBm: heights from
+// fillGrid followed by a Sobel filter, against fillNormalMap straight from
+// the analytic gradient. Also reports how far the Sobel normals are from
+// the analytic ones.
+void bench_normal_map (void) {
+
+  const double STEP = 1.0 / FEATURE_SIZE;
+  const double STRENGTH = 0.5;
+  const size_t PADDED = (size_t)(WIDTH + 2);
+
+  OSN::Noise<2> noise;
+  OSN::DerivativeFractal<OSN::Noise<2> > fractal(noise, 6);
+  std::vector<double> heights(PADDED * (HEIGHT + 2));
+  OSN::ImageView<double> heightView(heights.data(), PADDED, HEIGHT + 2);
+  std::vector<OSN::NormalRGB8> rgb((size_t)WIDTH * HEIGHT);
+  std::vector<OSN::NormalOct16> oct((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<OSN::NormalRGB8> rgbView(rgb.data(), WIDTH, HEIGHT);
+  OSN::ImageView<OSN::NormalOct16> octView(oct.data(), WIDTH, HEIGHT);
+  std::vector<double> sobel(3 * (size_t)WIDTH * HEIGHT);
+
+  bench("normals 1 octave, heights + Sobel", (long)WIDTH * HEIGHT, [&] () {
+    heights_then_sobel(noise, STEP, STRENGTH, heightView, sobel, rgbView);
+  });
+  bench("fillNormalMap 1 octave, RGB8", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillNormalMap(noise, 0.0, 0.0, STEP, STRENGTH, rgbView);
+  });
+  bench("fillNormalMap 1 octave, octahedral RG16", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillNormalMap(noise, 0.0, 0.0, STEP, STRENGTH, octView);
+  });
+  bench("normals 6 octaves, heights + Sobel", (long)WIDTH * HEIGHT, [&] () {
+    heights_then_sobel(fractal, STEP, STRENGTH, heightView, sobel, rgbView);
+  });
+  bench("fillNormalMap 6 octaves, RGB8", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillNormalMap(fractal, 0.0, 0.0, STEP, STRENGTH, rgbView);
+  });
+  bench("fillNormalMap 6 octaves, octahedral RG16", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillNormalMap(fractal, 0.0, 0.0, STEP, STRENGTH, octView);
+  });
+
+  // Angle between the Sobel normals of the last run and the analytic ones.
+  double total = 0.0, worst = 0.0;
+  for (int yi = 0; yi < HEIGHT; ++yi) {
+    for (int xi = 0; xi < WIDTH; ++xi) {
+      OSN::ValueGradient<double, 2> exact;
+      fractal.evalGradient(xi * STEP, yi * STEP, exact);
+      double nx = -STRENGTH * exact.gradient[0], ny = -STRENGTH * exact.gradient[1];
+      const double * n = &sobel[3 * ((size_t)yi * WIDTH + xi)];
+      double cosine = (n[0] * nx + n[1] * ny + n[2]) / std::sqrt(nx * nx + ny * ny + 1.0);
+      double degrees = std::acos(std::min(cosine, 1.0)) * (180.0 / 3.141592653589793);
+      total += degrees;
+      worst = std::max(worst, degrees);
+    }
+  }
+  std::cout << "Sobel normal error, 6 octaves: mean " << std::setprecision(2) << total / ((double)WIDTH * HEIGHT)
+            << " deg, max " << worst << " deg" << std::endl;
+
+  sink = rgb[WIDTH + 1].r + oct[WIDTH + 1].y;
+
+}
+
+// A representative terrain: continents from a low-frequency fractal, hills
+// and domain-warped ridged mountains on land, a shelf in the ocean, and a
+// final height curve. A larger continent scale gives more coastline.
+OSN::Graph::Node build_terrain_graph (OSN::Graph & graph, double continentScale = 0.25) {
+  OSN::Graph::Node x = graph.x(), y = graph.y();
+  OSN::Graph::Node continents = graph.fractal(1, 4, 2.0, 0.5, graph.scaleBias(x, continentScale, 0.0), graph.scaleBias(y, continentScale, 0.0));
+  OSN::Graph::Node warpX = graph.noise(2, x, y);
+  OSN::Graph::Node warpY = graph.noise(3, graph.scaleBias(x, 1.0, 5.2), y);
+  OSN::Graph::Node ridges = graph.fractal(4, 5, 2.0, 0.5, graph.warp(x, warpX, 0.8), graph.warp(y, warpY, 0.8));
+  OSN::Graph::Node mountains = graph.scaleBias(graph.abs(ridges), -1.0, 1.0);
+  OSN::Graph::Node hills = graph.scaleBias(graph.fractal(5, 3, 2.0, 0.5, x, y), 0.25, 0.1);
+  OSN::Graph::Node land = graph.select(hills, mountains, continents, 0.2, 0.1);
+  OSN::Graph::Node ocean = graph.scaleBias(continents, 0.5, -0.3);
+  OSN::Graph::Node terrain = graph.select(ocean, land, continents, 0.0, 0.02);
+  static const double CURVE_X[4] = { -1.0, 0.0, 0.5, 1.0 };
+  static const double CURVE_Y[4] = { -1.0, 0.0, 0.2, 1.0 };
+  OSN::Graph::Node height = graph.curve(terrain, CURVE_X, CURVE_Y, 4);
+  graph.setOutput(height);
+  return height;
+}
+
+double smooth_select (double low, double high, double control, double threshold, double falloff) {
+  double t = (control - (threshold - falloff)) / (2.0 * falloff);
+  t = std::min(std::max(t, 0.0), 1.0);
+  t = t * t * (3.0 - 2.0 * t);
+  return low + (high - low) * t;
+}
+
+// The terrain graph written by hand, one sample at a time.
+struct ScalarTerrain {
+  OSN::Noise<2> n1, n2, n3, n4, n5;
+  OSN::Fractal<OSN::Noise<2> > continents, ridges, hills;
+  ScalarTerrain (void) : n1(int64_t(1)), n2(int64_t(2)), n3(int64_t(3)), n4(int64_t(4)), n5(int64_t(5)),
+                         continents(n1, 4), ridges(n4, 5), hills(n5, 3) {}
+  double eval (double x, double y) const {
+    double c = continents.eval(x * 0.25, y * 0.25);
+    double wx = n2.eval(x, y), wy = n3.eval(x + 5.2, y);
+    double mountains = 1.0 - std::fabs(ridges.eval(x + 0.8 * wx, y + 0.8 * wy));
+    double h = hills.eval(x, y) * 0.25 + 0.1;
+    double land = smooth_select(h, mountains, c, 0.2, 0.1);
+    double terrain = smooth_select(c * 0.5 - 0.3, land, c, 0.0, 0.02);
+    if (terrain <= -1.0) { return -1.0; }
+    if (terrain <= 0.0) { return terrain; }
+    if (terrain <= 0.5) { return terrain * 0.4; }
+    if (terrain <= 1.0) { return 0.2 + (terrain - 0.5) * 1.6; }
+    return 1.0;
+  }
+};
+
+// Encodes a float image whose size is a multiple of 4 as BC4, a block at a
+// time, as a separate compressor would.
+void encode_bc4_image (const OSN::ImageView<float> & image, const OSN::ImageView<OSN::BC4Block> & out) {
+  float block[16];
+  for (size_t by = 0; by < out.height; ++by) {
+    for (size_t bx = 0; bx < out.width; ++bx) {
+      for (int i = 0; i < 16; ++i) { block[i] = image(4 * bx + i % 4, 4 * by + i / 4); }
+      OSN::encodeBC4(block, out(bx, by));
+    }
+  }
+}
+
+// Largest and root mean square difference between the decoded blocks and
+// the image, in 8-bit steps.
+void bc4_error (const OSN::ImageView<OSN::BC4Block> & blocks, const OSN::ImageView<float> & image, double & worst, double & rms) {
+  float decoded[16];
+  double sum = 0.0;
+  worst = 0.0;
+  for (size_t by = 0; by < blocks.height; ++by) {
+    for (size_t bx = 0; bx < blocks.width; ++bx) {
+      OSN::decodeBC4(blocks(bx, by), decoded);
+      for (int i = 0; i < 16; ++i) {
+        double v = std::min(std::max((double)image(4 * bx + i % 4, 4 * by + i / 4), -1.0), 1.0);
+        double e = std::fabs(decoded[i] - v) * 127.5;
+        worst = std::max(worst, e);
+        sum += e * e;
+      }
+    }
+  }
+  rms = std::sqrt(sum / (16.0 * blocks.width * blocks.height));
+}
+
+// BC4 and BC5 textures encoded as they are sampled, against filling a float
+// image and compressing it afterwards.
+void bench_compressed (void) {
+
+  const float STEP = (float)(1.0 / FEATURE_SIZE);
+  const size_t BLOCKS_WIDE = WIDTH / 4, BLOCKS_HIGH = HEIGHT / 4;
+
+  OSN::Noise<2> noise(int64_t(0)), other(int64_t(1));
+  std::vector<float> pixels((size_t)WIDTH * HEIGHT), green((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<float> view(pixels.data(), WIDTH, HEIGHT), greenView(green.data(), WIDTH, HEIGHT);
+  std::vector<OSN::BC4Block> twoPass(BLOCKS_WIDE * BLOCKS_HIGH), fused(BLOCKS_WIDE * BLOCKS_HIGH);
+  std::vector<OSN::BC5Block> twoPass5(BLOCKS_WIDE * BLOCKS_HIGH), fused5(BLOCKS_WIDE * BLOCKS_HIGH);
+  OSN::ImageView<OSN::BC4Block> twoPassView(twoPass.data(), BLOCKS_WIDE, BLOCKS_HIGH), fusedView(fused.data(), BLOCKS_WIDE, BLOCKS_HIGH);
+  OSN::ImageView<OSN::BC5Block> fused5View(fused5.data(), BLOCKS_WIDE, BLOCKS_HIGH);
+
+  bench("BC4, fillGrid then encode", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGrid(noise, 0.0f, 0.0f, STEP, view);
+    encode_bc4_image(view, twoPassView);
+  });
+
+  bench("BC4, fillBC4Grid", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillBC4Grid(noise, 0.0f, 0.0f, STEP, fusedView);
+  });
+
+  bench("BC5 two seeds, fillGrid twice then encode", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGrid(noise, 0.0f, 0.0f, STEP, view);
+    OSN::fillGrid(other, 0.0f, 0.0f, STEP, greenView);
+    for (size_t by = 0; by < BLOCKS_HIGH; ++by) {
+      for (size_t bx = 0; bx < BLOCKS_WIDE; ++bx) {
+        float red[16], grn[16];
+        for (int i = 0; i < 16; ++i) {
+          red[i] = view(4 * bx + i % 4, 4 * by + i / 4);
+          grn[i] = greenView(4 * bx + i % 4, 4 * by + i / 4);
+        }
+        OSN::encodeBC4(red, twoPass5[bx + by * BLOCKS_WIDE].red);
+        OSN::encodeBC4(grn, twoPass5[bx + by * BLOCKS_WIDE].green);
+      }
+    }
+  });
+
+  bench("BC5 two seeds, fillBC5Grid", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillBC5Grid(noise, other, 0.0f, 0.0f, STEP, fused5View);
+  });
+
+  bool same = std::memcmp(twoPass.data(), fused.data(), twoPass.size() * sizeof(OSN::BC4Block)) == 0 &&
+              std::memcmp(twoPass5.data(), fused5.data(), twoPass5.size() * sizeof(OSN::BC5Block)) == 0;
+  double worst = 0.0, rms = 0.0;
+  bc4_error(fusedView, view, worst, rms);
+  std::cout << "BC4 encode error: max " << std::setprecision(2) << worst << ", rms " << rms
+            << " 8-bit steps; fused blocks " << (same ? "identical to" : "DIFFER from") << " two-pass" << std::endl;
+
+  // Normal x and y against the normals the gradients give.
+  std::vector<OSN::ValueGradient<float, 2> > gradients((size_t)WIDTH * HEIGHT);
+  OSN::fillGradientGrid(noise, 0.0f, 0.0f, STEP, OSN::ImageView<OSN::ValueGradient<float, 2> >(gradients.data(), WIDTH, HEIGHT));
+  const float STRENGTH = 0.5f;
+  bench("BC5 normal map, fillBC5NormalMap", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillBC5NormalMap(noise, 0.0f, 0.0f, STEP, STRENGTH, fused5View);
+  });
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    float nx = -STRENGTH * gradients[i].gradient[0], ny = -STRENGTH * gradients[i].gradient[1];
+    float scale = 1.0f / std::sqrt(nx * nx + ny * ny + 1.0f);
+    pixels[i] = nx * scale;
+    green[i] = ny * scale;
+  }
+  std::vector<OSN::BC4Block> channel(BLOCKS_WIDE * BLOCKS_HIGH);
+  OSN::ImageView<OSN::BC4Block> channelView(channel.data(), BLOCKS_WIDE, BLOCKS_HIGH);
+  double worstX = 0.0, rmsX = 0.0, worstY = 0.0, rmsY = 0.0;
+  for (size_t i = 0; i < channel.size(); ++i) { channel[i] = fused5[i].red; }
+  bc4_error(channelView, view, worstX, rmsX);
+  for (size_t i = 0; i < channel.size(); ++i) { channel[i] = fused5[i].green; }
+  bc4_error(channelView, greenView, worstY, rmsY);
+  std::cout << "BC5 normal encode error: x max " << worstX << ", rms " << rmsX << "; y max " << worstY << ", rms " << rmsY
+            << " 8-bit steps" << std::endl;
+
+  sink = fused[1].bytes[0] + fused5[1].green.bytes[0];
+
+}
+
+// Grids and volumes written in Morton-ordered tiles, against row order and
+// against row order reshuffled into tiles afterwards, and a consumer that
+// reads every tile in Z-order from each layout.
+void bench_morton (void) {
+
+  const size_t SIZE = 2048, TILE = 32;
+  const size_t COUNT = SIZE * SIZE;
+  const float STEP = (float)(1.0 / FEATURE_SIZE);
+
+  OSN::Noise<2> noise2;
+  std::vector<float> rows(COUNT), tiles(COUNT), shuffled(COUNT);
+  OSN::ImageView<float> rowView(rows.data(), SIZE, SIZE);
+
+  bench("2048^2 grid, fillGrid", (long)COUNT, [&] () {
+    OSN::fillGrid(noise2, 0.0f, 0.0f, STEP, rowView);
+  });
+  bench("2048^2 grid, fillGrid then reshuffle", (long)COUNT, [&] () {
+    OSN::fillGrid(noise2, 0.0f, 0.0f, STEP, rowView);
+    for (size_t y = 0; y < SIZE; ++y) {
+      for (size_t x = 0; x < SIZE; ++x) { shuffled[OSN::mortonIndex(x, y, SIZE, TILE)] = rows[x + y * SIZE]; }
+    }
+  });
+  bench("2048^2 grid, fillMortonGrid 32x32 tiles", (long)COUNT, [&] () {
+    OSN::fillMortonGrid(noise2, 0.0f, 0.0f, STEP, SIZE, SIZE, TILE, tiles.data());
+  });
+
+  // Bounds of every tile, visiting its pixels in Z-order.
+  std::vector<float> bounds(2 * COUNT / (TILE * TILE));
+  bench("tile bounds in Z-order, from row order", (long)COUNT, [&] () {
+    for (size_t t = 0; t < COUNT / (TILE * TILE); ++t) {
+      const size_t bx = (t % (SIZE / TILE)) * TILE, by = (t / (SIZE / TILE)) * TILE;
+      float lo = 1e30f, hi = -1e30f;
+      for (size_t m = 0; m < TILE * TILE; ++m) {
+        size_t x = 0, y = 0;
+        for (size_t b = 0; (1u << b) < TILE; ++b) {
+          x |= ((m >> (2 * b)) & 1) << b;
+          y |= ((m >> (2 * b + 1)) & 1) << b;
+        }
+        float v = rows[bx + x + (by + y) * SIZE];
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+      }
+      bounds[2 * t] = lo;
+      bounds[2 * t + 1] = hi;
+    }
+  });
+  bench("tile bounds in Z-order, from Morton tiles", (long)COUNT, [&] () {
+    for (size_t t = 0; t < COUNT / (TILE * TILE); ++t) {
+      const float * tile = &tiles[t * TILE * TILE];
+      float lo = 1e30f, hi = -1e30f;
+      for (size_t m = 0; m < TILE * TILE; ++m) {
+        lo = std::min(lo, tile[m]);
+        hi = std::max(hi, tile[m]);
+      }
+      bounds[2 * t] = lo;
+      bounds[2 * t + 1] = hi;
+    }
+  });
+
+  const size_t DEPTH = 128, BRICK = 8;
+  const size_t VOXELS = DEPTH * DEPTH * DEPTH;
+  OSN::Noise<3> noise3;
+  std::vector<float> volume(VOXELS), bricks(VOXELS), shuffledVolume(VOXELS);
+  bench("128^3 volume, fillVolume", (long)VOXELS, [&] () {
+    OSN::fillVolume(noise3, 0.0f, 0.0f, 0.0f, STEP, DEPTH, DEPTH, DEPTH, volume.data());
+  });
+  bench("128^3 volume, fillVolume then reshuffle", (long)VOXELS, [&] () {
+    OSN::fillVolume(noise3, 0.0f, 0.0f, 0.0f, STEP, DEPTH, DEPTH, DEPTH, volume.data());
+    for (size_t z = 0; z < DEPTH; ++z) {
+      for (size_t y = 0; y < DEPTH; ++y) {
+        for (size_t x = 0; x < DEPTH; ++x) {
+          shuffledVolume[OSN::mortonIndex(x, y, z, DEPTH, DEPTH, BRICK)] = volume[x + (y + z * DEPTH) * DEPTH];
+        }
+      }
+    }
+  });
+  bench("128^3 volume, fillMortonVolume 8^3 bricks", (long)VOXELS, [&] () {
+    OSN::fillMortonVolume(noise3, 0.0f, 0.0f, 0.0f, STEP, DEPTH, DEPTH, DEPTH, BRICK, bricks.data());
+  });
+  sink = tiles[1] + bricks[1] + bounds[1];
+
+}
+
+// Min, max, mean and histogram of a heightmap gathered by the fill, against
+// a second pass over the filled image.
+void bench_fill_stats (void) {
+
+  const size_t SIZE = 2048;
+  const float STEP = (float)(1.0 / FEATURE_SIZE);
+
+  OSN::Noise<2> noise;
+  OSN::Fractal<OSN::Noise<2> > fractal(noise, 4);
+  std::vector<float> pixels(SIZE * SIZE);
+  OSN::ImageView<float> view(pixels.data(), SIZE, SIZE);
+  OSN::FillStats<float> scanned, fused;
+
+  bench("2048^2 fractal, fillGrid then scan", (long)(SIZE * SIZE), [&] () {
+    OSN::fillGrid(fractal, 0.0f, 0.0f, STEP, view);
+    scanned = OSN::FillStats<float>();
+    scanned.add(pixels.data(), pixels.size());
+  });
+  bench("2048^2 fractal, fillGrid with FillStats", (long)(SIZE * SIZE), [&] () {
+    fused = OSN::FillStats<float>();
+    OSN::fillGrid(fractal, 0.0f, 0.0f, STEP, view, fused);
+  });
+  bench("FillStats::add alone", (long)(SIZE * SIZE), [&] () {
+    OSN::FillStats<float> stats;
+    stats.add(pixels.data(), pixels.size());
+    sink = stats.getMean();
+  });
+
+  const std::vector<uint64_t> & histogram = fused.getHistogram();
+  size_t peak = 0;
+  for (size_t b = 1; b < histogram.size(); ++b) { peak = (histogram[b] > histogram[peak]) ? b : peak; }
+  std::cout << "fractal stats: min " << std::setprecision(4) << fused.getMin() << ", max " << fused.getMax() << ", mean "
+            << fused.getMean() << ", peak bin " << peak << std::endl;
+
+  sink = pixels[1];
+
+}
+
+// A pixel filtered from SAMPLES x SAMPLES subsamples per pixel spacing by
+// calling eval for each, as fillSupersampledGrid defines it.
+double supersample_pixel (const OSN::Noise<2> & noise, double x, double y, double step, int samples, OSN::SampleFilter filter) {
+  const int reach = (filter == OSN::FILTER_TENT) ? samples : samples / 2;
+  double sum = 0.0, total = 0.0;
+  for (int b = -reach; b < reach + (samples % 2); ++b) {
+    for (int a = -reach; a < reach + (samples % 2); ++a) {
+      double u = (a + 0.5 * (1 - samples % 2)) / samples, v = (b + 0.5 * (1 - samples % 2)) / samples;
+      double w = (filter == OSN::FILTER_TENT) ? (1.0 - std::fabs(u)) * (1.0 - std::fabs(v)) : 1.0;
+      sum += w * noise.eval(x + u * step, y + v * step);
+      total += w;
+    }
+  }
+  return sum / total;
+}
+
+// Anti-aliased grids, 4x4 subsamples a pixel, against eval per subsample.
+void bench_supersample (void) {
+
+  const double STEP = 8.0 / FEATURE_SIZE;
+  const int SAMPLES = 4;
+
+  OSN::Noise<2> noise;
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT), reference((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+
+  for (int f = 0; f < 2; ++f) {
+    const OSN::SampleFilter filter = f ? OSN::FILTER_TENT : OSN::FILTER_BOX;
+    const char * name = f ? "tent" : "box";
+    std::string naive = std::string("4x4 ") + name + ", eval per subsample";
+    std::string fill = std::string("4x4 ") + name + ", fillSupersampledGrid";
+    bench(naive.c_str(), (long)WIDTH * HEIGHT, [&] () {
+      for (int yi = 0; yi < HEIGHT; ++yi) {
+        for (int xi = 0; xi < WIDTH; ++xi) {
+          reference[xi + (size_t)yi * WIDTH] = supersample_pixel(noise, xi * STEP, yi * STEP, STEP, SAMPLES, filter);
+        }
+      }
+    });
+    bench(fill.c_str(), (long)WIDTH * HEIGHT, [&] () {
+      OSN::fillSupersampledGrid(noise, 0.0, 0.0, STEP, SAMPLES, filter, view);
+    });
+  }
+
+  sink = pixels[WIDTH + 1];
+
+}
+
+// Slices of 3D noise rotated to hide the lattice's axis-aligned artifacts:
+// rotating every point and calling eval, a Transformed source, and fillGrid
+// with the rotation, against the unrotated fillGrid.
+void bench_domain_transform (void) {
+
+  const double STEP = 1.0 / FEATURE_SIZE, Z = 0.37;
+
+  OSN::Noise<3> noise;
+  const OSN::Affine<3> rotation = OSN::affineImproveXY();
+  OSN::Transformed<OSN::Noise<3>, 3> rotated(noise, rotation);
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT), reference((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+
+  bench("3D slice, unrotated fillGrid", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGrid(noise, 0.0, 0.0, Z, STEP, view);
+  });
+  bench("3D slice, rotate then eval", (long)WIDTH * HEIGHT, [&] () {
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) {
+        const double p[3] = { xi * STEP, yi * STEP, Z };
+        double q[3];
+        for (int a = 0; a < 3; ++a) {
+          q[a] = rotation.offset[a] + rotation.matrix[a][0] * p[0] + rotation.matrix[a][1] * p[1] + rotation.matrix[a][2] * p[2];
+        }
+        reference[xi + (size_t)yi * WIDTH] = noise.eval(q[0], q[1], q[2]);
+      }
+    }
+  });
+  bench("3D slice, Transformed fillGrid", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGrid(rotated, 0.0, 0.0, Z, STEP, view);
+  });
+  bench("3D slice, fillGrid with Affine", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGrid(noise, rotation, 0.0, 0.0, Z, STEP, view);
+  });
+
+  sink = pixels[WIDTH + 1];
+
+}
+
+// A unit sphere displaced by fractal noise, traced from a camera by fixed
+// steps small enough for its features and by sphereTrace with the bound
+// from lipschitzBound, counting field evaluations per ray.
+void bench_sphere_trace (void) {
+
+  const int RAYS = 128;
+  const double AMPLITUDE = 0.15, FREQUENCY = 3.0, FIXED_STEP = 0.005, EPSILON = 1e-4, FAR = 4.0;
+
+  OSN::Noise<3> noise;
+  OSN::Fractal<OSN::Noise<3> > fractal(noise, 4);
+  auto field = [&] (double x, double y, double z) {
+    return std::sqrt(x * x + y * y + z * z) - 1.0 + AMPLITUDE * fractal.eval(FREQUENCY * x, FREQUENCY * y, FREQUENCY * z);
+  };
+  const double lipschitz = 1.0 + AMPLITUDE * FREQUENCY * OSN::lipschitzBound(fractal);
+  const double origin[3] = { 0.0, 0.0, -3.0 };
+
+  std::vector<double> fixed(RAYS * RAYS), traced(RAYS * RAYS);
+  size_t fixedSteps = 0, tracedSteps = 0;
+  auto direction = [&] (int i, int j, double (&d)[3]) {
+    d[0] = ((i + 0.5) / RAYS - 0.5) * 0.9;
+    d[1] = ((j + 0.5) / RAYS - 0.5) * 0.9;
+    d[2] = 1.0;
+    const double scale = 1.0 / std::sqrt(d[0] * d[0] + d[1] * d[1] + 1.0);
+    for (int a = 0; a < 3; ++a) { d[a] *= scale; }
+  };
+
+  bench("displaced sphere, fixed steps (per ray)", (long)RAYS * RAYS, [&] () {
+    fixedSteps = 0;
+    for (int j = 0; j < RAYS; ++j) {
+      for (int i = 0; i < RAYS; ++i) {
+        double d[3];
+        direction(i, j, d);
+        double t = 0.0;
+        fixed[i + j * RAYS] = -1.0;
+        for (; t <= FAR; t += FIXED_STEP) {
+          ++fixedSteps;
+          if (field(origin[0] + t * d[0], origin[1] + t * d[1], origin[2] + t * d[2]) < 0.0) {
+            fixed[i + j * RAYS] = t;
+            break;
+          }
+        }
+      }
+    }
+  });
+  bench("displaced sphere, sphereTrace (per ray)", (long)RAYS * RAYS, [&] () {
+    tracedSteps = 0;
+    for (int j = 0; j < RAYS; ++j) {
+      for (int i = 0; i < RAYS; ++i) {
+        double d[3];
+        direction(i, j, d);
+        OSN::RayHit<double> hit = OSN::sphereTrace(field, lipschitz, origin, d, FAR, EPSILON, 1000);
+        traced[i + j * RAYS] = hit.hit ? hit.distance : -1.0;
+        tracedSteps += hit.steps;
+      }
+    }
+  });
+
+  // sphereTrace should never stop behind a fixed-step hit. It stops before
+  // one where fixed steps passed through a thin sliver of the surface, or
+  // where a ray grazes the surface closer than EPSILON without crossing it.
+  size_t earlier = 0, late = 0;
+  for (size_t r = 0; r < fixed.size(); ++r) {
+    if (traced[r] >= 0.0 && (fixed[r] < 0.0 || traced[r] < fixed[r] - FIXED_STEP - EPSILON)) { ++earlier; }
+    if (fixed[r] >= 0.0 && (traced[r] < 0.0 || traced[r] > fixed[r])) { ++late; }
+  }
+
+  // The bound against the steepest slope of Noise<3> found by sampling.
+  double steepest = 0.0;
+  for (int k = 0; k < 100000; ++k) {
+    OSN::ValueGradient<double, 3> g;
+    noise.evalGradient(k * 0.0137, k * 0.0291 + 0.5, k * 0.0173 + 0.25, g);
+    steepest = std::max(steepest, std::sqrt(g.gradient[0] * g.gradient[0] + g.gradient[1] * g.gradient[1] + g.gradient[2] * g.gradient[2]));
+  }
+
+  std::cout << "steps per ray: fixed " << std::setprecision(1) << (double)fixedSteps / fixed.size() << ", sphereTrace "
+            << (double)tracedSteps / traced.size() << "; sphereTrace earlier on " << earlier << " rays, later on " << late
+            << "; Noise<3> bound " << std::setprecision(2) << OSN::lipschitzBound(noise)
+            << ", steepest sampled " << steepest << std::endl;
+
+  sink = traced[RAYS * RAYS / 2];
+
+}
+
+// The terrain graph over a 512x512 grid, evaluated a block at a time by a
+// GraphPlan, against the same pipeline written by hand around eval.
+void bench_graph (void) {
+
+  const double STEP = 1.0 / FEATURE_SIZE;
+
+  OSN::Graph graph;
+  build_terrain_graph(graph);
+  OSN::GraphPlan plan(graph);
+  ScalarTerrain scalar;
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+
+  bench("terrain, hand-written scalar", (long)WIDTH * HEIGHT, [&] () {
+    for (int yi = 0; yi < HEIGHT; ++yi) {
+      for (int xi = 0; xi < WIDTH; ++xi) { view(xi, yi) = scalar.eval(xi * STEP, yi * STEP); }
+    }
+  });
+
+  bench("terrain, GraphPlan fillGrid", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGrid(plan, 0.0, 0.0, STEP, view);
+  });
+
+  // One point per call, as a game querying the terrain under its units
+  // would make, where setting up evaluation is a large share of the work.
+  std::vector<double> xs((size_t)WIDTH * HEIGHT), ys((size_t)WIDTH * HEIGHT);
+  for (size_t i = 0; i < xs.size(); ++i) {
+    xs[i] = (i % WIDTH) * STEP;
+    ys[i] = (i / WIDTH) * STEP;
+  }
+  bench("terrain, GraphPlan evalBatch per point", (long)WIDTH * HEIGHT, [&] () {
+    for (size_t i = 0; i < pixels.size(); ++i) { plan.evalBatch(&xs[i], &ys[i], &pixels[i], 1); }
+  });
+
+  sink = pixels[WIDTH + 1];
+
+}
+
+// The terrain graph with every node run on every point, and with the land
+// and ocean sides of its selects run only where they are used, at the usual
+// continent scale and at one giving coastline across the whole grid.
+void bench_graph_branches (void) {
+
+  const double STEP = 1.0 / FEATURE_SIZE;
+
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT), lazyPixels((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+  OSN::ImageView<double> lazyView(lazyPixels.data(), WIDTH, HEIGHT);
+
+  for (int g = 0; g < 2; ++g) {
+    const double scale = (g == 0) ? 0.25 : 1.0;
+    const char * name = (g == 0) ? "terrain" : "coastline-heavy terrain";
+    OSN::Graph graph;
+    build_terrain_graph(graph, scale);
+    OSN::GraphPlan eager(graph, false), lazy(graph);
+
+    std::string eagerName = std::string(name) + ", eager";
+    std::string lazyName = std::string(name) + ", lazy branches";
+    bench(eagerName.c_str(), (long)WIDTH * HEIGHT, [&] () {
+      OSN::fillGrid(eager, 0.0, 0.0, STEP, view);
+    });
+    bench(lazyName.c_str(), (long)WIDTH * HEIGHT, [&] () {
+      OSN::fillGrid(lazy, 0.0, 0.0, STEP, lazyView);
+    });
+
+    // Where the continents need land, mountains and hills evaluated.
+    OSN::Graph continentGraph;
+    continentGraph.setOutput(continentGraph.fractal(1, 4, 2.0, 0.5, continentGraph.scaleBias(continentGraph.x(), scale, 0.0),
+                                                    continentGraph.scaleBias(continentGraph.y(), scale, 0.0)));
+    OSN::GraphPlan continentPlan(continentGraph);
+    std::vector<double> continents((size_t)WIDTH * HEIGHT);
+    OSN::fillGrid(continentPlan, 0.0, 0.0, STEP, OSN::ImageView<double>(continents.data(), WIDTH, HEIGHT));
+    long land = 0, mountains = 0, hills = 0;
+    for (size_t i = 0; i < continents.size(); ++i) {
+      if (continents[i] > -0.02) {
+        ++land;
+        mountains += (continents[i] > 0.1);
+        hills += (continents[i] < 0.3);
+      }
+    }
+    const double total = (double)continents.size();
+    std::cout << name << ": land evaluated on " << std::setprecision(1) << 100.0 * land / total << "% of points, mountains on "
+              << 100.0 * mountains / total << "%, hills on " << 100.0 * hills / total << "%" << std::endl;
+  }
+
+  sink = pixels[WIDTH + 1] + lazyPixels[WIDTH + 1];
+
+}
+
+// The terrain graph written by hand around evalBatch, a block of a row at a
+// time, with every layer evaluated at every point as an eager plan does.
+struct BatchTerrain {
+  static const int BLOCK = 256;
+  ScalarTerrain layers;
+  void evalRow (double x0, double y, double step, double * out, int count) const {
+    double x[BLOCK], ys[BLOCK], a[BLOCK], b[BLOCK], c[BLOCK], wx[BLOCK], wy[BLOCK], ridges[BLOCK], hills[BLOCK];
+    for (int begin = 0; begin < count; begin += BLOCK) {
+      const int n = (count - begin < BLOCK) ? count - begin : BLOCK;
+      for (int i = 0; i < n; ++i) {
+        x[i] = x0 + (begin + i) * step;
+        ys[i] = y;
+        a[i] = x[i] * 0.25;
+        b[i] = y * 0.25;
+      }
+      layers.continents.evalBatch(a, b, c, n);
+      layers.n2.evalBatch(x, ys, wx, n);
+      for (int i = 0; i < n; ++i) { a[i] = x[i] + 5.2; }
+      layers.n3.evalBatch(a, ys, wy, n);
+      for (int i = 0; i < n; ++i) {
+        a[i] = x[i] + 0.8 * wx[i];
+        b[i] = y + 0.8 * wy[i];
+      }
+      layers.ridges.evalBatch(a, b, ridges, n);
+      layers.hills.evalBatch(x, ys, hills, n);
+      for (int i = 0; i < n; ++i) {
+        double land = smooth_select(hills[i] * 0.25 + 0.1, 1.0 - std::fabs(ridges[i]), c[i], 0.2, 0.1);
+        double terrain = smooth_select(c[i] * 0.5 - 0.3, land, c[i], 0.0, 0.02);
+        double height = 1.0;
+        if (terrain <= -1.0) { height = -1.0; }
+        else if (terrain <= 0.0) { height = terrain; }
+        else if (terrain <= 0.5) { height = terrain * 0.4; }
+        else if (terrain <= 1.0) { height = 0.2 + (terrain - 0.5) * 1.6; }
+        out[begin + i] = height;
+      }
+    }
+  }
+};
+
+// The terrain graph saved as text and binary and loaded back into a
+// LiveGraph, against the same pipeline written by hand around evalBatch:
+// the time to load a graph, the plan's overhead, and frames rendered while
+// another thread reloads a changed graph.
+void bench_graph_file (void) {
+
+  const double STEP = 1.0 / FEATURE_SIZE;
+
+  OSN::Graph graph;
+  build_terrain_graph(graph);
+  std::ostringstream text, binary;
+  OSN::GraphFile::writeText(text, graph);
+  OSN::GraphFile::writeBinary(binary, graph);
+
+  OSN::Graph fromText;
+  std::istringstream textIn(text.str());
+  OSN::GraphFile::read(textIn, fromText);
+  std::cout << "terrain graph: " << text.str().size() << " bytes as text, " << binary.str().size() << " bytes binary" << std::endl;
+
+  OSN::LiveGraph live("terrain.osng");
+  const int LOADS = 200;
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < LOADS; ++i) { live.load((i % 2) ? text.str() : binary.str()); }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - begin;
+  std::cout << "LiveGraph::load (read, optimize, compile): " << std::fixed << std::setprecision(1) << elapsed.count() / LOADS << " us" << std::endl;
+
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+  BatchTerrain batch;
+  OSN::GraphPlan eager(fromText, false);
+
+  bench("terrain, hand-written evalBatch", (long)WIDTH * HEIGHT, [&] () {
+    for (int yi = 0; yi < HEIGHT; ++yi) { batch.evalRow(0.0, yi * STEP, STEP, &view(0, yi), WIDTH); }
+  });
+
+  bench("terrain, loaded eager plan", (long)WIDTH * HEIGHT, [&] () {
+    OSN::fillGrid(eager, 0.0, 0.0, STEP, view);
+  });
+
+  bench("terrain, LiveGraph plan", (long)WIDTH * HEIGHT, [&] () {
+    OSN::LiveGraph::Plan plan = live.get();
+    OSN::fillGrid(*plan, 0.0, 0.0, STEP, view);
+  });
+
+  // Frames taking the current plan while another thread alternates the
+  // graph between two continent scales.
+  OSN::Graph coastline;
+  build_terrain_graph(coastline, 1.0);
+  std::ostringstream coastlineText;
+  OSN::GraphFile::writeText(coastlineText, coastline);
+  std::atomic<bool> done(false);
+  std::thread editor([&] () {
+    for (int i = 0; !done.load(); ++i) { live.load((i % 2) ? coastlineText.str() : text.str()); }
+  });
+  bench("terrain, LiveGraph plan during reloads", (long)WIDTH * HEIGHT, [&] () {
+    OSN::LiveGraph::Plan plan = live.get();
+    OSN::fillGrid(*plan, 0.0, 0.0, STEP, view);
+  });
+  done.store(true);
+  editor.join();
+  std::cout << live.getVersion() << " plans published" << std::endl;
+
+  sink = pixels[WIDTH + 1];
+
+}
+
+// A biome graph as separate authors build one: each branch samples its
+// own copy of the shared detail noise, climate layers share coordinates,
+// weights are constant expressions, and scales are chained.
+OSN::Graph::Node build_biome_graph (OSN::Graph & graph) {
+  OSN::Graph::Node x = graph.x(), y = graph.y(), z = graph.z();
+  OSN::Graph::Node cx = graph.scaleBias(x, 0.1, 0.0), cy = graph.scaleBias(y, 0.1, 0.0), cz = graph.scaleBias(z, 0.1, 0.0);
+  OSN::Graph::Node temperature = graph.fractal(10, 3, 2.0, 0.5, cx, cy, cz);
+  OSN::Graph::Node humidity = graph.fractal(11, 3, 2.0, 0.5, cx, cy, cz);
+  OSN::Graph::Node half = graph.multiply(graph.constant(0.25), graph.constant(2.0));
+
+  OSN::Graph::Node desertDetail = graph.noise(20, x, y, z);
+  OSN::Graph::Node desert = graph.add(graph.multiply(desertDetail, graph.constant(0.1)), graph.constant(0.2));
+  OSN::Graph::Node forestDetail = graph.noise(20, x, y, z);
+  OSN::Graph::Node canopy = graph.noise(21, x, y, z);
+  OSN::Graph::Node forest = graph.blend(graph.scaleBias(forestDetail, 0.2, 0.3), graph.scaleBias(canopy, 0.5, 0.4), half);
+  OSN::Graph::Node rock = graph.scaleBias(graph.clamp(graph.scaleBias(graph.abs(graph.noise(22, x, y, z)), 2.0, 0.0), 0.0, 1.0), 0.6, 0.1);
+  OSN::Graph::Node snow = graph.add(graph.scaleBias(graph.noise(20, x, y, z), 0.05, 0.0), graph.constant(0.9));
+
+  OSN::Graph::Node warm = graph.select(desert, forest, humidity, 0.0, 0.1);
+  OSN::Graph::Node cold = graph.blend(rock, snow, graph.scaleBias(humidity, 0.5, 0.5));
+  OSN::Graph::Node biome = graph.select(cold, warm, temperature, 0.0, 0.15);
+  graph.setOutput(biome);
+  return biome;
+}
+
+// GraphOptimizer on the biome and terrain graphs: its estimate of the cost
+// of a sample, and the measured time, before and after, both as lazy plans.
+void bench_graph_optimizer (void) {
+
+  const double STEP = 1.0 / FEATURE_SIZE;
+
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT), optimizedPixels((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+  OSN::ImageView<double> optimizedView(optimizedPixels.data(), WIDTH, HEIGHT);
+
+  for (int g = 0; g < 2; ++g) {
+    OSN::Graph graph;
+    const char * name = (g == 0) ? "biome" : "terrain";
+    if (g == 0) { build_biome_graph(graph); }
+    else { build_terrain_graph(graph); }
+    OSN::GraphReport report;
+    OSN::Graph optimized = OSN::GraphOptimizer::optimize(graph, &report);
+    OSN::GraphPlan plan(graph), optimizedPlan(optimized);
+
+    std::string built = std::string(name) + " graph, as built";
+    std::string fast = std::string(name) + " graph, optimized";
+    bench(built.c_str(), (long)WIDTH * HEIGHT, [&] () {
+      if (g == 0) { OSN::fillGrid(plan, 0.0, 0.0, 0.5, STEP, view); }
+      else { OSN::fillGrid(plan, 0.0, 0.0, STEP, view); }
+    });
+
+    bench(fast.c_str(), (long)WIDTH * HEIGHT, [&] () {
+      if (g == 0) { OSN::fillGrid(optimizedPlan, 0.0, 0.0, 0.5, STEP, optimizedView); }
+      else { OSN::fillGrid(optimizedPlan, 0.0, 0.0, STEP, optimizedView); }
+    });
+
+    std::cout << name << " graph: " << report.nodesBefore << " -> " << report.nodesAfter << " nodes, cost "
+              << std::setprecision(3) << report.costBefore << " -> " << report.costAfter << " (2D noise samples); "
+              << report.deduplicated << " deduplicated, " << report.folded << " folded, " << report.merged << " merged, "
+              << report.fused << " fused; branches " << plan.getBranches().size() << " -> " << optimizedPlan.getBranches().size()
+              << std::endl;
+  }
+
+  sink = pixels[WIDTH + 1] + optimizedPixels[WIDTH + 1];
+
+}
+
+void bench_batch (void) {
+
+  const size_t COUNT = (size_t)WIDTH * HEIGHT;
+
+  OSN::Noise<2> noise2;
+  OSN::Noise<3> noise3;
+  OSN::Noise<4> noise4;
+
+  std::vector<double> x(COUNT), y(COUNT), z(COUNT, 0.5), w(COUNT, 0.25), out(COUNT);
+  for (size_t i = 0; i < COUNT; ++i) {
+    x[i] = (i % WIDTH) / FEATURE_SIZE;
+    y[i] = (i / WIDTH) / FEATURE_SIZE;
+  }
+
+  bench("Noise<2>::evalBatch<double>", (long)COUNT, [&] () {
+    noise2.evalBatch(x.data(), y.data(), out.data(), COUNT);
+  });
+
+  bench("Noise<3>::evalBatch<double>", (long)COUNT, [&] () {
+    noise3.evalBatch(x.data(), y.data(), z.data(), out.data(), COUNT);
+  });
+
+  bench("Noise<4>::evalBatch<double>", (long)COUNT, [&] () {
+    noise4.evalBatch(x.data(), y.data(), z.data(), w.data(), out.data(), COUNT);
+  });
+
+}
+
+// Fills a 2D image from a pool of threads pulling row-band jobs off a shared
+// counter, the way a chunk generator would. Each job records when it was
+// queued and how long it waited; fillGrid records how long the kernel ran.
+// The pool is started for every run, so its threads' trace buffers are
+// handed on from one run's threads to the next.
+void bench_threaded_fill (void) {
+
+  const int BAND = 16;
+  const int JOBS = HEIGHT / BAND;
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+  const double STEP = 1.0 / FEATURE_SIZE;
+
+  OSN::Noise<3> noise;
+  std::vector<double> image((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(image.data(), WIDTH, HEIGHT);
+
+  bench("Noise<3> threaded fillGrid", (long)WIDTH * HEIGHT, [&] () {
+    std::vector<uint64_t> queued(JOBS);
+    for (int j = 0; j < JOBS; ++j) {
+      queued[j] = OSN_TRACE_NOW();
+      OSN_TRACE_INSTANT("job queued");
+    }
+    std::atomic<int> next(0);
+    std::vector<std::thread> pool;
+    for (unsigned int t = 0; t < threads; ++t) {
+      pool.push_back(std::thread([&] () {
+        for (int j; (j = next.fetch_add(1)) < JOBS; ) {
+          OSN_TRACE_SINCE("job waiting", queued[j]);
+          OSN_TRACE_SPAN("job");
+          OSN::fillGrid(noise, 0.0, j * BAND * STEP, 0.5, STEP, view.sub(0, j * BAND, WIDTH, BAND));
+          OSN_TRACE_INSTANT("job finished");
+        }
+      }));
+    }
+    for (unsigned int t = 0; t < threads; ++t) pool[t].join();
+  });
+
+}
+
+// Cost of a single counter update, enabled or not.
+void bench_metrics (void) {
+
+  const long UPDATES = 10000000;
+
+  bench("OSN_METRICS_ADD", UPDATES, [&] () {
+    for (long i = 0; i < UPDATES; ++i) {
+      OSN_METRICS_ADD(EVAL_2D_SAMPLES, 1);
+    }
+  });
+
+#ifdef OSN_ENABLE_METRICS
+  // The pool threads of the fills above have exited and been retired, so
+  // only this thread's counters should remain.
+  OSN::Metrics::Registry & registry = OSN::Metrics::Registry::instance();
+  size_t live;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    live = registry.threads.size();
+  }
+  std::cout << "metrics: " << live << " live thread counters, kernel variant " << registry.kernelVariant << std::endl;
+#endif
+
+}
+
+int main (void) {
+
+#ifdef OSN_ENABLE_METRICS
+  OSN::Metrics::Snapshot start = OSN::Metrics::snapshot();
+#endif
+
+  bench_eval();
+  bench_floor_modes();
+  bench_policies();
+  bench_generic();
+  bench_tracks();
+  bench_loop();
+  bench_sphere();
+  bench_hessian();
+  bench_derivative_fractal();
+  bench_normal_map();
+  bench_compressed();
+  bench_morton();
+  bench_fill_stats();
+  bench_supersample();
+  bench_domain_transform();
+  bench_sphere_trace();
+  bench_graph();
+  bench_graph_optimizer();
+  bench_graph_branches();
+  bench_graph_file();
+  bench_simplex2();
+  bench_batch();
+  bench_threaded_fill();
+  bench_metrics();
+
+#ifdef OSN_ENABLE_METRICS
+  OSN::Metrics::snapshot().write(std::cout, &start);
+#endif
+
+#ifdef OSN_ENABLE_TRACE
+  std::ofstream trace("bench_trace.json");
+  OSN::Trace::writeChromeTrace(trace);
+  std::cout << "Wrote bench_trace.json" << std::endl;
+#endif
+
+  return 0;
+}
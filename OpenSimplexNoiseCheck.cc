@@ -0,0 +1,634 @@
+/*
+ * OpenSimplex (Simplectic) Noise Checks in C++
+ *
+ * This file checks that the paths built on OpenSimplexNoise.h which must
+ * agree with each other do: fills against eval, lazy graph plans against
+ * eager ones, saved graphs against the originals, and so on. It prints one
+ * line per check and exits with status 1 if any fails.
+ *
+ * Compile with:
+ *   g++ -o OpenSimplexNoiseCheck -O2 -pthread OpenSimplexNoiseCheck.cc OpenSimplexNoise.cpp
+ *
+ * Agreement between the evaluation paths of the generators themselves is
+ * checked by OpenSimplexNoiseFuzz.cc.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OpenSimplexNoise.h"
+#include "OpenSimplexNoiseFill.h"
+#include "OpenSimplexNoiseFractal.h"
+#include "OpenSimplexNoiseGraph.h"
+#include "OpenSimplexNoiseGraphFile.h"
+#include "OpenSimplexNoiseTransform.h"
+
+
+const int WIDTH = 256;
+const int HEIGHT = 256;
+const double FEATURE_SIZE = 24.0;
+
+// Noise<3> steps by up to about 1e-4 where the lattice points it visits
+// change, so two paths that round a coordinate differently can differ by
+// more than rounding at a few points. Differences above ROUNDING count as
+// such steps; at most MAX_STEPS of the points may have one.
+const double ROUNDING = 1e-12;
+const double STEP_SIZE = 1e-3;
+const double MAX_STEPS = 0.01;
+
+static int failures = 0;
+
+static void expect (bool passed, const std::string & what) {
+  std::cout << (passed ? "ok      " : "FAILED  ") << what << std::endl;
+  failures += !passed;
+}
+
+// Whether a and b differ only by rounding, apart from at most MAX_STEPS of
+// the points, which may differ by a step of the noise.
+static bool agree (const std::vector<double> & a, const std::vector<double> & b, std::string & detail) {
+  double worst = 0.0, worstStep = 0.0;
+  size_t steps = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    const double d = std::fabs(a[i] - b[i]);
+    if (d > ROUNDING) {
+      ++steps;
+      worstStep = std::max(worstStep, d);
+    }
+    else {
+      worst = std::max(worst, d);
+    }
+  }
+  std::ostringstream out;
+  out << "max difference " << std::scientific << std::setprecision(1) << worst << ", " << steps << " steps up to " << worstStep;
+  detail = out.str();
+  return !(steps > MAX_STEPS * a.size()) && !(worstStep > STEP_SIZE);
+}
+
+static std::string describe (const char * what, const std::string & detail) {
+  return std::string(what) + " (" + detail + ")";
+}
+
+// The output of LatticeNoise<N> stays within [-1, 1], over random points
+// and along the main diagonal of the super-cell where the largest values
+// lie. Past 6 dimensions the middle slabs hold so many lattice points that
+// a random point takes 0.2 ms (7D) to 1 ms (8D), so those check an eighth
+// of the points per dimension.
+template <int N>
+void check_lattice_range (void) {
+  const int points = (N <= 6) ? 20000 : 20000 >> (3 * (N - 6));
+  double largest = 0.0;
+  uint64_t state = 1;
+  for (int seed = 0; seed < 64; ++seed) {
+    OSN::LatticeNoise<N> seeded(seed);
+    for (int i = 0; i < points; ++i) {
+      double x[N];
+      for (int k = 0; k < N; ++k) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        x[k] = (double)(state >> 11) / 9007199254740992.0 * 64.0;
+      }
+      largest = std::max(largest, std::fabs(seeded.eval(x)));
+      const double t = std::fmod(i * 0.6180339887, 1.0);
+      for (int k = 0; k < N; ++k) x[k] = std::floor(x[k]) + t;
+      largest = std::max(largest, std::fabs(seeded.eval(x)));
+    }
+  }
+  std::ostringstream what;
+  what << "LatticeNoise<" << N << "> within [-1, 1] (largest |value| " << std::setprecision(3) << largest << ")";
+  expect(largest <= 1.0, what.str());
+}
+
+// Undamped DerivativeFractal heights are Fractal's, bit for bit.
+void check_derivative_fractal (void) {
+  const double STEP = 1.0 / FEATURE_SIZE;
+  OSN::Noise<2> noise;
+  OSN::DerivativeFractal<OSN::Noise<2> > undamped(noise, 6);
+  OSN::Fractal<OSN::Noise<2> > plain(noise, 6);
+  std::vector<double> heights((size_t)WIDTH * HEIGHT), reference((size_t)WIDTH * HEIGHT);
+  OSN::fillGrid(plain, 0.0, 0.0, STEP, OSN::ImageView<double>(reference.data(), WIDTH, HEIGHT));
+  OSN::fillGrid(undamped, 0.0, 0.0, STEP, OSN::ImageView<double>(heights.data(), WIDTH, HEIGHT));
+  expect(heights == reference, "undamped DerivativeFractal heights match Fractal");
+}
+
+// LoopingNoise through the fills repeats after a period, and its frames
+// are its batch evaluated at each frame's t.
+void check_looping (void) {
+  const double STEP = 1.0 / FEATURE_SIZE;
+  const size_t COUNT = (size_t)WIDTH * HEIGHT, FRAMES = 8;
+  OSN::LoopingNoise<> loop(int64_t(0), 2);
+
+  std::vector<double> first(COUNT), later(COUNT);
+  OSN::fillGrid(loop, 0.0, 0.0, 1.25, STEP, OSN::ImageView<double>(first.data(), WIDTH, HEIGHT));
+  OSN::fillGrid(loop, 0.0, 0.0, 1.25 + loop.period<double>(), STEP, OSN::ImageView<double>(later.data(), WIDTH, HEIGHT));
+  std::string detail;
+  bool passed = agree(first, later, detail);
+  expect(passed, describe("LoopingNoise fillGrid repeats after a period", detail));
+
+  std::vector<double> x(COUNT), y(COUNT), t(COUNT), frames(COUNT * FRAMES), batch(COUNT);
+  for (size_t i = 0; i < COUNT; ++i) {
+    x[i] = (i % WIDTH) * STEP;
+    y[i] = (i / WIDTH) * STEP;
+  }
+  loop.evalFrames(x.data(), y.data(), frames.data(), COUNT, FRAMES);
+  bool same = true;
+  for (size_t f = 0; f < FRAMES; ++f) {
+    std::fill(t.begin(), t.end(), loop.period<double>() / (double)FRAMES * (double)f);
+    loop.evalBatch(x.data(), y.data(), t.data(), batch.data(), COUNT);
+    same = same && std::equal(batch.begin(), batch.end(), frames.begin() + f * COUNT);
+  }
+  expect(same, "LoopingNoise evalFrames matches evalBatch at each frame");
+}
+
+// Morton-order fills against row-order fills reshuffled with mortonIndex.
+void check_morton (void) {
+  const size_t SIZE = 256, TILE = 32;
+  const float STEP = (float)(1.0 / FEATURE_SIZE);
+
+  OSN::Noise<2> noise2;
+  std::vector<float> rows(SIZE * SIZE), tiles(SIZE * SIZE), shuffled(SIZE * SIZE);
+  OSN::fillGrid(noise2, 0.0f, 0.0f, STEP, OSN::ImageView<float>(rows.data(), SIZE, SIZE));
+  for (size_t y = 0; y < SIZE; ++y) {
+    for (size_t x = 0; x < SIZE; ++x) { shuffled[OSN::mortonIndex(x, y, SIZE, TILE)] = rows[x + y * SIZE]; }
+  }
+  OSN::fillMortonGrid(noise2, 0.0f, 0.0f, STEP, SIZE, SIZE, TILE, tiles.data());
+  expect(tiles == shuffled, "fillMortonGrid matches reshuffled fillGrid");
+
+  const size_t DEPTH = 64, BRICK = 8;
+  const size_t VOXELS = DEPTH * DEPTH * DEPTH;
+  OSN::Noise<3> noise3;
+  std::vector<float> volume(VOXELS), bricks(VOXELS), shuffledVolume(VOXELS);
+  OSN::fillVolume(noise3, 0.0f, 0.0f, 0.0f, STEP, DEPTH, DEPTH, DEPTH, volume.data());
+  for (size_t z = 0; z < DEPTH; ++z) {
+    for (size_t y = 0; y < DEPTH; ++y) {
+      for (size_t x = 0; x < DEPTH; ++x) {
+        shuffledVolume[OSN::mortonIndex(x, y, z, DEPTH, DEPTH, BRICK)] = volume[x + (y + z * DEPTH) * DEPTH];
+      }
+    }
+  }
+  OSN::fillMortonVolume(noise3, 0.0f, 0.0f, 0.0f, STEP, DEPTH, DEPTH, DEPTH, BRICK, bricks.data());
+  expect(bricks == shuffledVolume, "fillMortonVolume matches reshuffled fillVolume");
+}
+
+static bool same_stats (const OSN::FillStats<float> & a, const OSN::FillStats<float> & b) {
+  return a.getMean() == b.getMean() && a.getMin() == b.getMin() && a.getMax() == b.getMax() &&
+         a.getHistogram() == b.getHistogram();
+}
+
+// Statistics gathered by the fill against a second pass over the image,
+// and from bands filled by 1 to 8 threads in whatever order they finish.
+void check_fill_stats (void) {
+  const size_t SIZE = 512, BAND = 32;
+  const float STEP = (float)(1.0 / FEATURE_SIZE);
+
+  OSN::Noise<2> noise;
+  OSN::Fractal<OSN::Noise<2> > fractal(noise, 4);
+  std::vector<float> pixels(SIZE * SIZE);
+  OSN::ImageView<float> view(pixels.data(), SIZE, SIZE);
+
+  OSN::FillStats<float> fused, scanned;
+  OSN::fillGrid(fractal, 0.0f, 0.0f, STEP, view, fused);
+  scanned.add(pixels.data(), pixels.size());
+  expect(same_stats(fused, scanned), "FillStats from fillGrid match a scan of the image");
+
+  // Band origins round differently from whole-image rows, so the runs are
+  // compared with the single thread run.
+  bool deterministic = true;
+  OSN::FillStats<float> single;
+  for (unsigned int threads = 1; threads <= 8; threads *= 2) {
+    std::vector<OSN::FillStats<float> > partials(threads);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+    for (unsigned int t = 0; t < threads; ++t) {
+      pool.push_back(std::thread([&, t] () {
+        for (size_t band; (band = next.fetch_add(1)) < SIZE / BAND; ) {
+          OSN::fillGrid(fractal, 0.0f, STEP * (float)(band * BAND), STEP, view.sub(0, band * BAND, SIZE, BAND), partials[t]);
+        }
+      }));
+    }
+    for (unsigned int t = 0; t < threads; ++t) pool[t].join();
+    OSN::FillStats<float> merged;
+    for (unsigned int t = 0; t < threads; ++t) { merged.merge(partials[t]); }
+    if (threads == 1) { single = merged; }
+    deterministic = deterministic && same_stats(merged, single);
+  }
+  expect(deterministic, "merged FillStats identical for 1 to 8 threads");
+
+  // NaNs are counted apart, and samples past the fixed-point range, or a
+  // histogram without bins or range, stay well defined.
+  std::vector<float> holed(pixels);
+  for (size_t i = 0; i < holed.size(); i += 97) { holed[i] = std::numeric_limits<float>::quiet_NaN(); }
+  std::vector<float> kept;
+  for (size_t i = 0; i < holed.size(); ++i) { if (holed[i] == holed[i]) { kept.push_back(holed[i]); } }
+  OSN::FillStats<float> withNaNs, withoutNaNs;
+  withNaNs.add(holed.data(), holed.size());
+  withoutNaNs.add(kept.data(), kept.size());
+  expect(same_stats(withNaNs, withoutNaNs) && withNaNs.getCount() == kept.size() && withNaNs.getNaNCount() == holed.size() - kept.size(),
+         "FillStats skips and counts NaN samples");
+
+  std::vector<float> extremes(1024, 3.0e38f);
+  for (size_t i = 0; i < extremes.size(); i += 2) { extremes[i] = -std::numeric_limits<float>::infinity(); }
+  OSN::FillStats<float> huge, empty(1.0f, 1.0f, 16), binless(-1.0f, 1.0f, 0);
+  huge.add(extremes.data(), extremes.size());
+  empty.add(pixels.data(), pixels.size());
+  binless.add(pixels.data(), pixels.size());
+  expect(huge.getMean() == 0.0 && huge.getMax() == 3.0e38f && empty.getHistogram().size() == 1 && empty.getHistogram()[0] == pixels.size() &&
+         binless.getHistogram().size() == 1 && binless.getHistogram()[0] == pixels.size(),
+         "FillStats handles huge samples and degenerate histograms");
+}
+
+// A pixel filtered from samples x samples subsamples per pixel spacing by
+// calling eval for each, as fillSupersampledGrid defines it.
+double supersample_pixel (const OSN::Noise<2> & noise, double x, double y, double step, int samples, OSN::SampleFilter filter) {
+  const int reach = (filter == OSN::FILTER_TENT) ? samples : samples / 2;
+  double sum = 0.0, total = 0.0;
+  for (int b = -reach; b < reach + (samples % 2); ++b) {
+    for (int a = -reach; a < reach + (samples % 2); ++a) {
+      double u = (a + 0.5 * (1 - samples % 2)) / samples, v = (b + 0.5 * (1 - samples % 2)) / samples;
+      double w = (filter == OSN::FILTER_TENT) ? (1.0 - std::fabs(u)) * (1.0 - std::fabs(v)) : 1.0;
+      sum += w * noise.eval(x + u * step, y + v * step);
+      total += w;
+    }
+  }
+  return sum / total;
+}
+
+// fillSupersampledGrid against eval per subsample, and writing nothing for
+// empty views or no subsamples.
+void check_supersample (void) {
+  const double STEP = 8.0 / FEATURE_SIZE;
+
+  OSN::Noise<2> noise;
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT), reference((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+
+  for (int samples = 1; samples <= 4; ++samples) {
+    for (int f = 0; f < 2; ++f) {
+      const OSN::SampleFilter filter = f ? OSN::FILTER_TENT : OSN::FILTER_BOX;
+      for (int yi = 0; yi < HEIGHT; ++yi) {
+        for (int xi = 0; xi < WIDTH; ++xi) {
+          reference[xi + (size_t)yi * WIDTH] = supersample_pixel(noise, xi * STEP, yi * STEP, STEP, samples, filter);
+        }
+      }
+      OSN::fillSupersampledGrid(noise, 0.0, 0.0, STEP, samples, filter, view);
+      std::string detail;
+      const bool passed = agree(pixels, reference, detail);
+      std::ostringstream what;
+      what << "fillSupersampledGrid " << samples << "x" << samples << (f ? " tent" : " box") << " matches eval per subsample";
+      expect(passed, describe(what.str().c_str(), detail));
+    }
+  }
+
+  const std::vector<double> before(pixels);
+  for (int f = 0; f < 2; ++f) {
+    const OSN::SampleFilter filter = f ? OSN::FILTER_TENT : OSN::FILTER_BOX;
+    OSN::fillSupersampledGrid(noise, 0.0, 0.0, STEP, 4, filter, view.sub(0, 0, 0, HEIGHT));
+    OSN::fillSupersampledGrid(noise, 0.0, 0.0, STEP, 4, filter, view.sub(0, 0, WIDTH, 0));
+    OSN::fillSupersampledGrid(noise, 0.0, 0.0, STEP, 0, filter, view);
+  }
+  expect(pixels == before, "fillSupersampledGrid writes nothing for empty views and 0 subsamples");
+}
+
+// A rotated slice of 3D noise, from a Transformed source and from fillGrid
+// with the rotation, against rotating every point and calling eval.
+void check_domain_transform (void) {
+  const double STEP = 1.0 / FEATURE_SIZE, Z = 0.37;
+
+  OSN::Noise<3> noise;
+  const OSN::Affine<3> rotation = OSN::affineImproveXY();
+  OSN::Transformed<OSN::Noise<3>, 3> rotated(noise, rotation);
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT), reference((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+
+  for (int yi = 0; yi < HEIGHT; ++yi) {
+    for (int xi = 0; xi < WIDTH; ++xi) {
+      const double p[3] = { xi * STEP, yi * STEP, Z };
+      double q[3];
+      for (int a = 0; a < 3; ++a) {
+        q[a] = rotation.offset[a] + rotation.matrix[a][0] * p[0] + rotation.matrix[a][1] * p[1] + rotation.matrix[a][2] * p[2];
+      }
+      reference[xi + (size_t)yi * WIDTH] = noise.eval(q[0], q[1], q[2]);
+    }
+  }
+
+  std::string detail;
+  OSN::fillGrid(rotated, 0.0, 0.0, Z, STEP, view);
+  bool passed = agree(pixels, reference, detail);
+  expect(passed, describe("Transformed fillGrid matches rotate then eval", detail));
+  OSN::fillGrid(noise, rotation, 0.0, 0.0, Z, STEP, view);
+  passed = agree(pixels, reference, detail);
+  expect(passed, describe("fillGrid with Affine matches rotate then eval", detail));
+}
+
+double smooth_select (double low, double high, double control, double threshold, double falloff) {
+  double t = (control - (threshold - falloff)) / (2.0 * falloff);
+  t = std::min(std::max(t, 0.0), 1.0);
+  t = t * t * (3.0 - 2.0 * t);
+  return low + (high - low) * t;
+}
+
+// A representative terrain: continents from a low-frequency fractal, hills
+// and domain-warped ridged mountains on land, a shelf in the ocean, and a
+// final height curve. A larger continent scale gives more coastline.
+OSN::Graph::Node build_terrain_graph (OSN::Graph & graph, double continentScale = 0.25) {
+  OSN::Graph::Node x = graph.x(), y = graph.y();
+  OSN::Graph::Node continents = graph.fractal(1, 4, 2.0, 0.5, graph.scaleBias(x, continentScale, 0.0), graph.scaleBias(y, continentScale, 0.0));
+  OSN::Graph::Node warpX = graph.noise(2, x, y);
+  OSN::Graph::Node warpY = graph.noise(3, graph.scaleBias(x, 1.0, 5.2), y);
+  OSN::Graph::Node ridges = graph.fractal(4, 5, 2.0, 0.5, graph.warp(x, warpX, 0.8), graph.warp(y, warpY, 0.8));
+  OSN::Graph::Node mountains = graph.scaleBias(graph.abs(ridges), -1.0, 1.0);
+  OSN::Graph::Node hills = graph.scaleBias(graph.fractal(5, 3, 2.0, 0.5, x, y), 0.25, 0.1);
+  OSN::Graph::Node land = graph.select(hills, mountains, continents, 0.2, 0.1);
+  OSN::Graph::Node ocean = graph.scaleBias(continents, 0.5, -0.3);
+  OSN::Graph::Node terrain = graph.select(ocean, land, continents, 0.0, 0.02);
+  static const double CURVE_X[4] = { -1.0, 0.0, 0.5, 1.0 };
+  static const double CURVE_Y[4] = { -1.0, 0.0, 0.2, 1.0 };
+  OSN::Graph::Node height = graph.curve(terrain, CURVE_X, CURVE_Y, 4);
+  graph.setOutput(height);
+  return height;
+}
+
+// The terrain graph written by hand, one sample at a time.
+struct ScalarTerrain {
+  OSN::Noise<2> n1, n2, n3, n4, n5;
+  OSN::Fractal<OSN::Noise<2> > continents, ridges, hills;
+  ScalarTerrain (void) : n1(int64_t(1)), n2(int64_t(2)), n3(int64_t(3)), n4(int64_t(4)), n5(int64_t(5)),
+                         continents(n1, 4), ridges(n4, 5), hills(n5, 3) {}
+  double eval (double x, double y) const {
+    double c = continents.eval(x * 0.25, y * 0.25);
+    double wx = n2.eval(x, y), wy = n3.eval(x + 5.2, y);
+    double mountains = 1.0 - std::fabs(ridges.eval(x + 0.8 * wx, y + 0.8 * wy));
+    double h = hills.eval(x, y) * 0.25 + 0.1;
+    double land = smooth_select(h, mountains, c, 0.2, 0.1);
+    double terrain = smooth_select(c * 0.5 - 0.3, land, c, 0.0, 0.02);
+    if (terrain <= -1.0) { return -1.0; }
+    if (terrain <= 0.0) { return terrain; }
+    if (terrain <= 0.5) { return terrain * 0.4; }
+    if (terrain <= 1.0) { return 0.2 + (terrain - 0.5) * 1.6; }
+    return 1.0;
+  }
+};
+
+uint64_t next_random (uint64_t & state) {
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return state >> 33;
+}
+
+// A random graph of noise and fractals combined through arithmetic, nested
+// selects and blends, for checking plans against each other.
+OSN::Graph::Node build_random_graph (OSN::Graph & graph, uint64_t & state) {
+  std::vector<OSN::Graph::Node> pool;
+  pool.push_back(graph.x());
+  pool.push_back(graph.y());
+  pool.push_back(graph.noise(1, pool[0], pool[1]));
+  const int steps = 8 + (int)(next_random(state) % 24);
+  for (int s = 0; s < steps; ++s) {
+    const OSN::Graph::Node a = pool[next_random(state) % pool.size()];
+    const OSN::Graph::Node b = pool[next_random(state) % pool.size()];
+    const OSN::Graph::Node c = pool[next_random(state) % pool.size()];
+    const double t = (next_random(state) % 1000) / 1000.0 - 0.5;
+    switch (next_random(state) % 10) {
+    case 0: pool.push_back(graph.noise(2 + s % 3, graph.scaleBias(a, 1.0, t), b)); break;
+    case 1: pool.push_back(graph.fractal(5 + s % 2, 1 + s % 4, 2.0, 0.5, a, graph.warp(b, c, t))); break;
+    case 2: pool.push_back(graph.add(a, b)); break;
+    case 3: pool.push_back(graph.multiply(a, b)); break;
+    case 4: pool.push_back(graph.max(graph.abs(a), graph.clamp(b, -0.5, 0.5 + t))); break;
+    case 5: case 6: pool.push_back(graph.select(a, b, c, t, (s % 2) ? 0.0 : 0.1 + t * 0.1)); break;
+    default: pool.push_back(graph.blend(a, b, graph.clamp(c, 0.0, 1.0))); break;
+    }
+  }
+  graph.setOutput(pool.back());
+  return pool.back();
+}
+
+// A biome graph as separate authors build one: each branch samples its
+// own copy of the shared detail noise, climate layers share coordinates,
+// weights are constant expressions, and scales are chained.
+OSN::Graph::Node build_biome_graph (OSN::Graph & graph) {
+  OSN::Graph::Node x = graph.x(), y = graph.y(), z = graph.z();
+  OSN::Graph::Node cx = graph.scaleBias(x, 0.1, 0.0), cy = graph.scaleBias(y, 0.1, 0.0), cz = graph.scaleBias(z, 0.1, 0.0);
+  OSN::Graph::Node temperature = graph.fractal(10, 3, 2.0, 0.5, cx, cy, cz);
+  OSN::Graph::Node humidity = graph.fractal(11, 3, 2.0, 0.5, cx, cy, cz);
+  OSN::Graph::Node half = graph.multiply(graph.constant(0.25), graph.constant(2.0));
+
+  OSN::Graph::Node desertDetail = graph.noise(20, x, y, z);
+  OSN::Graph::Node desert = graph.add(graph.multiply(desertDetail, graph.constant(0.1)), graph.constant(0.2));
+  OSN::Graph::Node forestDetail = graph.noise(20, x, y, z);
+  OSN::Graph::Node canopy = graph.noise(21, x, y, z);
+  OSN::Graph::Node forest = graph.blend(graph.scaleBias(forestDetail, 0.2, 0.3), graph.scaleBias(canopy, 0.5, 0.4), half);
+  OSN::Graph::Node rock = graph.scaleBias(graph.clamp(graph.scaleBias(graph.abs(graph.noise(22, x, y, z)), 2.0, 0.0), 0.0, 1.0), 0.6, 0.1);
+  OSN::Graph::Node snow = graph.add(graph.scaleBias(graph.noise(20, x, y, z), 0.05, 0.0), graph.constant(0.9));
+
+  OSN::Graph::Node warm = graph.select(desert, forest, humidity, 0.0, 0.1);
+  OSN::Graph::Node cold = graph.blend(rock, snow, graph.scaleBias(humidity, 0.5, 0.5));
+  OSN::Graph::Node biome = graph.select(cold, warm, temperature, 0.0, 0.15);
+  graph.setOutput(biome);
+  return biome;
+}
+
+// Lazy plans give the same bits as eager ones: on the terrain graph at the
+// usual continent scale and at one with coastline everywhere, and on random
+// graphs with nested selects and blends, as written and optimized.
+void check_graph_branches (void) {
+  const double STEP = 1.0 / FEATURE_SIZE;
+
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT), lazyPixels((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+  OSN::ImageView<double> lazyView(lazyPixels.data(), WIDTH, HEIGHT);
+
+  for (int g = 0; g < 2; ++g) {
+    OSN::Graph graph;
+    build_terrain_graph(graph, (g == 0) ? 0.25 : 1.0);
+    OSN::GraphPlan eager(graph, false), lazy(graph);
+    OSN::fillGrid(eager, 0.0, 0.0, STEP, view);
+    OSN::fillGrid(lazy, 0.0, 0.0, STEP, lazyView);
+    expect(pixels == lazyPixels, (g == 0) ? "lazy terrain plan matches eager" : "lazy coastline-heavy terrain plan matches eager");
+  }
+
+  const int GRAPHS = 800, SIDE = 48;
+  OSN::ImageView<double> small(pixels.data(), SIDE, SIDE), lazySmall(lazyPixels.data(), SIDE, SIDE);
+  uint64_t state = 99;
+  size_t differing = 0;
+  for (int g = 0; g < GRAPHS; ++g) {
+    OSN::Graph graph;
+    build_random_graph(graph, state);
+    const OSN::Graph optimized = OSN::GraphOptimizer::optimize(graph);
+    for (int o = 0; o < 2; ++o) {
+      const OSN::Graph & tested = o ? optimized : graph;
+      OSN::GraphPlan eager(tested, false), lazy(tested);
+      OSN::fillGrid(eager, -3.0, -2.0, 0.17, small);
+      OSN::fillGrid(lazy, -3.0, -2.0, 0.17, lazySmall);
+      differing += (std::memcmp(pixels.data(), lazyPixels.data(), SIDE * SIDE * sizeof(double)) != 0);
+    }
+  }
+  std::ostringstream what;
+  what << "lazy plans of random graphs match eager (" << differing << " of " << 2 * GRAPHS << " differ)";
+  expect(differing == 0, what.str());
+}
+
+// The optimized biome and terrain graphs against the graphs as built.
+void check_graph_optimizer (void) {
+  const double STEP = 1.0 / FEATURE_SIZE;
+
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT), optimizedPixels((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+  OSN::ImageView<double> optimizedView(optimizedPixels.data(), WIDTH, HEIGHT);
+
+  for (int g = 0; g < 2; ++g) {
+    OSN::Graph graph;
+    if (g == 0) { build_biome_graph(graph); }
+    else { build_terrain_graph(graph); }
+    const OSN::Graph optimized = OSN::GraphOptimizer::optimize(graph);
+    OSN::GraphPlan plan(graph), optimizedPlan(optimized);
+    if (g == 0) {
+      OSN::fillGrid(plan, 0.0, 0.0, 0.5, STEP, view);
+      OSN::fillGrid(optimizedPlan, 0.0, 0.0, 0.5, STEP, optimizedView);
+    }
+    else {
+      OSN::fillGrid(plan, 0.0, 0.0, STEP, view);
+      OSN::fillGrid(optimizedPlan, 0.0, 0.0, STEP, optimizedView);
+    }
+    std::string detail;
+    const bool passed = agree(pixels, optimizedPixels, detail);
+    expect(passed, describe((g == 0) ? "optimized biome graph matches as built" : "optimized terrain graph matches as built", detail));
+  }
+}
+
+// Graph files: text and binary round trips, malformed files rejected or
+// evaluated without crashing, a loaded plan against the original and the
+// hand-written terrain, and frames rendered while another thread reloads.
+void check_graph_file (void) {
+  const double STEP = 1.0 / FEATURE_SIZE;
+
+  OSN::Graph graph;
+  build_terrain_graph(graph);
+  std::ostringstream text, binary;
+  OSN::GraphFile::writeText(text, graph);
+  OSN::GraphFile::writeBinary(binary, graph);
+
+  OSN::Graph fromText, fromBinary;
+  std::istringstream textIn(text.str()), binaryIn(binary.str());
+  std::string error;
+  bool read = OSN::GraphFile::read(textIn, fromText, &error) && OSN::GraphFile::read(binaryIn, fromBinary, &error);
+  std::ostringstream textAgain, binaryAgain;
+  OSN::GraphFile::writeText(textAgain, fromText);
+  OSN::GraphFile::writeBinary(binaryAgain, fromBinary);
+  expect(read && textAgain.str() == text.str() && binaryAgain.str() == binary.str(), "graph file round trip exact" + (read ? "" : " (" + error + ")"));
+
+  // The hand-made files are written by writeBinary, which does not
+  // validate; the rest are the terrain file with a few bytes changed, and
+  // any that still load are evaluated.
+  OSN::LiveGraph malformed("malformed.osng");
+  std::vector<std::string> files;
+  for (int c = 0; c < 4; ++c) {
+    OSN::Graph bad;
+    const OSN::Graph::Node x = bad.x(), y = bad.y();
+    OSN::GraphNode channels = OSN::Graph::makeNode(OSN::GRAPH_CHANNELS, 2);
+    channels.inputs[0] = x;
+    channels.inputs[1] = y;
+    channels.params[0] = (c == 1) ? std::nan("") : (c == 2) ? 1e9 : (c == 3) ? 0.0 : 1.0;
+    bad.addGenerator(2, 7);
+    channels.source = bad.addGroup(c == 0 ? std::vector<uint32_t>() : std::vector<uint32_t>(1, 0));
+    bad.setOutput(bad.append(channels));
+    std::ostringstream out;
+    OSN::GraphFile::writeBinary(out, bad);
+    files.push_back(out.str());
+  }
+  const size_t handMade = files.size();
+  uint64_t state = 12345;
+  for (int m = 0; m < 2000; ++m) {
+    std::string mutated = binary.str();
+    for (int k = 0; k < 1 + m % 4; ++k) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      mutated[(size_t)(state >> 33) % mutated.size()] = (char)(state >> 25);
+    }
+    files.push_back(mutated);
+  }
+  size_t handRejected = 0;
+  double probe[OSN::Fill::BLOCK];
+  for (size_t f = 0; f < files.size(); ++f) {
+    if (!malformed.load(files[f])) {
+      handRejected += (f < handMade);
+      continue;
+    }
+    OSN::fillGrid(*malformed.get(), 0.0, 0.0, STEP, OSN::ImageView<double>(probe, 16, 16));
+  }
+  expect(handRejected == handMade, "malformed graph files rejected");
+
+  std::vector<double> pixels((size_t)WIDTH * HEIGHT), reference((size_t)WIDTH * HEIGHT);
+  OSN::ImageView<double> view(pixels.data(), WIDTH, HEIGHT);
+  OSN::GraphPlan original(graph, false), loaded(fromBinary, false);
+  OSN::fillGrid(original, 0.0, 0.0, STEP, OSN::ImageView<double>(reference.data(), WIDTH, HEIGHT));
+  OSN::fillGrid(loaded, 0.0, 0.0, STEP, view);
+  expect(pixels == reference, "loaded plan matches the original graph's");
+
+  ScalarTerrain scalar;
+  for (int yi = 0; yi < HEIGHT; ++yi) {
+    for (int xi = 0; xi < WIDTH; ++xi) { reference[xi + (size_t)yi * WIDTH] = scalar.eval(xi * STEP, yi * STEP); }
+  }
+  std::string detail;
+  const bool passed = agree(pixels, reference, detail);
+  expect(passed, describe("loaded plan matches the hand-written terrain", detail));
+
+  // Frames taking the current plan while another thread alternates the
+  // graph between two continent scales. Each frame must match one version
+  // exactly.
+  OSN::LiveGraph live("terrain.osng");
+  OSN::Graph coastline;
+  build_terrain_graph(coastline, 1.0);
+  std::ostringstream coastlineText;
+  OSN::GraphFile::writeText(coastlineText, coastline);
+  std::vector<double> versions[2];
+  for (int v = 0; v < 2; ++v) {
+    live.load(v ? coastlineText.str() : text.str());
+    versions[v].resize(pixels.size());
+    OSN::fillGrid(*live.get(), 0.0, 0.0, STEP, OSN::ImageView<double>(versions[v].data(), WIDTH, HEIGHT));
+  }
+  std::atomic<bool> done(false);
+  std::thread editor([&] () {
+    for (int i = 0; !done.load(); ++i) { live.load((i % 2) ? coastlineText.str() : text.str()); }
+  });
+  int torn = 0;
+  for (int f = 0; f < 16; ++f) {
+    OSN::LiveGraph::Plan plan = live.get();
+    OSN::fillGrid(*plan, 0.0, 0.0, STEP, view);
+    torn += (pixels != versions[0] && pixels != versions[1]);
+  }
+  done.store(true);
+  editor.join();
+  expect(torn == 0, "frames rendered during reloads each match one version");
+}
+
+int main (void) {
+
+  check_lattice_range<2>();
+  check_lattice_range<3>();
+  check_lattice_range<4>();
+  check_lattice_range<5>();
+  check_lattice_range<6>();
+  check_lattice_range<7>();
+  check_lattice_range<8>();
+  check_derivative_fractal();
+  check_looping();
+  check_morton();
+  check_fill_stats();
+  check_supersample();
+  check_domain_transform();
+  check_graph_branches();
+  check_graph_optimizer();
+  check_graph_file();
+
+  if (failures) { std::cout << failures << " checks FAILED" << std::endl; }
+  else { std::cout << "all checks passed" << std::endl; }
+
+  return failures ? 1 : 0;
+}
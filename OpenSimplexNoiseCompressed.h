@@ -0,0 +1,210 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * Block-compressed fills
+ *
+ * Fills BC4 (one channel) and BC5 (two channel) textures straight from a
+ * generator. The image is sampled a few 4x4 blocks at a time, each block's
+ * sixteen points contiguous so the source's evalBatch runs over them, and
+ * every block is encoded as soon as it has been sampled, so the float image
+ * that a separate compressor would read never exists.
+ *
+ * Values are stored as UNORM, -1..1 mapped to 0..1 as by the normal map
+ * fills, and clamped to that range. Blocks are encoded by range fit: the
+ * block's minimum and maximum, rounded outwards, as endpoints of the eight
+ * value palette, and each texel the nearest entry, as fast real-time
+ * encoders do. For noise with features 24 pixels across that is about one
+ * 8-bit step RMS.
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "OpenSimplexNoise.h"
+#include "OpenSimplexNoiseFill.h"
+
+
+namespace OSN {
+
+	// A 4x4 block of one channel: endpoint bytes red0 and red1, then a 3-bit
+	// palette index for each texel in row order, least significant first.
+	struct BC4Block {
+		uint8_t bytes[8];
+	};
+
+	// A 4x4 block of two channels, each encoded as BC4.
+	struct BC5Block {
+		BC4Block red, green;
+	};
+
+	// Encodes sixteen values in -1..1, in row order, as one BC4 block.
+	template <typename T>
+	void encodeBC4(const T * values, BC4Block & out) {
+		// BC4 index of each palette position from red1 (0) to red0 (7).
+		static const uint8_t INDEX[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+		T q[16];
+		T lo = (T)255.0, hi = (T)0.0;
+		for (int i = 0; i < 16; ++i) {
+			T v = (values[i] * (T)0.5 + (T)0.5) * (T)255.0;
+			v = (v < (T)0.0) ? (T)0.0 : (v > (T)255.0) ? (T)255.0 : v;
+			q[i] = v;
+			lo = (v < lo) ? v : lo;
+			hi = (v > hi) ? v : hi;
+		}
+		const int red0 = (int) std::ceil(hi), red1 = (int) std::floor(lo);
+		out.bytes[0] = (uint8_t) red0;
+		out.bytes[1] = (uint8_t) red1;
+		uint64_t indices = 0;
+		// With red0 == red1 every index 0 decodes to red0 in either mode.
+		if (red0 > red1) {
+			const T scale = (T)7.0 / (T) (red0 - red1), offset = (T)0.5 - (T) red1 * scale;
+			for (int i = 0; i < 16; ++i) {
+				indices |= (uint64_t) INDEX[(int) (q[i] * scale + offset) & 7] << (3 * i);
+			}
+		}
+		for (int i = 0; i < 6; ++i) { out.bytes[2 + i] = (uint8_t) (indices >> (8 * i)); }
+	}
+
+	// Decodes a BC4 block to sixteen values in -1..1 as a GPU would, in
+	// either palette mode.
+	template <typename T>
+	void decodeBC4(const BC4Block & block, T * values) {
+		const T red0 = (T) block.bytes[0], red1 = (T) block.bytes[1];
+		T palette[8] = { red0, red1 };
+		if (block.bytes[0] > block.bytes[1]) {
+			for (int i = 2; i < 8; ++i) { palette[i] = ((T) (8 - i) * red0 + (T) (i - 1) * red1) / (T)7.0; }
+		}
+		else {
+			for (int i = 2; i < 6; ++i) { palette[i] = ((T) (6 - i) * red0 + (T) (i - 1) * red1) / (T)5.0; }
+			palette[6] = (T)0.0;
+			palette[7] = (T)255.0;
+		}
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; ++i) { indices |= (uint64_t) block.bytes[2 + i] << (8 * i); }
+		for (int i = 0; i < 16; ++i) {
+			values[i] = palette[(indices >> (3 * i)) & 7] * (T)(2.0 / 255.0) - (T)1.0;
+		}
+	}
+
+	namespace Fill {
+
+		// Blocks sampled per batch, so that their points fill Fill::BLOCK.
+		const size_t BC_BLOCKS = BLOCK / 16;
+
+		// Coordinates of the pixels of count blocks starting at block (bx, by),
+		// block after block, each in row order.
+		template <typename T>
+		void blockCoordinates(T x0, T y0, T step, size_t bx, size_t by, size_t count, T * x, T * y) {
+			for (size_t b = 0; b < count; ++b) {
+				for (int j = 0; j < 4; ++j) {
+					const T yj = y0 + step * (T) (int64_t) (4 * by + j);
+					for (int i = 0; i < 4; ++i) {
+						x[16 * b + 4 * j + i] = x0 + step * (T) (int64_t) (4 * (bx + b) + i);
+						y[16 * b + 4 * j + i] = yj;
+					}
+				}
+			}
+		}
+
+	}
+
+	// Samples source at (x0 + i * step, y0 + j * step) for every pixel (i, j)
+	// of a texture whose blocks out holds, encoding each block as BC4. out is
+	// measured in blocks, so the texture is 4 * out.width pixels wide.
+	template <typename Source, typename T>
+	void fillBC4Grid(const Source & source, T x0, T y0, T step, const ImageView<BC4Block> & out) {
+		T x[Fill::BLOCK], y[Fill::BLOCK], v[Fill::BLOCK];
+		for (size_t by = 0; by < out.height; ++by) {
+			BC4Block * dest = out.row(by);
+			for (size_t begin = 0; begin < out.width; begin += Fill::BC_BLOCKS) {
+				size_t n = out.width - begin;
+				if (n > Fill::BC_BLOCKS) { n = Fill::BC_BLOCKS; }
+				Fill::blockCoordinates(x0, y0, step, begin, by, n, x, y);
+				source.evalBatch(x, y, v, 16 * n);
+				for (size_t b = 0; b < n; ++b) { encodeBC4(v + 16 * b, dest[begin + b]); }
+			}
+		}
+	}
+
+	// As above, for the slice at z of a 3D source.
+	template <typename Source, typename T>
+	void fillBC4Grid(const Source & source, T x0, T y0, T z, T step, const ImageView<BC4Block> & out) {
+		T x[Fill::BLOCK], y[Fill::BLOCK], zs[Fill::BLOCK], v[Fill::BLOCK];
+		for (size_t i = 0; i < Fill::BLOCK; ++i) { zs[i] = z; }
+		for (size_t by = 0; by < out.height; ++by) {
+			BC4Block * dest = out.row(by);
+			for (size_t begin = 0; begin < out.width; begin += Fill::BC_BLOCKS) {
+				size_t n = out.width - begin;
+				if (n > Fill::BC_BLOCKS) { n = Fill::BC_BLOCKS; }
+				Fill::blockCoordinates(x0, y0, step, begin, by, n, x, y);
+				source.evalBatch(x, y, zs, v, 16 * n);
+				for (size_t b = 0; b < n; ++b) { encodeBC4(v + 16 * b, dest[begin + b]); }
+			}
+		}
+	}
+
+	// Two sources, such as generators with different seeds, sampled on the
+	// same grid into the red and green channels of a BC5 texture.
+	template <typename RedSource, typename GreenSource, typename T>
+	void fillBC5Grid(const RedSource & red, const GreenSource & green, T x0, T y0, T step, const ImageView<BC5Block> & out) {
+		T x[Fill::BLOCK], y[Fill::BLOCK], r[Fill::BLOCK], g[Fill::BLOCK];
+		for (size_t by = 0; by < out.height; ++by) {
+			BC5Block * dest = out.row(by);
+			for (size_t begin = 0; begin < out.width; begin += Fill::BC_BLOCKS) {
+				size_t n = out.width - begin;
+				if (n > Fill::BC_BLOCKS) { n = Fill::BC_BLOCKS; }
+				Fill::blockCoordinates(x0, y0, step, begin, by, n, x, y);
+				red.evalBatch(x, y, r, 16 * n);
+				green.evalBatch(x, y, g, 16 * n);
+				for (size_t b = 0; b < n; ++b) {
+					encodeBC4(r + 16 * b, dest[begin + b].red);
+					encodeBC4(g + 16 * b, dest[begin + b].green);
+				}
+			}
+		}
+	}
+
+	// The x and y of the normal that fillNormalMap would write, as the red
+	// and green channels of a BC5 texture, with z left for the shader to
+	// rebuild as sqrt(1 - x^2 - y^2).
+	template <typename Source, typename T>
+	void fillBC5NormalMap(const Source & source, T x0, T y0, T step, T strength, const ImageView<BC5Block> & out) {
+		T x[Fill::BLOCK], y[Fill::BLOCK], nx[16], ny[16];
+		ValueGradient<T, 2> sample[Fill::BLOCK];
+		for (size_t by = 0; by < out.height; ++by) {
+			BC5Block * dest = out.row(by);
+			for (size_t begin = 0; begin < out.width; begin += Fill::BC_BLOCKS) {
+				size_t n = out.width - begin;
+				if (n > Fill::BC_BLOCKS) { n = Fill::BC_BLOCKS; }
+				Fill::blockCoordinates(x0, y0, step, begin, by, n, x, y);
+				source.evalGradientBatch(x, y, sample, 16 * n);
+				for (size_t b = 0; b < n; ++b) {
+					for (int i = 0; i < 16; ++i) {
+						const ValueGradient<T, 2> & s = sample[16 * b + i];
+						T gx = -strength * s.gradient[0];
+						T gy = -strength * s.gradient[1];
+						T scale = (T)1.0 / std::sqrt(gx * gx + gy * gy + (T)1.0);
+						nx[i] = gx * scale;
+						ny[i] = gy * scale;
+					}
+					encodeBC4(nx, dest[begin + b].red);
+					encodeBC4(ny, dest[begin + b].green);
+				}
+			}
+		}
+	}
+
+}
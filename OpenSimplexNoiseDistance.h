@@ -0,0 +1,142 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * Distance bounds
+ *
+ * lipschitzBound gives a bound on how fast a generator, a Fractal of one,
+ * or a Transformed one can change: no more than the bound per unit
+ * distance in any direction. An implicit surface displaced by noise can
+ * then be rendered by sphereTrace, which steps along each ray as far as the
+ * bound allows the surface to be, instead of taking small fixed steps.
+ *
+ * Each lattice point adds (2 - |d|^2)^4 (g . d) within squared distance 2
+ * of the input, whose gradient is at most |g| (2 - |d|^2)^3 (2 + 7 |d|^2)
+ * in magnitude. The sum of that falloff over every lattice point in reach
+ * is largest at the center of a simplex of the lattice, where it is
+ * 1280 / 27 in 2D, 3625 / 64 in 3D and 8208 / 125 in 4D; times the length
+ * of the longest gradient and the kernel's normalization, that bounds the
+ * gradient of Noise<N>. The bounds are two to three times the steepest
+ * slopes found by sampling, so steps fall short of the largest possible by
+ * that much, but never overshoot.
+ *
+ * The 3D kernel leaves out a few contributions that are close to zero, so
+ * Noise<3> jumps by up to about 1e-4 at some cell boundaries; no slope
+ * bound covers that, and a hit can land up to that much divided by the
+ * bound inside the surface. Any epsilon above it absorbs the error.
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "OpenSimplexNoise.h"
+#include "OpenSimplexNoiseFractal.h"
+#include "OpenSimplexNoiseTransform.h"
+
+
+namespace OSN {
+
+	// Largest change of source per unit distance. Gradient tables and
+	// normalizations are fixed per dimension, so the bound does not depend
+	// on the seed or the policy.
+	template <typename Policy>
+	double lipschitzBound(const Noise<2, Policy> &) {
+		return std::sqrt(5.0 * 5.0 + 2.0 * 2.0) * (1280.0 / 27.0) / 47.0;
+	}
+
+	template <typename Policy>
+	double lipschitzBound(const Noise<3, Policy> &) {
+		return std::sqrt(11.0 * 11.0 + 4.0 * 4.0 + 4.0 * 4.0) * (3625.0 / 64.0) / 103.0;
+	}
+
+	template <typename Policy>
+	double lipschitzBound(const Noise<4, Policy> &) {
+		return std::sqrt(3.0 * 3.0 + 1.0 + 1.0 + 1.0) * (8208.0 / 125.0) / 30.0;
+	}
+
+	// Octave o changes lacunarity^o times faster than the source, at weight
+	// gain^o over the total weight.
+	template <typename Source>
+	double lipschitzBound(const Fractal<Source> & fractal) {
+		double total = 0.0, weight = 0.0, frequency = 1.0, amplitude = 1.0;
+		for (int o = 0; o < fractal.getOctaves(); ++o) {
+			total += amplitude;
+			weight += std::fabs(amplitude) * frequency;
+			frequency *= std::fabs(fractal.getLacunarity());
+			amplitude *= fractal.getGain();
+		}
+		return (total != 0.0) ? lipschitzBound(fractal.getSource()) * weight / std::fabs(total) : 0.0;
+	}
+
+	// The source's bound times the largest factor by which the matrix can
+	// stretch a distance, bounded from above by the largest row sum of the
+	// absolute values of its transpose times itself, so that rotations and
+	// uniform scales are bounded exactly.
+	template <typename Source, int N>
+	double lipschitzBound(const Transformed<Source, N> & transformed) {
+		const Affine<N> & domain = transformed.getDomain();
+		double stretch = 0.0;
+		for (int a = 0; a < N; ++a) {
+			double row = 0.0;
+			for (int b = 0; b < N; ++b) {
+				double product = 0.0;
+				for (int k = 0; k < N; ++k) { product += domain.matrix[k][a] * domain.matrix[k][b]; }
+				row += std::fabs(product);
+			}
+			stretch = (row > stretch) ? row : stretch;
+		}
+		return lipschitzBound(transformed.getSource()) * std::sqrt(stretch);
+	}
+
+	// Where a ray met a surface, as found by sphereTrace.
+	template <typename T>
+	struct RayHit {
+		// Distance along the ray to the hit, or to where tracing gave up.
+		T distance;
+		// Number of times the field was evaluated.
+		size_t steps;
+		bool hit;
+	};
+
+	// Traces the ray from origin along the unit vector direction to the
+	// surface where field(x, y, z) crosses zero, field being positive
+	// outside and changing by at most lipschitz per unit distance. Each step
+	// moves field / lipschitz along the ray, the nearest the surface can be.
+	// Reports a hit where field falls below epsilon, and none past
+	// maxDistance or after maxSteps evaluations.
+	//
+	// For a signed distance function displaced by amplitude times a source
+	// sampled at frequency times the point, lipschitz is 1 + |amplitude| *
+	// frequency * lipschitzBound(source), or 1 + |amplitude| times the bound
+	// of a Transformed source that does the scaling.
+	template <typename Field, typename T>
+	RayHit<T> sphereTrace(const Field & field, T lipschitz, const T (&origin)[3], const T (&direction)[3], T maxDistance, T epsilon, size_t maxSteps) {
+		const T reach = (T)1.0 / lipschitz;
+		RayHit<T> result;
+		result.distance = (T)0.0;
+		result.hit = false;
+		for (result.steps = 0; result.steps < maxSteps && result.distance <= maxDistance; ) {
+			const T t = result.distance;
+			const T f = field(origin[0] + t * direction[0], origin[1] + t * direction[1], origin[2] + t * direction[2]);
+			++result.steps;
+			if (f < epsilon) {
+				result.hit = true;
+				break;
+			}
+			result.distance += f * reach;
+		}
+		return result;
+	}
+
+}
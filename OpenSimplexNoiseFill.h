@@ -0,0 +1,822 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * Image fills
+ *
+ * Fills 2D images with samples of a generator, writing through ImageView so
+ * that the destination can be a whole buffer, a sub-rectangle of one, or one
+ * face of a texture array. Each fill generates its sample coordinates a row
+ * at a time and evaluates them with the source's evalBatch, so the source
+ * can be any Noise<N> or a Fractal of one. The grid fills can also write
+ * gradients, Hessians or packed normals through the corresponding batch
+ * calls. Grids and volumes can also be written as tiles in Morton
+ * (Z-order) layout. Under OSN_ENABLE_TRACE every fill records a span, so
+ * the bands a thread pool fills show on each thread's track.
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "OpenSimplexNoise.h"
+#include "OpenSimplexNoiseTrace.h"
+
+
+namespace OSN {
+
+	// A width x height image of T whose rows start stride elements apart.
+	// Does not own the pixels.
+	template <typename T>
+	struct ImageView {
+
+		ImageView(T * data, size_t width, size_t height) :
+			data(data), width(width), height(height), stride((ptrdiff_t) width) {}
+
+		ImageView(T * data, size_t width, size_t height, ptrdiff_t stride) :
+			data(data), width(width), height(height), stride(stride) {}
+
+		T * row(size_t y) const { return data + (ptrdiff_t) y * stride; }
+		T & operator()(size_t x, size_t y) const { return row(y)[x]; }
+
+		// The w x h rectangle whose top-left pixel is (x, y).
+		ImageView sub(size_t x, size_t y, size_t w, size_t h) const {
+			return ImageView(row(y) + x, w, h, stride);
+		}
+
+		T * data;
+		size_t width, height;
+		ptrdiff_t stride;
+
+	};
+
+	// Normal map texels: a unit normal stored as three unsigned bytes mapping
+	// -1..1 to 0..255, or as two 16-bit octahedral coordinates, which keep
+	// more precision in half the channels of an RGBA16 texture.
+	struct NormalRGB8 {
+		uint8_t r, g, b;
+	};
+
+	struct NormalOct16 {
+		uint16_t x, y;
+	};
+
+	// Faces of a cube map, in the usual graphics API order. Face pixels follow
+	// the OpenGL and Direct3D cube texture layout.
+	enum CubeFace {
+		CUBE_POSITIVE_X,
+		CUBE_NEGATIVE_X,
+		CUBE_POSITIVE_Y,
+		CUBE_NEGATIVE_Y,
+		CUBE_POSITIVE_Z,
+		CUBE_NEGATIVE_Z
+	};
+
+	// Minimum, maximum, mean and histogram of the samples written by one or
+	// more fills, gathered as each block is written instead of in another
+	// pass over the output. The histogram has bins equal bins over lo..hi;
+	// samples outside it count in the first or last bin. With no bins, or a
+	// range that is empty, reversed or NaN, it has one bin holding every
+	// sample. NaN samples are only counted, by getNaNCount.
+	//
+	// To fill in parallel, give each thread its own FillStats with the same
+	// range and bins, and merge them when all are done. The sum behind the
+	// mean is kept in 128-bit fixed point, each sample rounded to a multiple
+	// of 2^-32, so that it is the same in any order and every statistic
+	// comes out the same whatever the number of threads and however the
+	// work was shared out. Samples beyond 2^22 in magnitude count as 2^22
+	// of their sign in the mean.
+	template <typename T>
+	class FillStats {
+
+	public:
+
+		explicit FillStats(T lo = (T)-1.0, T hi = (T)1.0, size_t bins = 256) :
+			lo(lo), hi(hi), scale((bins > 0 && hi > lo) ? (T) bins / (hi - lo) : (T)0.0), histogram((bins > 0 && hi > lo) ? bins : 1, 0),
+			count(0), nans(0), minimum(std::numeric_limits<T>::infinity()), maximum(-std::numeric_limits<T>::infinity()), sumLow(0), sumHigh(0) {}
+
+		void add(const T * values, size_t n) {
+			const T last = (T) (histogram.size() - 1);
+			const T limit = (T)4194304.0; // 2^22
+			const size_t nansBefore = nans;
+			for (size_t begin = 0; begin < n; begin += CHUNK) {
+				size_t end = (n - begin > CHUNK) ? begin + CHUNK : n;
+				int64_t partial = 0;
+				for (size_t i = begin; i < end; ++i) {
+					const T v = values[i];
+					if (v != v) {
+						++nans;
+						continue;
+					}
+					minimum = (v < minimum) ? v : minimum;
+					maximum = (v > maximum) ? v : maximum;
+					const T clamped = (v < -limit) ? -limit : ((v > limit) ? limit : v);
+					partial += (int64_t) (clamped * (T)4294967296.0);
+					const T t = (v - lo) * scale;
+					++histogram[(t > (T)0.0) ? ((t < last) ? (size_t) t : (size_t) last) : 0];
+				}
+				accumulate((uint64_t) partial, (partial < 0) ? ~(uint64_t)0 : 0);
+			}
+			count += n - (nans - nansBefore);
+		}
+
+		void merge(const FillStats & other) {
+			for (size_t b = 0; b < histogram.size() && b < other.histogram.size(); ++b) { histogram[b] += other.histogram[b]; }
+			count += other.count;
+			nans += other.nans;
+			minimum = (other.minimum < minimum) ? other.minimum : minimum;
+			maximum = (other.maximum > maximum) ? other.maximum : maximum;
+			accumulate(other.sumLow, other.sumHigh);
+		}
+
+		// Samples counted, not including NaNs.
+		size_t getCount(void) const { return count; }
+		size_t getNaNCount(void) const { return nans; }
+		T getMin(void) const { return minimum; }
+		T getMax(void) const { return maximum; }
+		T getLo(void) const { return lo; }
+		T getHi(void) const { return hi; }
+		const std::vector<uint64_t> & getHistogram(void) const { return histogram; }
+
+		double getMean(void) const {
+			if (count == 0) { return 0.0; }
+			const double sum = (double) (int64_t) sumHigh * 18446744073709551616.0 + (double) sumLow;
+			return sum / 4294967296.0 / (double) count;
+		}
+
+	private:
+
+		// Samples summed in an int64_t before joining the 128-bit sum: 2^8
+		// of them, each clamped to 2^22 * 2^32, stay within 2^62.
+		static const size_t CHUNK = 256;
+
+		T lo, hi, scale;
+		std::vector<uint64_t> histogram;
+		size_t count, nans;
+		T minimum, maximum;
+		uint64_t sumLow, sumHigh;
+
+		void accumulate(uint64_t low, uint64_t high) {
+			sumLow += low;
+			sumHigh += high + (sumLow < low);
+		}
+
+	};
+
+	// Pixel filters for fillSupersampledGrid: the mean of the samples within
+	// the pixel, or samples within a pixel spacing weighted by 1 - distance
+	// along each axis, which blurs a little more but aliases less.
+	enum SampleFilter {
+		FILTER_BOX,
+		FILTER_TENT
+	};
+
+	namespace Fill {
+
+		// Pixels are evaluated in blocks of this many, so that the coordinate
+		// buffers stay in L1 while the source runs over them.
+		const size_t BLOCK = 256;
+
+		// Direction to the center of a face, and the directions in which its
+		// columns and rows advance, as 3D vectors.
+		struct CubeBasis {
+			int major[3], across[3], down[3];
+		};
+
+		inline const CubeBasis & cubeBasis(CubeFace face) {
+			static const CubeBasis bases[6] = {
+				{ {  1,  0,  0 }, {  0,  0, -1 }, {  0, -1,  0 } },
+				{ { -1,  0,  0 }, {  0,  0,  1 }, {  0, -1,  0 } },
+				{ {  0,  1,  0 }, {  1,  0,  0 }, {  0,  0,  1 } },
+				{ {  0, -1,  0 }, {  1,  0,  0 }, {  0,  0, -1 } },
+				{ {  0,  0,  1 }, {  1,  0,  0 }, {  0, -1,  0 } },
+				{ {  0,  0, -1 }, { -1,  0,  0 }, {  0, -1,  0 } }
+			};
+			return bases[face];
+		}
+
+		// Evaluates the points (ring * cosines[i], ring * sines[i], z) for i in
+		// 0..count: a circle of latitude of a sphere, or a ring of a cylinder,
+		// whose column directions were computed once per image.
+		template <typename Source, typename T>
+		void fillRing(const Source & source, const T * cosines, const T * sines, T ring, T z, T * out, size_t count) {
+			T x[BLOCK], y[BLOCK], zs[BLOCK];
+			for (size_t begin = 0; begin < count; begin += BLOCK) {
+				size_t n = count - begin;
+				if (n > BLOCK) { n = BLOCK; }
+				for (size_t i = 0; i < n; ++i) {
+					x[i] = ring * cosines[begin + i];
+					y[i] = ring * sines[begin + i];
+					zs[i] = z;
+				}
+				source.evalBatch(x, y, zs, out + begin, n);
+			}
+		}
+
+		// The batch call of source that produces Out, for 2D and 3D points.
+		template <typename Source, typename T>
+		void batch(const Source & source, const T * x, const T * y, T * out, size_t count) {
+			source.evalBatch(x, y, out, count);
+		}
+
+		template <typename Source, typename T>
+		void batch(const Source & source, const T * x, const T * y, ValueGradient<T, 2> * out, size_t count) {
+			source.evalGradientBatch(x, y, out, count);
+		}
+
+		template <typename Source, typename T>
+		void batch(const Source & source, const T * x, const T * y, Derivatives<T, 2> * out, size_t count) {
+			source.hessianBatch(x, y, out, count);
+		}
+
+		template <typename Source, typename T>
+		void batch(const Source & source, const T * x, const T * y, const T * z, T * out, size_t count) {
+			source.evalBatch(x, y, z, out, count);
+		}
+
+		template <typename Source, typename T>
+		void batch(const Source & source, const T * x, const T * y, const T * z, ValueGradient<T, 3> * out, size_t count) {
+			source.evalGradientBatch(x, y, z, out, count);
+		}
+
+		template <typename Source, typename T>
+		void batch(const Source & source, const T * x, const T * y, const T * z, Derivatives<T, 3> * out, size_t count) {
+			source.hessianBatch(x, y, z, out, count);
+		}
+
+		// Normal map texels, from a NormalSource below.
+		template <typename Source, typename T>
+		void batch(const Source & source, const T * x, const T * y, NormalRGB8 * out, size_t count) {
+			source.normalBatch(x, y, out, count);
+		}
+
+		template <typename Source, typename T>
+		void batch(const Source & source, const T * x, const T * y, NormalOct16 * out, size_t count) {
+			source.normalBatch(x, y, out, count);
+		}
+
+		// Stands in for a FillStats when a fill gathers none.
+		struct NoStats {
+			template <typename Out>
+			void add(const Out *, size_t) {}
+		};
+
+		// Fills out from source at (x0 + i * step, y0 + j * step) for every
+		// pixel (i, j), adding each block to stats. Coordinates are computed
+		// from the origin for every pixel so that rounding does not
+		// accumulate across the image.
+		template <typename Source, typename T, typename Out, typename Stats>
+		void grid(const Source & source, T x0, T y0, T step, const ImageView<Out> & out, Stats & stats) {
+			OSN_TRACE_SPAN("fillGrid");
+			T x[BLOCK], y[BLOCK];
+			for (size_t row = 0; row < out.height; ++row) {
+				T yr = y0 + step * (T) (int64_t) row;
+				Out * dest = out.row(row);
+				for (size_t begin = 0; begin < out.width; begin += BLOCK) {
+					size_t n = out.width - begin;
+					if (n > BLOCK) { n = BLOCK; }
+					for (size_t i = 0; i < n; ++i) {
+						x[i] = x0 + step * (T) (int64_t) (begin + i);
+						y[i] = yr;
+					}
+					batch(source, x, y, dest + begin, n);
+					stats.add(dest + begin, n);
+				}
+			}
+		}
+
+		// As above, for the slice at z of a 3D source.
+		template <typename Source, typename T, typename Out, typename Stats>
+		void grid(const Source & source, T x0, T y0, T z, T step, const ImageView<Out> & out, Stats & stats) {
+			OSN_TRACE_SPAN("fillGrid");
+			T x[BLOCK], y[BLOCK], zs[BLOCK];
+			for (size_t row = 0; row < out.height; ++row) {
+				T yr = y0 + step * (T) (int64_t) row;
+				Out * dest = out.row(row);
+				for (size_t begin = 0; begin < out.width; begin += BLOCK) {
+					size_t n = out.width - begin;
+					if (n > BLOCK) { n = BLOCK; }
+					for (size_t i = 0; i < n; ++i) {
+						x[i] = x0 + step * (T) (int64_t) (begin + i);
+						y[i] = yr;
+						zs[i] = z;
+					}
+					batch(source, x, y, zs, dest + begin, n);
+					stats.add(dest + begin, n);
+				}
+			}
+		}
+
+		template <typename Source, typename T, typename Out>
+		void grid(const Source & source, T x0, T y0, T step, const ImageView<Out> & out) {
+			NoStats none;
+			grid(source, x0, y0, step, out, none);
+		}
+
+		template <typename Source, typename T, typename Out>
+		void grid(const Source & source, T x0, T y0, T z, T step, const ImageView<Out> & out) {
+			NoStats none;
+			grid(source, x0, y0, z, step, out, none);
+		}
+
+		// Maps -1..1 to 0..scale, rounding to nearest.
+		template <typename T>
+		inline T unorm(T v, T scale) {
+			return (v * (T)0.5 + (T)0.5) * scale + (T)0.5;
+		}
+
+		template <typename T>
+		inline void packNormal(T x, T y, T z, NormalRGB8 & out) {
+			out.r = (uint8_t) unorm(x, (T)255.0);
+			out.g = (uint8_t) unorm(y, (T)255.0);
+			out.b = (uint8_t) unorm(z, (T)255.0);
+		}
+
+		// Projects the normal onto the octahedron |x| + |y| + |z| = 1 and
+		// unfolds its lower half over the corners of the square.
+		template <typename T>
+		inline void packNormal(T x, T y, T z, NormalOct16 & out) {
+			T l1 = std::fabs(x) + std::fabs(y) + std::fabs(z);
+			T u = x / l1, v = y / l1;
+			if (z < (T)0.0) {
+				T fu = ((T)1.0 - std::fabs(v)) * ((u < (T)0.0) ? (T)-1.0 : (T)1.0);
+				T fv = ((T)1.0 - std::fabs(u)) * ((v < (T)0.0) ? (T)-1.0 : (T)1.0);
+				u = fu;
+				v = fv;
+			}
+			out.x = (uint16_t) unorm(u, (T)65535.0);
+			out.y = (uint16_t) unorm(v, (T)65535.0);
+		}
+
+		// The normals of the height field strength * source(x, y), packed from
+		// a block of gradients of at most BLOCK points, for grid.
+		template <typename Source, typename T>
+		struct NormalSource {
+
+			NormalSource(const Source & source, T strength) : source(source), strength(strength) {}
+
+			template <typename Normal>
+			void normalBatch(const T * x, const T * y, Normal * out, size_t count) const {
+				ValueGradient<T, 2> sample[BLOCK];
+				source.evalGradientBatch(x, y, sample, count);
+				for (size_t i = 0; i < count; ++i) {
+					T nx = -strength * sample[i].gradient[0];
+					T ny = -strength * sample[i].gradient[1];
+					T scale = (T)1.0 / std::sqrt(nx * nx + ny * ny + (T)1.0);
+					packNormal(nx * scale, ny * scale, scale, out[i]);
+				}
+			}
+
+			const Source & source;
+			T strength;
+
+		};
+
+		// The bits of v, low first, moved to every second (or third) bit of
+		// the result, so that interleaving coordinates gives a Morton index.
+		inline uint32_t spread2(uint32_t v) {
+			v &= 0xFFFF;
+			v = (v | (v << 8)) & 0x00FF00FF;
+			v = (v | (v << 4)) & 0x0F0F0F0F;
+			v = (v | (v << 2)) & 0x33333333;
+			v = (v | (v << 1)) & 0x55555555;
+			return v;
+		}
+
+		inline uint32_t spread3(uint32_t v) {
+			v &= 0x3FF;
+			v = (v | (v << 16)) & 0x030000FF;
+			v = (v | (v << 8)) & 0x0300F00F;
+			v = (v | (v << 4)) & 0x030C30C3;
+			v = (v | (v << 2)) & 0x09249249;
+			return v;
+		}
+
+		// Offset in a Morton-tiled layout of each coordinate 0..count along
+		// one axis: the offset of its tile, whose index advances by stride,
+		// plus its bits spread for the given number of dimensions and shifted
+		// to this axis. The position of a pixel or voxel is the sum of the
+		// offsets of its coordinates.
+		inline void mortonAxis(size_t count, size_t tile, size_t stride, int dimensions, int axis, std::vector<size_t> & offsets) {
+			const size_t cells = (dimensions == 3) ? tile * tile * tile : tile * tile;
+			offsets.resize(count);
+			for (size_t i = 0; i < count; ++i) {
+				const uint32_t within = (uint32_t) (i % tile);
+				const size_t bits = (dimensions == 3) ? spread3(within) : spread2(within);
+				offsets[i] = (i / tile) * stride * cells + (bits << axis);
+			}
+		}
+
+		// Where each of the samples along one axis of fillSupersampledGrid
+		// goes: sample f is at position[f] in pixels, and adds weight[2 f] of
+		// itself to pixel pixel[2 f] and weight[2 f + 1] to pixel[2 f + 1].
+		// Tent samples start a pixel before the first, so that it has its
+		// whole footprint. With no pixels or no samples the axis is empty.
+		template <typename T>
+		struct SampleAxis {
+
+			SampleAxis(size_t pixels, size_t samples, SampleFilter filter) {
+				const size_t border = (filter == FILTER_TENT) ? 1 : 0;
+				const size_t count = (pixels == 0) ? 0 : (pixels + 2 * border) * samples;
+				position.resize(count);
+				pixel.resize(2 * count);
+				weight.resize(2 * count);
+				for (size_t f = 0; f < count; ++f) {
+					const double u = ((double) f + 0.5) / (double) samples - 0.5 - (double) border;
+					position[f] = (T) u;
+					for (int k = 0; k < 2; ++k) {
+						// The pixel centers either side of the sample for the tent, the
+						// pixel it is in for the box.
+						const double center = (filter == FILTER_TENT) ? std::floor(u) + k : std::floor(u + 0.5);
+						double w = (filter == FILTER_TENT) ? 1.0 - std::fabs(u - center) : (k == 0) ? 1.0 : 0.0;
+						if (center < 0.0 || center >= (double) pixels) { w = 0.0; }
+						pixel[2 * f + k] = (center < 0.0) ? 0 : (center >= (double) pixels) ? pixels - 1 : (size_t) center;
+						weight[2 * f + k] = (T) w;
+					}
+				}
+				// Every pixel's weights add up to the same total; normalize by it.
+				total = (T)0.0;
+				for (size_t f = 0; f < 2 * count; ++f) { total += (pixel[f] == 0) ? weight[f] : (T)0.0; }
+			}
+
+			std::vector<T> position, weight;
+			std::vector<size_t> pixel;
+			T total;
+
+		};
+
+		// Cosines and sines of the longitudes of the centers of count columns
+		// spanning one turn, starting from -pi.
+		template <typename T>
+		void columnDirections(size_t count, std::vector<T> & cosines, std::vector<T> & sines) {
+			cosines.resize(count);
+			sines.resize(count);
+			const double step = 6.283185307179586476925 / (double) count;
+			for (size_t i = 0; i < count; ++i) {
+				double longitude = -3.141592653589793238463 + ((double) i + 0.5) * step;
+				cosines[i] = (T) std::cos(longitude);
+				sines[i] = (T) std::sin(longitude);
+			}
+		}
+
+	}
+
+	// Samples source at (x0 + i * step, y0 + j * step) for every pixel (i, j).
+	template <typename Source, typename T>
+	void fillGrid(const Source & source, T x0, T y0, T step, const ImageView<T> & out) {
+		Fill::grid(source, x0, y0, step, out);
+	}
+
+	// As above, for the slice at z of a 3D source.
+	template <typename Source, typename T>
+	void fillGrid(const Source & source, T x0, T y0, T z, T step, const ImageView<T> & out) {
+		Fill::grid(source, x0, y0, z, step, out);
+	}
+
+	// As the fills above, also adding every sample to stats.
+	template <typename Source, typename T>
+	void fillGrid(const Source & source, T x0, T y0, T step, const ImageView<T> & out, FillStats<T> & stats) {
+		Fill::grid(source, x0, y0, step, out, stats);
+	}
+
+	template <typename Source, typename T>
+	void fillGrid(const Source & source, T x0, T y0, T z, T step, const ImageView<T> & out, FillStats<T> & stats) {
+		Fill::grid(source, x0, y0, z, step, out, stats);
+	}
+
+	namespace Fill {
+
+		template <typename Source, typename T, typename Stats>
+		void volume(const Source & source, T x0, T y0, T z0, T step, size_t width, size_t height, size_t depth, T * out, Stats & stats) {
+			OSN_TRACE_SPAN("fillVolume");
+			for (size_t k = 0; k < depth; ++k) {
+				T z = z0 + step * (T) (int64_t) k;
+				grid(source, x0, y0, z, step, ImageView<T>(out + k * width * height, width, height), stats);
+			}
+		}
+
+	}
+
+	// Samples a 3D source at (x0 + i * step, y0 + j * step, z0 + k * step)
+	// for every voxel (i, j, k) of a width x height x depth volume, stored
+	// slice after slice, each in row order.
+	template <typename Source, typename T>
+	void fillVolume(const Source & source, T x0, T y0, T z0, T step, size_t width, size_t height, size_t depth, T * out) {
+		Fill::NoStats none;
+		Fill::volume(source, x0, y0, z0, step, width, height, depth, out, none);
+	}
+
+	template <typename Source, typename T>
+	void fillVolume(const Source & source, T x0, T y0, T z0, T step, size_t width, size_t height, size_t depth, T * out, FillStats<T> & stats) {
+		Fill::volume(source, x0, y0, z0, step, width, height, depth, out, stats);
+	}
+
+	// Position of pixel (x, y) in an image that fillMortonGrid wrote with
+	// the given width and tile size, and of voxel (x, y, z) in a volume that
+	// fillMortonVolume wrote.
+	inline size_t mortonIndex(size_t x, size_t y, size_t width, size_t tile) {
+		const size_t t = (y / tile) * (width / tile) + x / tile;
+		return t * tile * tile + (Fill::spread2((uint32_t) (x % tile)) | (Fill::spread2((uint32_t) (y % tile)) << 1));
+	}
+
+	inline size_t mortonIndex(size_t x, size_t y, size_t z, size_t width, size_t height, size_t tile) {
+		const size_t t = ((z / tile) * (height / tile) + y / tile) * (width / tile) + x / tile;
+		return t * tile * tile * tile + (Fill::spread3((uint32_t) (x % tile)) | (Fill::spread3((uint32_t) (y % tile)) << 1) |
+			(Fill::spread3((uint32_t) (z % tile)) << 2));
+	}
+
+	namespace Fill {
+
+		template <typename Source, typename T, typename Stats>
+		void mortonGrid(const Source & source, T x0, T y0, T step, size_t width, size_t height, size_t tile, T * out, Stats & stats) {
+			OSN_TRACE_SPAN("fillMortonGrid");
+			std::vector<size_t> columns, rows;
+			mortonAxis(width, tile, 1, 2, 0, columns);
+			mortonAxis(height, tile, width / tile, 2, 1, rows);
+			T x[BLOCK], y[BLOCK], v[BLOCK];
+			for (size_t row = 0; row < height; ++row) {
+				T yr = y0 + step * (T) (int64_t) row;
+				T * dest = out + rows[row];
+				for (size_t begin = 0; begin < width; begin += BLOCK) {
+					size_t n = width - begin;
+					if (n > BLOCK) { n = BLOCK; }
+					for (size_t i = 0; i < n; ++i) {
+						x[i] = x0 + step * (T) (int64_t) (begin + i);
+						y[i] = yr;
+					}
+					source.evalBatch(x, y, v, n);
+					for (size_t i = 0; i < n; ++i) { dest[columns[begin + i]] = v[i]; }
+					stats.add(v, n);
+				}
+			}
+		}
+
+		template <typename Source, typename T, typename Stats>
+		void mortonVolume(const Source & source, T x0, T y0, T z0, T step, size_t width, size_t height, size_t depth, size_t tile, T * out, Stats & stats) {
+			OSN_TRACE_SPAN("fillMortonVolume");
+			std::vector<size_t> columns, rows, slices;
+			mortonAxis(width, tile, 1, 3, 0, columns);
+			mortonAxis(height, tile, width / tile, 3, 1, rows);
+			mortonAxis(depth, tile, (width / tile) * (height / tile), 3, 2, slices);
+			T x[BLOCK], y[BLOCK], z[BLOCK], v[BLOCK];
+			for (size_t slice = 0; slice < depth; ++slice) {
+				T zs = z0 + step * (T) (int64_t) slice;
+				for (size_t row = 0; row < height; ++row) {
+					T yr = y0 + step * (T) (int64_t) row;
+					T * dest = out + slices[slice] + rows[row];
+					for (size_t begin = 0; begin < width; begin += BLOCK) {
+						size_t n = width - begin;
+						if (n > BLOCK) { n = BLOCK; }
+						for (size_t i = 0; i < n; ++i) {
+							x[i] = x0 + step * (T) (int64_t) (begin + i);
+							y[i] = yr;
+							z[i] = zs;
+						}
+						source.evalBatch(x, y, z, v, n);
+						for (size_t i = 0; i < n; ++i) { dest[columns[begin + i]] = v[i]; }
+						stats.add(v, n);
+					}
+				}
+			}
+		}
+
+	}
+
+	// As fillGrid, for consumers that read square tiles in Z-order, such as
+	// quadtree terrain or swizzled texture uploads. The image is stored as
+	// tile x tile tiles in row order, each tile's pixels in Morton order;
+	// mortonIndex gives the position of each. tile must be a power of two
+	// (at most 2^16) dividing width and height.
+	//
+	// Pixels are still evaluated in rows, as by fillGrid, and each batch is
+	// scattered to its places in the tiles. The kernels branch on where a
+	// point falls in its cell, and walking a tile in Z-order changes that
+	// more often than walking a row, which costs more than the scatter. The
+	// tiles a band of rows writes stay in cache until it is done, and the
+	// samples are identical to fillGrid's.
+	template <typename Source, typename T>
+	void fillMortonGrid(const Source & source, T x0, T y0, T step, size_t width, size_t height, size_t tile, T * out) {
+		Fill::NoStats none;
+		Fill::mortonGrid(source, x0, y0, step, width, height, tile, out, none);
+	}
+
+	template <typename Source, typename T>
+	void fillMortonGrid(const Source & source, T x0, T y0, T step, size_t width, size_t height, size_t tile, T * out, FillStats<T> & stats) {
+		Fill::mortonGrid(source, x0, y0, step, width, height, tile, out, stats);
+	}
+
+	// As fillVolume, in tile x tile x tile bricks in row order, each brick's
+	// voxels in Morton order, evaluated as by fillMortonGrid. tile must be a
+	// power of two (at most 2^10) dividing width, height and depth.
+	template <typename Source, typename T>
+	void fillMortonVolume(const Source & source, T x0, T y0, T z0, T step, size_t width, size_t height, size_t depth, size_t tile, T * out) {
+		Fill::NoStats none;
+		Fill::mortonVolume(source, x0, y0, z0, step, width, height, depth, tile, out, none);
+	}
+
+	template <typename Source, typename T>
+	void fillMortonVolume(const Source & source, T x0, T y0, T z0, T step, size_t width, size_t height, size_t depth, size_t tile, T * out, FillStats<T> & stats) {
+		Fill::mortonVolume(source, x0, y0, z0, step, width, height, depth, tile, out, stats);
+	}
+
+	// As fillGrid, anti-aliased: each pixel is filtered from a samples x
+	// samples pattern of subsamples per pixel spacing, centered on the point
+	// fillGrid would sample.
+	//
+	// The subsamples of the whole image form one finer grid, evaluated a row
+	// at a time through the source's evalBatch, so that a tent subsample is
+	// evaluated once for the two to four pixels it counts for, and each
+	// batch walks a row across few lattice cells. Rows of the finer grid are
+	// filtered into the output as they are evaluated; a row of subsamples is
+	// the only buffer.
+	//
+	// samples must be at least 1; with none, or an empty view, nothing is
+	// written.
+	template <typename Source, typename T>
+	void fillSupersampledGrid(const Source & source, T x0, T y0, T step, size_t samples, SampleFilter filter, const ImageView<T> & out) {
+		OSN_TRACE_SPAN("fillSupersampledGrid");
+		if (samples == 0 || out.width == 0 || out.height == 0) { return; }
+		const Fill::SampleAxis<T> columns(out.width, samples, filter), rows(out.height, samples, filter);
+		const size_t width = columns.position.size();
+		std::vector<T> x(width), y(width), values(width), filtered(out.width);
+		for (size_t f = 0; f < width; ++f) { x[f] = x0 + step * columns.position[f]; }
+		const T scale = (T)1.0 / (columns.total * rows.total);
+		// The last subsample row that adds to each output row, after which it
+		// is scaled. Rows are cleared when the first one reaches them.
+		std::vector<size_t> last(out.height, 0);
+		for (size_t r = 0; r < rows.position.size(); ++r) {
+			for (int k = 0; k < 2; ++k) {
+				if (rows.weight[2 * r + k] != (T)0.0) { last[rows.pixel[2 * r + k]] = r; }
+			}
+		}
+		size_t started = 0, finished = 0;
+		for (size_t r = 0; r < rows.position.size(); ++r) {
+			const T yr = y0 + step * rows.position[r];
+			for (size_t f = 0; f < width; ++f) { y[f] = yr; }
+			for (size_t begin = 0; begin < width; begin += Fill::BLOCK) {
+				size_t n = width - begin;
+				if (n > Fill::BLOCK) { n = Fill::BLOCK; }
+				source.evalBatch(&x[begin], &y[begin], &values[begin], n);
+			}
+			for (size_t i = 0; i < out.width; ++i) { filtered[i] = (T)0.0; }
+			for (size_t f = 0; f < width; ++f) {
+				filtered[columns.pixel[2 * f]] += columns.weight[2 * f] * values[f];
+				filtered[columns.pixel[2 * f + 1]] += columns.weight[2 * f + 1] * values[f];
+			}
+			for (int k = 0; k < 2; ++k) {
+				const size_t p = rows.pixel[2 * r + k];
+				const T w = rows.weight[2 * r + k];
+				if (w == (T)0.0) { continue; }
+				for (; started <= p; ++started) {
+					T * dest = out.row(started);
+					for (size_t i = 0; i < out.width; ++i) { dest[i] = (T)0.0; }
+				}
+				T * dest = out.row(p);
+				for (size_t i = 0; i < out.width; ++i) { dest[i] += w * filtered[i]; }
+			}
+			for (; finished < started && last[finished] <= r; ++finished) {
+				T * dest = out.row(finished);
+				for (size_t i = 0; i < out.width; ++i) { dest[i] *= scale; }
+			}
+		}
+	}
+
+	// Value and gradient of source at every pixel of the grid, through its
+	// evalGradientBatch.
+	template <typename Source, typename T, int N>
+	void fillGradientGrid(const Source & source, T x0, T y0, T step, const ImageView<ValueGradient<T, N> > & out) {
+		Fill::grid(source, x0, y0, step, out);
+	}
+
+	template <typename Source, typename T, int N>
+	void fillGradientGrid(const Source & source, T x0, T y0, T z, T step, const ImageView<ValueGradient<T, N> > & out) {
+		Fill::grid(source, x0, y0, z, step, out);
+	}
+
+	// Value, gradient and Hessian of source at every pixel of the grid,
+	// through its hessianBatch.
+	template <typename Source, typename T, int N>
+	void fillHessianGrid(const Source & source, T x0, T y0, T step, const ImageView<Derivatives<T, N> > & out) {
+		Fill::grid(source, x0, y0, step, out);
+	}
+
+	template <typename Source, typename T, int N>
+	void fillHessianGrid(const Source & source, T x0, T y0, T z, T step, const ImageView<Derivatives<T, N> > & out) {
+		Fill::grid(source, x0, y0, z, step, out);
+	}
+
+	// Writes the normal of the height field strength * source(x, y) at every
+	// pixel of the grid in one pass, from the analytic gradient given by the
+	// source's evalGradientBatch (a Noise<2> or a DerivativeFractal of one),
+	// instead of filling heights and filtering them.
+	//
+	// The normal is (-strength * dx, -strength * dy, 1), normalized, with
+	// derivatives taken in the source's coordinates: x along the columns and
+	// y down the rows, the Direct3D convention. To bake in texel units, use
+	// a strength of height scale * step. Out is an ImageView of NormalRGB8
+	// or NormalOct16.
+	template <typename Source, typename T, typename Normal>
+	void fillNormalMap(const Source & source, T x0, T y0, T step, T strength, const ImageView<Normal> & out) {
+		Fill::grid(Fill::NormalSource<Source, T>(source, strength), x0, y0, step, out);
+	}
+
+	// Samples source on the sphere of the given radius around the origin, at
+	// the direction through the center of every pixel of one cube map face.
+	//
+	// Along a row the unnormalized direction advances by a constant step, so
+	// each pixel costs three adds, a square root and a division before the
+	// source is evaluated.
+	template <typename Source, typename T>
+	void fillCubeFace(const Source & source, CubeFace face, T radius, const ImageView<T> & out) {
+		OSN_TRACE_SPAN("fillCubeFace");
+		const Fill::CubeBasis & basis = Fill::cubeBasis(face);
+		const T du = (T)2.0 / (T) out.width, dv = (T)2.0 / (T) out.height;
+		T x[Fill::BLOCK], y[Fill::BLOCK], z[Fill::BLOCK];
+		for (size_t row = 0; row < out.height; ++row) {
+			T v = ((T) row + (T)0.5) * dv - (T)1.0;
+			T * dest = out.row(row);
+			for (size_t begin = 0; begin < out.width; begin += Fill::BLOCK) {
+				size_t n = out.width - begin;
+				if (n > Fill::BLOCK) { n = Fill::BLOCK; }
+				T u = ((T) begin + (T)0.5) * du - (T)1.0;
+				T p[3], step[3];
+				for (int d = 0; d < 3; ++d) {
+					p[d] = (T) basis.major[d] + u * (T) basis.across[d] + v * (T) basis.down[d];
+					step[d] = du * (T) basis.across[d];
+				}
+				for (size_t i = 0; i < n; ++i) {
+					// One of the components is the constant major axis, the others
+					// are at most 1 in magnitude, so this never divides by zero.
+					T scale = radius / std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+					x[i] = p[0] * scale;
+					y[i] = p[1] * scale;
+					z[i] = p[2] * scale;
+					p[0] += step[0];
+					p[1] += step[1];
+					p[2] += step[2];
+				}
+				source.evalBatch(x, y, z, dest + begin, n);
+			}
+		}
+	}
+
+	// Fills all six faces, indexed by CubeFace. The faces tile the sphere, so
+	// the result is seamless when sampled as a cube map.
+	template <typename Source, typename T>
+	void fillCubeMap(const Source & source, T radius, const ImageView<T> (&faces)[6]) {
+		for (int face = 0; face < 6; ++face) {
+			fillCubeFace(source, (CubeFace) face, radius, faces[face]);
+		}
+	}
+
+	// Samples source on the sphere of the given radius around the origin, in
+	// an equirectangular (latitude-longitude) projection: columns span the
+	// longitudes -pi..pi, rows the latitudes from the +z pole at the top to
+	// the -z pole at the bottom. The left and right edges meet seamlessly.
+	//
+	// The direction of every column is computed once per image; a row then
+	// scales it by the cosine of its latitude.
+	template <typename Source, typename T>
+	void fillEquirect(const Source & source, T radius, const ImageView<T> & out) {
+		OSN_TRACE_SPAN("fillEquirect");
+		std::vector<T> cosines, sines;
+		Fill::columnDirections(out.width, cosines, sines);
+		const double step = 3.141592653589793238463 / (double) out.height;
+		for (size_t row = 0; row < out.height; ++row) {
+			double latitude = 1.570796326794896619231 - ((double) row + 0.5) * step;
+			Fill::fillRing(source, cosines.data(), sines.data(),
+				(T) (radius * std::cos(latitude)), (T) (radius * std::sin(latitude)), out.row(row), out.width);
+		}
+	}
+
+	// Samples source on the side of a cylinder of the given radius around the
+	// z axis, for z from height / 2 at the top row to -height / 2 at the
+	// bottom. Columns span the longitudes -pi..pi, so the left and right edges
+	// meet seamlessly; unlike an equirectangular sphere the features keep the
+	// same size on every row.
+	template <typename Source, typename T>
+	void fillCylinder(const Source & source, T radius, T height, const ImageView<T> & out) {
+		OSN_TRACE_SPAN("fillCylinder");
+		std::vector<T> cosines, sines;
+		Fill::columnDirections(out.width, cosines, sines);
+		const T step = height / (T) out.height;
+		for (size_t row = 0; row < out.height; ++row) {
+			T z = height * (T)0.5 - ((T) row + (T)0.5) * step;
+			Fill::fillRing(source, cosines.data(), sines.data(), radius, z, out.row(row), out.width);
+		}
+	}
+
+}
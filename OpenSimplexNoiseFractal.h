@@ -0,0 +1,324 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * Fractal sums
+ *
+ * Fractal<Source> adds several octaves of a generator together, each at a
+ * higher frequency and lower amplitude than the last (fractional Brownian
+ * motion). It has the same eval and evalBatch interface as the generator it
+ * wraps, so it can be passed anywhere a Noise<N> is accepted, including the
+ * fills in OpenSimplexNoiseFill.h. DerivativeFractal<Source> does the same
+ * while tracking the analytic gradient of the sum.
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "OpenSimplexNoise.h"
+
+
+namespace OSN {
+
+	// Sum of octaves of Source, where octave o is sampled at lacunarity^o
+	// times the input coordinates and weighted by gain^o. The sum is divided
+	// by the total weight, so it stays in the range of a single octave.
+	//
+	// Holds a reference to the source, which must outlive it.
+	template <typename Source>
+	class Fractal {
+
+	public:
+
+		Fractal(const Source & source, int octaves, double lacunarity = 2.0, double gain = 0.5) :
+			source(&source), octaves(octaves), lacunarity(lacunarity), gain(gain) {
+			double total = 0.0, amplitude = 1.0;
+			for (int o = 0; o < octaves; ++o) {
+				total += amplitude;
+				amplitude *= gain;
+			}
+			normalization = (total > 0.0) ? 1.0 / total : 0.0;
+		}
+
+		const Source & getSource(void) const { return *source; }
+		int getOctaves(void) const { return octaves; }
+		double getLacunarity(void) const { return lacunarity; }
+		double getGain(void) const { return gain; }
+
+		template <typename T, typename... Ts>
+		T eval(T x0, Ts... xs) const {
+			T value = (T)0.0;
+			T frequency = (T)1.0, amplitude = (T)normalization;
+			for (int o = 0; o < octaves; ++o) {
+				value += amplitude * source->eval((T)(x0 * frequency), (T)(xs * frequency)...);
+				frequency *= (T)lacunarity;
+				amplitude *= (T)gain;
+			}
+			return value;
+		}
+
+		// Evaluates count points through the source's evalBatch, one octave of a
+		// block of points at a time.
+		template <typename T>
+		void evalBatch(const T * x, const T * y, T * out, size_t count) const {
+			const T * in[2] = { x, y };
+			evalBatchBlocks<2>(in, out, count);
+		}
+
+		template <typename T>
+		void evalBatch(const T * x, const T * y, const T * z, T * out, size_t count) const {
+			const T * in[3] = { x, y, z };
+			evalBatchBlocks<3>(in, out, count);
+		}
+
+		template <typename T>
+		void evalBatch(const T * x, const T * y, const T * z, const T * w, T * out, size_t count) const {
+			const T * in[4] = { x, y, z, w };
+			evalBatchBlocks<4>(in, out, count);
+		}
+
+	protected:
+
+		static const size_t BLOCK = 256;
+
+		const Source * source;
+		int octaves;
+		double lacunarity, gain, normalization;
+
+	private:
+
+		template <typename T>
+		void sourceBatch(T (&in)[2][BLOCK], T * out, size_t count) const {
+			source->evalBatch(in[0], in[1], out, count);
+		}
+
+		template <typename T>
+		void sourceBatch(T (&in)[3][BLOCK], T * out, size_t count) const {
+			source->evalBatch(in[0], in[1], in[2], out, count);
+		}
+
+		template <typename T>
+		void sourceBatch(T (&in)[4][BLOCK], T * out, size_t count) const {
+			source->evalBatch(in[0], in[1], in[2], in[3], out, count);
+		}
+
+		template <int N, typename T>
+		void evalBatchBlocks(const T * const * in, T * out, size_t count) const {
+			T scaled[N][BLOCK];
+			T octave[BLOCK];
+			for (size_t begin = 0; begin < count; begin += BLOCK) {
+				size_t n = count - begin;
+				if (n > BLOCK) { n = BLOCK; }
+				T * block = out + begin;
+				for (size_t i = 0; i < n; ++i) { block[i] = (T)0.0; }
+				T frequency = (T)1.0, amplitude = (T)normalization;
+				for (int o = 0; o < octaves; ++o) {
+					for (int d = 0; d < N; ++d) {
+						for (size_t i = 0; i < n; ++i) { scaled[d][i] = in[d][begin + i] * frequency; }
+					}
+					sourceBatch(scaled, octave, n);
+					for (size_t i = 0; i < n; ++i) { block[i] += amplitude * octave[i]; }
+					frequency *= (T)lacunarity;
+					amplitude *= (T)gain;
+				}
+			}
+		}
+
+	};
+
+	// Fractal sum that tracks its analytic gradient, taking the value and
+	// gradient of each octave from one evalGradient call on Source (Noise<2>
+	// or Noise<3>) instead of an eval and a deval.
+	//
+	// With a damping k > 0, the weight of each octave is also divided by
+	// 1 + k |G|^2, where G is the gradient of the octaves summed so far, so
+	// that later octaves fade on steep slopes as on eroded terrain. The
+	// gradient returned treats those factors as constants: it is the sum of
+	// the octaves' gradients at their damped weights, and is exact when k is 0.
+	//
+	// It is built on Fractal, which sums the values when there is no
+	// damping, but only exposes the 2D and 3D interface that takes it into
+	// account.
+	//
+	// Holds a reference to the source, which must outlive it.
+	template <typename Source>
+	class DerivativeFractal : protected Fractal<Source> {
+
+		typedef Fractal<Source> Base;
+
+	public:
+
+		DerivativeFractal(const Source & source, int octaves, double lacunarity = 2.0, double gain = 0.5, double damping = 0.0) :
+			Base(source, octaves, lacunarity, gain), damping(damping) {}
+
+		using Base::getSource;
+		using Base::getOctaves;
+		using Base::getLacunarity;
+		using Base::getGain;
+		double getDamping(void) const { return damping; }
+
+		// Without damping the octaves do not depend on each other's gradients,
+		// and the values are summed through the source's eval by Fractal.
+		template <typename T>
+		T eval(T x, T y) const {
+			if (damping == 0.0) { return Base::eval(x, y); }
+			ValueGradient<T, 2> out;
+			evalGradient(x, y, out);
+			return out.value;
+		}
+
+		template <typename T>
+		T eval(T x, T y, T z) const {
+			if (damping == 0.0) { return Base::eval(x, y, z); }
+			ValueGradient<T, 3> out;
+			evalGradient(x, y, z, out);
+			return out.value;
+		}
+
+		template <typename T>
+		void evalGradient(T x, T y, ValueGradient<T, 2> & out) const {
+			clear(out);
+			ValueGradient<T, 2> octave;
+			T frequency = (T)1.0, amplitude = (T)normalization;
+			for (int o = 0; o < octaves; ++o) {
+				source->evalGradient(x * frequency, y * frequency, octave);
+				accumulate(out, octave, frequency, amplitude);
+				frequency *= (T)lacunarity;
+				amplitude *= (T)gain;
+			}
+		}
+
+		template <typename T>
+		void evalGradient(T x, T y, T z, ValueGradient<T, 3> & out) const {
+			clear(out);
+			ValueGradient<T, 3> octave;
+			T frequency = (T)1.0, amplitude = (T)normalization;
+			for (int o = 0; o < octaves; ++o) {
+				source->evalGradient(x * frequency, y * frequency, z * frequency, octave);
+				accumulate(out, octave, frequency, amplitude);
+				frequency *= (T)lacunarity;
+				amplitude *= (T)gain;
+			}
+		}
+
+		// Evaluates count points through the source's evalGradientBatch, one
+		// octave of a block of points at a time.
+		template <typename T>
+		void evalGradientBatch(const T * x, const T * y, ValueGradient<T, 2> * out, size_t count) const {
+			const T * in[2] = { x, y };
+			evalBatchBlocks<2>(in, out, count);
+		}
+
+		template <typename T>
+		void evalGradientBatch(const T * x, const T * y, const T * z, ValueGradient<T, 3> * out, size_t count) const {
+			const T * in[3] = { x, y, z };
+			evalBatchBlocks<3>(in, out, count);
+		}
+
+		// As evalGradientBatch, keeping only the values, so that this can be
+		// used as the source of a fill. Without damping, the octaves are summed
+		// through the source's evalBatch by Fractal instead.
+		template <typename T>
+		void evalBatch(const T * x, const T * y, T * out, size_t count) const {
+			if (damping == 0.0) { Base::evalBatch(x, y, out, count); return; }
+			const T * in[2] = { x, y };
+			evalValueBlocks<2>(in, out, count);
+		}
+
+		template <typename T>
+		void evalBatch(const T * x, const T * y, const T * z, T * out, size_t count) const {
+			if (damping == 0.0) { Base::evalBatch(x, y, z, out, count); return; }
+			const T * in[3] = { x, y, z };
+			evalValueBlocks<3>(in, out, count);
+		}
+
+	private:
+
+		using Base::BLOCK;
+		using Base::source;
+		using Base::octaves;
+		using Base::lacunarity;
+		using Base::gain;
+		using Base::normalization;
+
+		double damping;
+
+		template <int N, typename T>
+		static void clear(ValueGradient<T, N> & out) {
+			out.value = (T)0.0;
+			for (int d = 0; d < N; ++d) { out.gradient[d] = (T)0.0; }
+		}
+
+		// Adds an octave sampled at frequency times the input coordinates, so
+		// that its gradient is frequency times the source's.
+		template <int N, typename T>
+		void accumulate(ValueGradient<T, N> & sum, const ValueGradient<T, N> & octave, T frequency, T amplitude) const {
+			T weight = amplitude;
+			if (damping != 0.0) {
+				T slope = (T)0.0;
+				for (int d = 0; d < N; ++d) { slope += sum.gradient[d] * sum.gradient[d]; }
+				weight /= (T)1.0 + (T)damping * slope;
+			}
+			sum.value += weight * octave.value;
+			T scale = weight * frequency;
+			for (int d = 0; d < N; ++d) { sum.gradient[d] += scale * octave.gradient[d]; }
+		}
+
+		template <typename T>
+		void sourceBatch(T (&in)[2][BLOCK], ValueGradient<T, 2> * out, size_t count) const {
+			source->evalGradientBatch(in[0], in[1], out, count);
+		}
+
+		template <typename T>
+		void sourceBatch(T (&in)[3][BLOCK], ValueGradient<T, 3> * out, size_t count) const {
+			source->evalGradientBatch(in[0], in[1], in[2], out, count);
+		}
+
+		template <int N, typename T>
+		void evalBatchBlocks(const T * const * in, ValueGradient<T, N> * out, size_t count) const {
+			T scaled[N][BLOCK];
+			ValueGradient<T, N> octave[BLOCK];
+			for (size_t begin = 0; begin < count; begin += BLOCK) {
+				size_t n = count - begin;
+				if (n > BLOCK) { n = BLOCK; }
+				ValueGradient<T, N> * block = out + begin;
+				for (size_t i = 0; i < n; ++i) { clear(block[i]); }
+				T frequency = (T)1.0, amplitude = (T)normalization;
+				for (int o = 0; o < octaves; ++o) {
+					for (int d = 0; d < N; ++d) {
+						for (size_t i = 0; i < n; ++i) { scaled[d][i] = in[d][begin + i] * frequency; }
+					}
+					sourceBatch(scaled, octave, n);
+					for (size_t i = 0; i < n; ++i) { accumulate(block[i], octave[i], frequency, amplitude); }
+					frequency *= (T)lacunarity;
+					amplitude *= (T)gain;
+				}
+			}
+		}
+
+		template <int N, typename T>
+		void evalValueBlocks(const T * const * in, T * out, size_t count) const {
+			ValueGradient<T, N> sums[BLOCK];
+			const T * block[N];
+			for (size_t begin = 0; begin < count; begin += BLOCK) {
+				size_t n = count - begin;
+				if (n > BLOCK) { n = BLOCK; }
+				for (int d = 0; d < N; ++d) { block[d] = in[d] + begin; }
+				evalBatchBlocks<N>(block, sums, n);
+				for (size_t i = 0; i < n; ++i) { out[begin + i] = sums[i].value; }
+			}
+		}
+
+	};
+
+}
@@ -0,0 +1,395 @@
+/*
+ * OpenSimplex (Simplectic) Noise Differential Fuzzer in C++
+ *
+ * This file feeds identical coordinates to every evaluation path compiled
+ * from OpenSimplexNoise.h and reports the worst divergence of each path from
+ * the scalar double-precision eval, in units in the last place (ULP) of the
+ * path's own result type as well as in absolute terms.
+ *
+ * Inputs are biased towards the places where paths are most likely to
+ * disagree: points on and next to the stretched lattice, negative
+ * coordinates (where fastFloori and OSN_ALWAYS_POSITIVE matter) and very
+ * large magnitudes. Every input is representable as a float, so all paths
+ * see exactly the same coordinates.
+ *
+ * Standalone (random and edge-case inputs, no external dependencies):
+ *   g++ -o OpenSimplexNoiseFuzz -O2 OpenSimplexNoiseFuzz.cc OpenSimplexNoise.cpp
+ *   ./OpenSimplexNoiseFuzz [iterations] [seed]
+ *
+ * As a libFuzzer target:
+ *   clang++ -o OpenSimplexNoiseFuzz -O1 -g -fsanitize=fuzzer -DOSN_LIBFUZZER OpenSimplexNoiseFuzz.cc OpenSimplexNoise.cpp
+ *
+ * Every path has a tolerance in ulp, and a run exits with status 1 if any
+ * path exceeds its own. The batch kernels, FastFloor and CompactPolicy must
+ * reproduce eval bit for bit (the batch kernels on every clone). The float,
+ * long double and StrictFloor paths get a bound measured on ten million
+ * inputs with a few times headroom, over the coordinate range in which
+ * their rounding stays bounded.
+ *
+ * Define OSN_FUZZ_ABS_TOLERANCE to abort on the first input whose absolute
+ * divergence exceeds it (useful to let libFuzzer minimize a failing case).
+ *
+ * The batch kernels are multiversioned, and a run only reaches the clone for
+ * the CPU it is on. To check every x86-64 level, build one version per
+ * level and run each on a CPU that supports it. The clones never contract
+ * into FMA instructions, so neither may these builds:
+ *   for level in 1 2 3 4; do
+ *     march=x86-64; [ $level -gt 1 ] && march=x86-64-v$level
+ *     g++ -o OpenSimplexNoiseFuzz-$march -O2 -march=$march -ffp-contract=off -DOSN_NO_MULTIVERSIONING OpenSimplexNoiseFuzz.cc OpenSimplexNoise.cpp
+ *     ./OpenSimplexNoiseFuzz-$march 1000000 1
+ *   done
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "OpenSimplexNoise.h"
+
+
+// Largest coordinate magnitude generated. Beyond this the lattice index no
+// longer fits comfortably in a float mantissa and every path degenerates.
+const double MAX_MAGNITUDE = 16777216.0;
+
+struct Kernel {
+  const char * name;
+  int dims;
+  // Digits of precision of the result type, used to scale ULP distances.
+  int digits;
+  double (*eval) (const double * p);
+  // Most ulp the path may diverge by before the run fails, or REPORT_ONLY.
+  double tolerance;
+  // Largest coordinate magnitude the tolerance holds for; inputs beyond it
+  // are only reported.
+  double range;
+  // Path compared against, or NULL for the scalar double eval of dims.
+  double (*reference) (const double * p);
+};
+
+const double REPORT_ONLY = -1.0;
+
+// 32-bit indices and byte tables; inputs are kept within their range.
+struct CompactPolicy : OSN::DefaultPolicy {
+  typedef OSN::FastFloor Floor;
+  typedef int32_t Index;
+  typedef uint8_t Perm;
+  typedef double Gradient;
+};
+
+static OSN::Noise<1> noise1(1234);
+static OSN::Noise<2> noise2(1234);
+static OSN::Noise<3> noise3(1234);
+static OSN::Noise<4> noise4(1234);
+static OSN::Noise<1, CompactPolicy> compactNoise1(1234);
+static OSN::Noise<2, CompactPolicy> compactNoise2(1234);
+static OSN::Noise<3, CompactPolicy> compactNoise3(1234);
+static OSN::Noise<4, CompactPolicy> compactNoise4(1234);
+
+static double ref1 (const double * p) { return noise1.eval(p[0]); }
+static double ref2 (const double * p) { return noise2.eval(p[0], p[1]); }
+static double ref3 (const double * p) { return noise3.eval(p[0], p[1], p[2]); }
+static double ref4 (const double * p) { return noise4.eval(p[0], p[1], p[2], p[3]); }
+
+static double float1 (const double * p) { return noise1.eval((float)p[0]); }
+static double float2 (const double * p) { return noise2.eval((float)p[0], (float)p[1]); }
+static double float3 (const double * p) { return noise3.eval((float)p[0], (float)p[1], (float)p[2]); }
+static double float4 (const double * p) { return noise4.eval((float)p[0], (float)p[1], (float)p[2], (float)p[3]); }
+
+static double long1 (const double * p) { return (double)noise1.eval((long double)p[0]); }
+static double long2 (const double * p) { return (double)noise2.eval((long double)p[0], (long double)p[1]); }
+static double long3 (const double * p) { return (double)noise3.eval((long double)p[0], (long double)p[1], (long double)p[2]); }
+static double long4 (const double * p) { return (double)noise4.eval((long double)p[0], (long double)p[1], (long double)p[2], (long double)p[3]); }
+
+static double strict1 (const double * p) { return noise1.evalKernel<OSN::StrictFloor>(p[0]); }
+static double strict2 (const double * p) { return noise2.evalKernel<OSN::StrictFloor>(p[0], p[1]); }
+static double strict3 (const double * p) { return noise3.evalKernel<OSN::StrictFloor>(p[0], p[1], p[2]); }
+static double strict4 (const double * p) { return noise4.evalKernel<OSN::StrictFloor>(p[0], p[1], p[2], p[3]); }
+
+static double fast1 (const double * p) { return noise1.evalKernel<OSN::FastFloor>(p[0]); }
+static double fast2 (const double * p) { return noise2.evalKernel<OSN::FastFloor>(p[0], p[1]); }
+static double fast3 (const double * p) { return noise3.evalKernel<OSN::FastFloor>(p[0], p[1], p[2]); }
+static double fast4 (const double * p) { return noise4.evalKernel<OSN::FastFloor>(p[0], p[1], p[2], p[3]); }
+
+static double compact1 (const double * p) { return compactNoise1.eval(p[0]); }
+static double compact2 (const double * p) { return compactNoise2.eval(p[0], p[1]); }
+static double compact3 (const double * p) { return compactNoise3.eval(p[0], p[1], p[2]); }
+static double compact4 (const double * p) { return compactNoise4.eval(p[0], p[1], p[2], p[3]); }
+
+// The multiversioned batch kernels, one point at a time.
+static double batch1 (const double * p) { double v; noise1.evalBatch(&p[0], &v, 1); return v; }
+static double batch2 (const double * p) { double v; noise2.evalBatch(&p[0], &p[1], &v, 1); return v; }
+static double batch3 (const double * p) { double v; noise3.evalBatch(&p[0], &p[1], &p[2], &v, 1); return v; }
+static double batch4 (const double * p) { double v; noise4.evalBatch(&p[0], &p[1], &p[2], &p[3], &v, 1); return v; }
+
+static double floatBatch2 (const double * p) {
+  const float x = (float)p[0], y = (float)p[1];
+  float v;
+  noise2.evalBatch(&x, &y, &v, 1);
+  return v;
+}
+
+static double floatBatch3 (const double * p) {
+  const float x = (float)p[0], y = (float)p[1], z = (float)p[2];
+  float v;
+  noise3.evalBatch(&x, &y, &z, &v, 1);
+  return v;
+}
+
+static double gradientBatch2 (const double * p) { OSN::ValueGradient<double, 2> v; noise2.evalGradientBatch(&p[0], &p[1], &v, 1); return v.value; }
+static double gradientBatch3 (const double * p) { OSN::ValueGradient<double, 3> v; noise3.evalGradientBatch(&p[0], &p[1], &p[2], &v, 1); return v.value; }
+static double hessianBatch2 (const double * p) { OSN::Derivatives<double, 2> v; noise2.hessianBatch(&p[0], &p[1], &v, 1); return v.value; }
+static double hessianBatch3 (const double * p) { OSN::Derivatives<double, 3> v; noise3.hessianBatch(&p[0], &p[1], &p[2], &v, 1); return v.value; }
+
+// Reference paths, indexed by dimension.
+static double (* const REFERENCE[5]) (const double *) = { NULL, ref1, ref2, ref3, ref4 };
+
+// Every other compiled path. New kernel variants should be added here.
+//
+// Float 4D, long double 3D and 4D and StrictFloor 4D are only reported.
+// Near a boundary between the regions of the lattice, their rounding can
+// select a different set of vertices from the double eval, and the noise
+// jumps by up to about 0.2 across that choice. Such inputs occur even next
+// to the origin, so no ulp bound on these paths would be meaningful.
+static const Kernel KERNELS[] = {
+  { "Noise<1>::eval<float>", 1, std::numeric_limits<float>::digits, float1, 2048.0, MAX_MAGNITUDE, NULL },
+  { "Noise<2>::eval<float>", 2, std::numeric_limits<float>::digits, float2, 524288.0, 1024.0, NULL },
+  { "Noise<3>::eval<float>", 3, std::numeric_limits<float>::digits, float3, 524288.0, 1024.0, NULL },
+  { "Noise<4>::eval<float>", 4, std::numeric_limits<float>::digits, float4, REPORT_ONLY, 0.0, NULL },
+  { "Noise<1>::eval<long double>", 1, std::numeric_limits<double>::digits, long1, 1024.0, MAX_MAGNITUDE, NULL },
+  { "Noise<2>::eval<long double>", 2, std::numeric_limits<double>::digits, long2, 524288.0, 1024.0, NULL },
+  { "Noise<3>::eval<long double>", 3, std::numeric_limits<double>::digits, long3, REPORT_ONLY, 0.0, NULL },
+  { "Noise<4>::eval<long double>", 4, std::numeric_limits<double>::digits, long4, REPORT_ONLY, 0.0, NULL },
+  { "Noise<1>::evalKernel<StrictFloor>", 1, std::numeric_limits<double>::digits, strict1, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<2>::evalKernel<StrictFloor>", 2, std::numeric_limits<double>::digits, strict2, 131072.0, 1024.0, NULL },
+  { "Noise<3>::evalKernel<StrictFloor>", 3, std::numeric_limits<double>::digits, strict3, 262144.0, 1024.0, NULL },
+  { "Noise<4>::evalKernel<StrictFloor>", 4, std::numeric_limits<double>::digits, strict4, REPORT_ONLY, 0.0, NULL },
+  { "Noise<1>::evalKernel<FastFloor>", 1, std::numeric_limits<double>::digits, fast1, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<2>::evalKernel<FastFloor>", 2, std::numeric_limits<double>::digits, fast2, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<3>::evalKernel<FastFloor>", 3, std::numeric_limits<double>::digits, fast3, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<4>::evalKernel<FastFloor>", 4, std::numeric_limits<double>::digits, fast4, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<1, CompactPolicy>::eval<double>", 1, std::numeric_limits<double>::digits, compact1, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<2, CompactPolicy>::eval<double>", 2, std::numeric_limits<double>::digits, compact2, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<3, CompactPolicy>::eval<double>", 3, std::numeric_limits<double>::digits, compact3, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<4, CompactPolicy>::eval<double>", 4, std::numeric_limits<double>::digits, compact4, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<1>::evalBatch<double>", 1, std::numeric_limits<double>::digits, batch1, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<2>::evalBatch<double>", 2, std::numeric_limits<double>::digits, batch2, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<3>::evalBatch<double>", 3, std::numeric_limits<double>::digits, batch3, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<4>::evalBatch<double>", 4, std::numeric_limits<double>::digits, batch4, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<2>::evalBatch<float>", 2, std::numeric_limits<float>::digits, floatBatch2, 0.0, MAX_MAGNITUDE, float2 },
+  { "Noise<3>::evalBatch<float>", 3, std::numeric_limits<float>::digits, floatBatch3, 0.0, MAX_MAGNITUDE, float3 },
+  { "Noise<2>::evalGradientBatch<double>", 2, std::numeric_limits<double>::digits, gradientBatch2, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<3>::evalGradientBatch<double>", 3, std::numeric_limits<double>::digits, gradientBatch3, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<2>::hessianBatch<double>", 2, std::numeric_limits<double>::digits, hessianBatch2, 0.0, MAX_MAGNITUDE, NULL },
+  { "Noise<3>::hessianBatch<double>", 3, std::numeric_limits<double>::digits, hessianBatch3, 0.0, MAX_MAGNITUDE, NULL },
+};
+const int NUM_KERNELS = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+struct Worst {
+  double ulp;
+  double ulpInput[4];
+  double abs;
+  double absInput[4];
+  // Inputs on which the path exceeded its tolerance.
+  long failures;
+};
+
+static Worst worst[NUM_KERNELS];
+
+// Distance between a and b in ULPs of a type with the given mantissa digits,
+// measured at the magnitude of the reference value b.
+static double ulp_distance (double a, double b, int digits) {
+  if (a == b) return 0.0;
+  if (std::isnan(a) || std::isnan(b)) return std::numeric_limits<double>::infinity();
+  int exponent;
+  std::frexp(b, &exponent);
+  // Noise values are O(1), so results near zero are measured against the
+  // spacing at 2^-8 rather than producing astronomically large counts.
+  exponent = std::max(exponent, -8);
+  return std::fabs(a - b) / std::ldexp(1.0, exponent - digits);
+}
+
+static void print_input (std::ostream & out, const double * p, int dims) {
+  out << "(";
+  for (int i = 0; i < dims; ++i) {
+    out << (i ? ", " : "") << p[i];
+  }
+  out << ")";
+}
+
+// Evaluates every kernel on p and records new worst cases.
+// Returns false if a kernel exceeded its tolerance, or OSN_FUZZ_ABS_TOLERANCE
+// is defined and was exceeded.
+static bool check (const double * p) {
+  double ref[5] = { 0.0, ref1(p), ref2(p), ref3(p), ref4(p) };
+  bool ok = true;
+  for (int k = 0; k < NUM_KERNELS; ++k) {
+    const Kernel & kernel = KERNELS[k];
+    double r = kernel.reference ? kernel.reference(p) : ref[kernel.dims];
+    double v = kernel.eval(p);
+    double ulp = ulp_distance(v, r, kernel.digits);
+    double abs = std::fabs(v - r);
+    if (ulp > worst[k].ulp) {
+      worst[k].ulp = ulp;
+      std::memcpy(worst[k].ulpInput, p, sizeof(worst[k].ulpInput));
+    }
+    if (abs > worst[k].abs) {
+      worst[k].abs = abs;
+      std::memcpy(worst[k].absInput, p, sizeof(worst[k].absInput));
+    }
+    double magnitude = 0.0;
+    for (int i = 0; i < kernel.dims; ++i) magnitude = std::max(magnitude, std::fabs(p[i]));
+    if (kernel.tolerance != REPORT_ONLY && magnitude <= kernel.range && !(ulp <= kernel.tolerance)) {
+      // Report the first input only; the total is in the summary.
+      if (worst[k].failures++ == 0) {
+        std::cerr << kernel.name << " diverges by " << ulp << " ulp at ";
+        print_input(std::cerr, p, kernel.dims);
+        std::cerr << std::endl;
+      }
+      ok = false;
+    }
+#ifdef OSN_FUZZ_ABS_TOLERANCE
+    if (!(abs <= OSN_FUZZ_ABS_TOLERANCE)) {
+      std::cerr << kernel.name << " diverges by " << abs << " at ";
+      print_input(std::cerr, p, kernel.dims);
+      std::cerr << std::endl;
+      ok = false;
+    }
+#endif
+  }
+  return ok;
+}
+
+static void report (std::ostream & out) {
+  for (int k = 0; k < NUM_KERNELS; ++k) {
+    out << KERNELS[k].name << ": worst " << worst[k].ulp << " ulp at ";
+    print_input(out, worst[k].ulpInput, KERNELS[k].dims);
+    out << ", worst " << worst[k].abs << " abs at ";
+    print_input(out, worst[k].absInput, KERNELS[k].dims);
+    if (worst[k].failures) {
+      out << ", FAILED on " << worst[k].failures << " inputs (tolerance " << KERNELS[k].tolerance << " ulp)";
+    }
+    out << std::endl;
+  }
+}
+
+// Turns 9 bytes into one float-representable coordinate. The first byte
+// selects the shape of the value, the remaining 8 supply its bits.
+static double decode_coordinate (const uint8_t * bytes) {
+  uint64_t bits;
+  std::memcpy(&bits, bytes + 1, sizeof(bits));
+  double v;
+  switch (bytes[0] % 3) {
+    case 0: {
+      // Arbitrary finite float, clamped to the supported magnitude.
+      float f;
+      uint32_t fbits = (uint32_t)bits;
+      std::memcpy(&f, &fbits, sizeof(f));
+      v = std::isfinite(f) ? f : 0.0;
+      break;
+    }
+    case 1:
+      // Uniform in a small window around the origin, both signs.
+      v = ((int64_t)(bits >> 40) - (1LL << 23)) / 65536.0;
+      break;
+    default:
+      // Very large magnitudes of either sign.
+      v = std::ldexp(1.0 + (bits & 0xFFFFF) / 1048576.0, 10 + (int)((bits >> 20) % 14));
+      if (bits >> 63) v = -v;
+      break;
+  }
+  if (std::fabs(v) > MAX_MAGNITUDE) v = std::fmod(v, MAX_MAGNITUDE);
+  return (double)(float)v;
+}
+
+// Turns 36 bytes into a 4D input. One in four inputs is a vertex of the
+// stretched lattice of one of the dimensions, or one float ULP beside it.
+static void decode (const uint8_t * data, double * p) {
+  if (data[0] % 4 != 3) {
+    for (int i = 0; i < 4; ++i) p[i] = decode_coordinate(data + 9 * i);
+    return;
+  }
+  int dims = 1 + (data[1] % 4);
+  // The 1D lattice is the integers; the others are squished.
+  double squish = (dims == 1) ? 0.0 : (std::sqrt(dims + 1.0) - 1.0) / dims;
+  double sum = 0.0;
+  for (int i = 0; i < 4; ++i) {
+    p[i] = (double)((int8_t)data[9 * i + 2]);
+    if (i < dims) sum += p[i];
+  }
+  for (int i = 0; i < 4; ++i) {
+    float v = (float)(p[i] + ((i < dims) ? sum * squish : 0.0));
+    int8_t nudge = (int8_t)data[9 * i + 3];
+    if (nudge > 64) v = std::nextafter(v, HUGE_VALF);
+    if (nudge < -64) v = std::nextafter(v, -HUGE_VALF);
+    p[i] = v;
+  }
+}
+
+#ifdef OSN_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput (const uint8_t * data, size_t size) {
+  if (size < 36) return 0;
+  double p[4];
+  decode(data, p);
+  Worst before[NUM_KERNELS];
+  std::memcpy(before, worst, sizeof(worst));
+  if (!check(p)) std::abort();
+  for (int k = 0; k < NUM_KERNELS; ++k) {
+    if (worst[k].ulp > before[k].ulp) {
+      std::cerr << "new worst for " << KERNELS[k].name << ": " << worst[k].ulp << " ulp at ";
+      print_input(std::cerr, worst[k].ulpInput, KERNELS[k].dims);
+      std::cerr << std::endl;
+    }
+  }
+  return 0;
+}
+
+#else
+
+// SplitMix64, so that runs are reproducible from the seed alone.
+static uint64_t next_random (uint64_t & state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+int main (int argc, char ** argv) {
+
+  long iterations = (argc > 1) ? std::atol(argv[1]) : 1000000;
+  uint64_t state = (argc > 2) ? std::strtoull(argv[2], NULL, 10) : 0;
+
+  bool ok = true;
+
+  // Fixed edge cases first: exact integers and lattice points around zero.
+  for (int i = -3; i <= 3; ++i) {
+    for (int j = -3; j <= 3; ++j) {
+      double p[4] = { (double)i, (double)j, (double)-i, (double)-j };
+      ok = check(p) && ok;
+      for (int k = 0; k < 4; ++k) p[k] = std::nextafter((float)p[k], -HUGE_VALF);
+      ok = check(p) && ok;
+    }
+  }
+
+  uint8_t data[36];
+  for (long n = 0; n < iterations; ++n) {
+    for (int i = 0; i < 36; i += 8) {
+      uint64_t r = next_random(state);
+      std::memcpy(data + i, &r, std::min(8, 36 - i));
+    }
+    double p[4];
+    decode(data, p);
+    ok = check(p) && ok;
+  }
+
+  report(std::cout);
+
+  return ok ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,1645 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * Noise graphs
+ *
+ * A Graph describes a pipeline of generators and operators (input scaling,
+ * fractal layers, abs and clamp, masked blends, domain warps, curves) as a
+ * list of nodes, in place of hand-written chains of eval calls. A GraphPlan
+ * compiles it into a flat list of instructions over a few small buffers,
+ * then evaluates the whole pipeline over blocks of points, so every stage
+ * runs as a batch while the intermediates stay in cache. GraphPlan has the
+ * same evalBatch interface as Noise<N>, so it can be passed to the fills in
+ * OpenSimplexNoiseFill.h. The sides of selects and blends only run on the
+ * points that use them. GraphOptimizer rewrites a graph before it is
+ * compiled, removing duplicate and constant work and merging noise that
+ * shares coordinates.
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "OpenSimplexNoise.h"
+
+
+namespace OSN {
+
+	// What a graph node computes. Inputs are other nodes, in the order the
+	// Graph method that makes the node takes them.
+	enum GraphOp {
+		// Coordinate axis source (0 to 3 for x, y, z, w) of the point.
+		GRAPH_INPUT,
+		// params[0] everywhere.
+		GRAPH_CONSTANT,
+		// The generator of the node's dimension (its number of inputs) with
+		// index source, at the input coordinates.
+		GRAPH_NOISE,
+		// As GRAPH_NOISE, summed over params[0] octaves with lacunarity
+		// params[1] and gain params[2] as by Fractal.
+		GRAPH_FRACTAL,
+		GRAPH_ADD,
+		GRAPH_SUBTRACT,
+		GRAPH_MULTIPLY,
+		GRAPH_MIN,
+		GRAPH_MAX,
+		// inputs[0] * params[0] + params[1].
+		GRAPH_SCALE_BIAS,
+		GRAPH_ABS,
+		// inputs[0] limited to params[0]..params[1].
+		GRAPH_CLAMP,
+		// inputs[0] + (inputs[1] - inputs[0]) * t, with t = inputs[2] limited
+		// to 0..1.
+		GRAPH_BLEND,
+		// inputs[0] where inputs[2] < params[0] - params[1], inputs[1] where
+		// it is above params[0] + params[1], and a smooth blend between.
+		GRAPH_SELECT,
+		// inputs[0] through the piecewise linear curve with index source.
+		GRAPH_CURVE,
+		// The generators of the node's dimension (2 or 3) listed in the group
+		// with index source, all at the input coordinates and each summed as
+		// GRAPH_FRACTAL with the node's params (1 octave for plain noise),
+		// sharing one walk of the lattice. Read through GRAPH_CHANNEL nodes.
+		GRAPH_CHANNELS,
+		// Channel source of the GRAPH_CHANNELS node inputs[0].
+		GRAPH_CHANNEL,
+		// inputs[0] * params[0] + inputs[1] * params[1] + params[2].
+		GRAPH_MIX,
+		// inputs[0] through the steps of the chain with index source in one
+		// pass, each step a GRAPH_SCALE_BIAS, GRAPH_ABS, GRAPH_CLAMP or
+		// GRAPH_CURVE node applied to the previous step's value.
+		GRAPH_CHAIN
+	};
+
+	struct GraphNode {
+		GraphOp op;
+		int arity;
+		uint32_t inputs[4];
+		uint32_t source;
+		double params[3];
+	};
+
+	// Control points of a GRAPH_CURVE, with x ascending. Inputs beyond the
+	// ends take the value of the nearest end.
+	struct GraphCurve {
+		std::vector<double> x, y;
+	};
+
+	// A noise pipeline under construction. Each method adds a node and
+	// returns its handle, which later nodes take as inputs, so the nodes are
+	// always in an order where inputs come first. Handles are only valid in
+	// the graph that made them.
+	//
+	// The graph owns its generators, one per dimension and seed, however
+	// many nodes sample them.
+	class Graph {
+
+	public:
+
+		typedef uint32_t Node;
+
+		Graph(void) : output(0) {}
+
+		Node input(int axis) {
+			GraphNode node = makeNode(GRAPH_INPUT, 0);
+			node.source = (uint32_t) axis;
+			return append(node);
+		}
+
+		Node x(void) { return input(0); }
+		Node y(void) { return input(1); }
+		Node z(void) { return input(2); }
+		Node w(void) { return input(3); }
+
+		static GraphNode makeNode(GraphOp op, int arity) {
+			GraphNode node;
+			node.op = op;
+			node.arity = arity;
+			for (int i = 0; i < 4; ++i) { node.inputs[i] = 0; }
+			node.source = 0;
+			for (int i = 0; i < 3; ++i) { node.params[i] = 0.0; }
+			return node;
+		}
+
+		// Adds a node as is, for tools that build or rewrite graphs node by
+		// node. Its inputs must already be in the graph.
+		Node append(const GraphNode & node) {
+			nodes.push_back(node);
+			return (Node) (nodes.size() - 1);
+		}
+
+		// Index of the generator of the given dimension and seed, which
+		// GRAPH_NOISE and GRAPH_FRACTAL nodes take as their source, adding it
+		// if the graph does not have it yet.
+		uint32_t addGenerator(int dimensions, int64_t seed) {
+			std::vector<int64_t> & list = generatorSeeds[dimensions - 2];
+			size_t index = 0;
+			while (index < list.size() && list[index] != seed) { ++index; }
+			if (index == list.size()) { list.push_back(seed); }
+			return (uint32_t) index;
+		}
+
+		// Index of a curve with the same points as c, adding it if needed.
+		uint32_t addCurve(const GraphCurve & c) {
+			size_t index = 0;
+			while (index < curves.size() && (curves[index].x != c.x || curves[index].y != c.y)) { ++index; }
+			if (index == curves.size()) { curves.push_back(c); }
+			return (uint32_t) index;
+		}
+
+		// Index of a new group of generator indices, for GRAPH_CHANNELS.
+		uint32_t addGroup(const std::vector<uint32_t> & generators) {
+			groups.push_back(generators);
+			return (uint32_t) (groups.size() - 1);
+		}
+
+		// Index of a new list of steps, for GRAPH_CHAIN.
+		uint32_t addChain(const std::vector<GraphNode> & steps) {
+			chains.push_back(steps);
+			return (uint32_t) (chains.size() - 1);
+		}
+
+		Node constant(double value) {
+			GraphNode node = makeNode(GRAPH_CONSTANT, 0);
+			node.params[0] = value;
+			return append(node);
+		}
+
+		Node noise(int64_t seed, Node x, Node y) {
+			const Node in[2] = { x, y };
+			return sample(GRAPH_NOISE, seed, in, 2);
+		}
+
+		Node noise(int64_t seed, Node x, Node y, Node z) {
+			const Node in[3] = { x, y, z };
+			return sample(GRAPH_NOISE, seed, in, 3);
+		}
+
+		Node noise(int64_t seed, Node x, Node y, Node z, Node w) {
+			const Node in[4] = { x, y, z, w };
+			return sample(GRAPH_NOISE, seed, in, 4);
+		}
+
+		Node fractal(int64_t seed, int octaves, double lacunarity, double gain, Node x, Node y) {
+			const Node in[2] = { x, y };
+			return setFractal(sample(GRAPH_FRACTAL, seed, in, 2), octaves, lacunarity, gain);
+		}
+
+		Node fractal(int64_t seed, int octaves, double lacunarity, double gain, Node x, Node y, Node z) {
+			const Node in[3] = { x, y, z };
+			return setFractal(sample(GRAPH_FRACTAL, seed, in, 3), octaves, lacunarity, gain);
+		}
+
+		Node fractal(int64_t seed, int octaves, double lacunarity, double gain, Node x, Node y, Node z, Node w) {
+			const Node in[4] = { x, y, z, w };
+			return setFractal(sample(GRAPH_FRACTAL, seed, in, 4), octaves, lacunarity, gain);
+		}
+
+		Node add(Node a, Node b) { return binary(GRAPH_ADD, a, b); }
+		Node subtract(Node a, Node b) { return binary(GRAPH_SUBTRACT, a, b); }
+		Node multiply(Node a, Node b) { return binary(GRAPH_MULTIPLY, a, b); }
+		Node min(Node a, Node b) { return binary(GRAPH_MIN, a, b); }
+		Node max(Node a, Node b) { return binary(GRAPH_MAX, a, b); }
+
+		Node scaleBias(Node a, double scale, double bias) {
+			GraphNode node = makeNode(GRAPH_SCALE_BIAS, 1);
+			node.inputs[0] = a;
+			node.params[0] = scale;
+			node.params[1] = bias;
+			return append(node);
+		}
+
+		Node abs(Node a) {
+			GraphNode node = makeNode(GRAPH_ABS, 1);
+			node.inputs[0] = a;
+			return append(node);
+		}
+
+		Node clamp(Node a, double lo, double hi) {
+			GraphNode node = makeNode(GRAPH_CLAMP, 1);
+			node.inputs[0] = a;
+			node.params[0] = lo;
+			node.params[1] = hi;
+			return append(node);
+		}
+
+		Node blend(Node a, Node b, Node t) {
+			GraphNode node = makeNode(GRAPH_BLEND, 3);
+			node.inputs[0] = a;
+			node.inputs[1] = b;
+			node.inputs[2] = t;
+			return append(node);
+		}
+
+		// low where control is below threshold, high where it is above, blended
+		// with a smoothstep over threshold - falloff..threshold + falloff.
+		Node select(Node low, Node high, Node control, double threshold, double falloff = 0.0) {
+			GraphNode node = makeNode(GRAPH_SELECT, 3);
+			node.inputs[0] = low;
+			node.inputs[1] = high;
+			node.inputs[2] = control;
+			node.params[0] = threshold;
+			node.params[1] = falloff;
+			return append(node);
+		}
+
+		// a * wa + b * wb + bias.
+		Node mix(Node a, Node b, double wa, double wb, double bias = 0.0) {
+			GraphNode node = makeNode(GRAPH_MIX, 2);
+			node.inputs[0] = a;
+			node.inputs[1] = b;
+			node.params[0] = wa;
+			node.params[1] = wb;
+			node.params[2] = bias;
+			return append(node);
+		}
+
+		// a through the piecewise linear curve with count control points
+		// (xs[i], ys[i]), xs ascending.
+		Node curve(Node a, const double * xs, const double * ys, size_t count) {
+			GraphCurve c;
+			c.x.assign(xs, xs + count);
+			c.y.assign(ys, ys + count);
+			GraphNode node = makeNode(GRAPH_CURVE, 1);
+			node.inputs[0] = a;
+			node.source = addCurve(c);
+			return append(node);
+		}
+
+		// coordinate displaced by amount * offset, for domain warping: pass the
+		// warped coordinates to a noise or fractal node.
+		Node warp(Node coordinate, Node offset, double amount) {
+			return add(coordinate, scaleBias(offset, amount, 0.0));
+		}
+
+		// The node whose value the graph produces. Defaults to the first.
+		void setOutput(Node node) { output = node; }
+		Node getOutput(void) const { return output; }
+
+		size_t size(void) const { return nodes.size(); }
+		const GraphNode & node(Node n) const { return nodes[n]; }
+		const std::vector<GraphCurve> & getCurves(void) const { return curves; }
+		const std::vector<std::vector<uint32_t> > & getGroups(void) const { return groups; }
+		const std::vector<std::vector<GraphNode> > & getChains(void) const { return chains; }
+
+		// Seeds of the generators of each dimension, 2 to 4, indexed by the
+		// source of the nodes that sample them.
+		const std::vector<int64_t> & seeds(int dimensions) const { return generatorSeeds[dimensions - 2]; }
+
+	private:
+
+		std::vector<GraphNode> nodes;
+		std::vector<GraphCurve> curves;
+		std::vector<std::vector<uint32_t> > groups;
+		std::vector<std::vector<GraphNode> > chains;
+		std::vector<int64_t> generatorSeeds[3];
+		Node output;
+
+		Node binary(GraphOp op, Node a, Node b) {
+			GraphNode node = makeNode(op, 2);
+			node.inputs[0] = a;
+			node.inputs[1] = b;
+			return append(node);
+		}
+
+		Node sample(GraphOp op, int64_t seed, const Node * in, int dimensions) {
+			GraphNode node = makeNode(op, dimensions);
+			for (int d = 0; d < dimensions; ++d) { node.inputs[d] = in[d]; }
+			node.source = addGenerator(dimensions, seed);
+			return append(node);
+		}
+
+		Node setFractal(Node n, int octaves, double lacunarity, double gain) {
+			nodes[n].params[0] = (double) octaves;
+			nodes[n].params[1] = lacunarity;
+			nodes[n].params[2] = gain;
+			return n;
+		}
+
+	};
+
+	// A Graph compiled for evaluation: the nodes that the output depends on,
+	// in order, each reading and writing one of a few buffers of BLOCK
+	// values. A buffer is reused as soon as the last node reading it has run,
+	// so a graph of any size needs only as many as are live at once.
+	//
+	// The nodes that only one side of a select or blend reads, when they
+	// include noise, form a branch: the control is computed first, and the
+	// branch runs only on the points of the block where its side has a
+	// nonzero weight, packed together, so that an ocean-or-land select does
+	// not evaluate the land's noise over the ocean. Branches nest.
+	//
+	// Holds its own generators and curves, so the graph can be discarded.
+	// Evaluation does not modify the plan, so threads can share one.
+	class GraphPlan {
+
+	public:
+
+		// Points are evaluated in blocks of this many.
+		static const size_t BLOCK = 128;
+
+		// Buffers 0 to 3 are the x, y, z and w coordinates of the points.
+		static const uint32_t INPUTS = 4;
+
+		struct Instruction {
+			GraphOp op;
+			int arity;
+			uint32_t dest;
+			uint32_t args[4];
+			uint32_t source;
+			double params[3];
+			// -1, or the index of the branch this instruction starts, in
+			// which case it computes nothing itself.
+			int branch;
+		};
+
+		// A side of a GRAPH_SELECT or GRAPH_BLEND (op and params) whose nodes
+		// only it reads, run only on the points where its weight is not 0,
+		// packed together. The instructions from the one that starts it up to
+		// end run on copies of the importsFrom buffers holding those points,
+		// in importsTo, and its value is scattered back from value to result.
+		// side is 0 for the first input and 1 for the second; control is the
+		// buffer of the third.
+		struct Branch {
+			GraphOp op;
+			double params[3];
+			int side;
+			uint32_t control;
+			std::vector<uint32_t> importsFrom, importsTo;
+			size_t end;
+			uint32_t value, result;
+		};
+
+		GraphPlan(void) : buffers(INPUTS), result(0), lazy(true) {}
+
+		// With lazy false, every node runs on every point, as the branches
+		// of selects and blends are otherwise only run where they are used.
+		explicit GraphPlan(const Graph & graph, bool lazy = true) : buffers(INPUTS), result(0), lazy(lazy) {
+			for (int d = 2; d <= 4; ++d) {
+				const std::vector<int64_t> & seeds = graph.seeds(d);
+				for (size_t i = 0; i < seeds.size(); ++i) {
+					if (d == 2) { noise2.push_back(Noise<2>(seeds[i])); }
+					else if (d == 3) { noise3.push_back(Noise<3>(seeds[i])); }
+					else { noise4.push_back(Noise<4>(seeds[i])); }
+				}
+			}
+			curves = graph.getCurves();
+			groups = graph.getGroups();
+			chains = graph.getChains();
+			compile(graph);
+		}
+
+		const std::vector<Instruction> & getInstructions(void) const { return instructions; }
+		const std::vector<Branch> & getBranches(void) const { return branches; }
+
+		// Buffers evaluation needs, including the four coordinate inputs.
+		uint32_t getBuffers(void) const { return buffers; }
+
+		// The region each node of graph is evaluated in by a lazy plan: 0 for
+		// every point of a block, and from 1 on, the sides of selects and
+		// blends that are run as branches. Nodes the output does not need
+		// are in none, ~0. Nodes in the same region run on the same points.
+		static std::vector<uint32_t> branchRegions(const Graph & graph) {
+			Regions regions;
+			if (graph.size() > 0) {
+				const std::vector<char> needed = neededNodes(graph);
+				placeNodes(graph, needed, true, regions);
+			}
+			return regions.of;
+		}
+
+		template <typename T>
+		void evalBatch(const T * x, const T * y, T * out, size_t count) const {
+			const T * in[2] = { x, y };
+			run<2>(in, out, count);
+		}
+
+		template <typename T>
+		void evalBatch(const T * x, const T * y, const T * z, T * out, size_t count) const {
+			const T * in[3] = { x, y, z };
+			run<3>(in, out, count);
+		}
+
+		template <typename T>
+		void evalBatch(const T * x, const T * y, const T * z, const T * w, T * out, size_t count) const {
+			const T * in[4] = { x, y, z, w };
+			run<4>(in, out, count);
+		}
+
+	private:
+
+		std::vector<Noise<2> > noise2;
+		std::vector<Noise<3> > noise3;
+		std::vector<Noise<4> > noise4;
+		std::vector<GraphCurve> curves;
+		std::vector<std::vector<uint32_t> > groups;
+		std::vector<std::vector<GraphNode> > chains;
+		std::vector<Instruction> instructions;
+		// The buffers of each channel of each GRAPH_CHANNELS instruction, from
+		// its dest on.
+		std::vector<uint32_t> channelBuffers;
+		std::vector<Branch> branches;
+		uint32_t buffers;
+		uint32_t result;
+		bool lazy;
+
+		// Channels evaluated together; larger groups take several passes.
+		static const size_t MAX_CHANNELS = 8;
+
+		// Where each node is evaluated. Region 0 is every point of the block;
+		// each other region is one side of a select or blend, evaluated only
+		// where its weight is not 0, and holds the nodes that only that side
+		// reads, directly or through other nodes of the region.
+		struct Regions {
+			std::vector<uint32_t> of;
+			std::vector<uint32_t> parent, depth, owner;
+			std::vector<int> side;
+			// The region of side s of select or blend n, at 2 * n + s.
+			std::vector<uint32_t> branch;
+		};
+
+		enum : uint32_t { NONE = ~(uint32_t)0 };
+
+		static bool lazyOp(const GraphNode & node) {
+			return (node.op == GRAPH_SELECT || node.op == GRAPH_BLEND) && node.inputs[0] != node.inputs[1];
+		}
+
+		static bool expensive(GraphOp op) {
+			return op == GRAPH_NOISE || op == GRAPH_FRACTAL || op == GRAPH_CHANNELS;
+		}
+
+		// The innermost region containing regions a and b.
+		static uint32_t meet(const Regions & regions, uint32_t a, uint32_t b) {
+			while (regions.depth[a] > regions.depth[b]) { a = regions.parent[a]; }
+			while (regions.depth[b] > regions.depth[a]) { b = regions.parent[b]; }
+			while (a != b) {
+				a = regions.parent[a];
+				b = regions.parent[b];
+			}
+			return a;
+		}
+
+		// Places each needed node in the innermost region containing every
+		// read of it, with a region for each side s of each select or blend n
+		// where enabled[2 * n + s]. Readers come after what they read, so one
+		// backward pass places them all. The channels of a GRAPH_CHANNELS node
+		// go with it, and coordinates are in region 0.
+		static void assignRegions(const Graph & graph, const std::vector<char> & needed, const std::vector<char> & enabled, Regions & regions) {
+			const Graph::Node output = graph.getOutput();
+			regions.of.assign(graph.size(), NONE);
+			regions.parent.assign(1, 0);
+			regions.depth.assign(1, 0);
+			regions.owner.assign(1, NONE);
+			regions.side.assign(1, 0);
+			regions.branch.assign(graph.size() * 2, NONE);
+			regions.of[output] = 0;
+			for (uint32_t i = output + 1; i-- > 0; ) {
+				if (!needed[i]) { continue; }
+				const GraphNode & node = graph.node(i);
+				const bool lazy = lazyOp(node);
+				for (int a = 0; a < node.arity; ++a) {
+					uint32_t edge = regions.of[i];
+					if (lazy && a < 2 && enabled[2 * i + a]) {
+						uint32_t & branch = regions.branch[2 * i + a];
+						if (branch == NONE) {
+							branch = (uint32_t) regions.parent.size();
+							regions.parent.push_back(regions.of[i]);
+							regions.depth.push_back(regions.depth[regions.of[i]] + 1);
+							regions.owner.push_back(i);
+							regions.side.push_back(a);
+						}
+						edge = branch;
+					}
+					uint32_t & in = regions.of[node.inputs[a]];
+					in = (in == NONE) ? edge : meet(regions, in, edge);
+				}
+			}
+			for (uint32_t i = 0; i <= output; ++i) {
+				if (!needed[i]) { continue; }
+				const GraphNode & node = graph.node(i);
+				if (node.op == GRAPH_INPUT) { regions.of[i] = 0; }
+				else if (node.op == GRAPH_CHANNEL) { regions.of[i] = regions.of[node.inputs[0]]; }
+			}
+		}
+
+		// What compile emits for one step of the plan, in order: a node, or
+		// the start or end of a region. reads and defines are values, which
+		// are given buffers once their lifetimes are known.
+		struct Step {
+			enum Kind { NODE, BEGIN, END } kind;
+			uint32_t index;
+			std::vector<uint32_t> reads, defines;
+		};
+
+		static void orderSteps(const Regions & regions, const std::vector<std::vector<uint32_t> > & members, uint32_t region, std::vector<Step> & steps) {
+			for (size_t k = 0; k < members[region].size(); ++k) {
+				const uint32_t n = members[region][k];
+				for (int s = 0; s < 2; ++s) {
+					const uint32_t branch = regions.branch[2 * n + s];
+					if (branch == NONE || members[branch].empty()) { continue; }
+					Step begin;
+					begin.kind = Step::BEGIN;
+					begin.index = branch;
+					steps.push_back(begin);
+					orderSteps(regions, members, branch, steps);
+					Step end = begin;
+					end.kind = Step::END;
+					steps.push_back(end);
+				}
+				Step step;
+				step.kind = Step::NODE;
+				step.index = n;
+				steps.push_back(step);
+			}
+		}
+
+		// Marks what the output depends on. Inputs precede their users, so
+		// one backward pass finds them all.
+		static std::vector<char> neededNodes(const Graph & graph) {
+			const Graph::Node output = graph.getOutput();
+			std::vector<char> needed(graph.size(), 0);
+			needed[output] = 1;
+			for (uint32_t i = output + 1; i-- > 0; ) {
+				if (!needed[i]) { continue; }
+				const GraphNode & node = graph.node(i);
+				for (int a = 0; a < node.arity; ++a) { needed[node.inputs[a]] = 1; }
+			}
+			return needed;
+		}
+
+		// Places the needed nodes in regions, with a region for every side of
+		// every select or blend that holds noise when lazy, and none when not.
+		// Only sides holding noise are worth packing their points for. A
+		// region keeps its nodes when a cheap one is dropped, so placing the
+		// nodes again with only the expensive sides keeps those.
+		static void placeNodes(const Graph & graph, const std::vector<char> & needed, bool lazy, Regions & regions) {
+			const Graph::Node output = graph.getOutput();
+			std::vector<char> enabled(graph.size() * 2, lazy ? 1 : 0);
+			assignRegions(graph, needed, enabled, regions);
+			if (lazy) {
+				std::vector<char> worth(regions.parent.size(), 0);
+				for (uint32_t i = 0; i <= output; ++i) {
+					if (needed[i] && expensive(graph.node(i).op)) { worth[regions.of[i]] = 1; }
+				}
+				for (size_t r = worth.size(); r-- > 1; ) {
+					if (worth[r]) { worth[regions.parent[r]] = 1; }
+					enabled[2 * regions.owner[r] + regions.side[r]] = worth[r];
+				}
+				assignRegions(graph, needed, enabled, regions);
+			}
+		}
+
+		void compile(const Graph & graph) {
+			if (graph.size() == 0) { return; }
+			const Graph::Node output = graph.getOutput();
+
+			const std::vector<char> needed = neededNodes(graph);
+			Regions regions;
+			placeNodes(graph, needed, lazy, regions);
+			std::vector<std::vector<uint32_t> > members(regions.parent.size());
+			for (uint32_t i = 0; i <= output; ++i) {
+				if (needed[i]) { members[regions.of[i]].push_back(i); }
+			}
+			std::vector<Step> steps;
+			orderSteps(regions, members, 0, steps);
+
+			// The values each region copies in from its parent: whatever it or
+			// a region inside it reads from outside, except the value of a
+			// side, which its select reads after it is scattered back.
+			std::vector<std::vector<uint32_t> > imports(regions.parent.size());
+			std::vector<std::vector<char> > imported(regions.parent.size());
+			for (uint32_t i = 0; i <= output; ++i) {
+				if (!needed[i]) { continue; }
+				const GraphNode & node = graph.node(i);
+				if (node.op == GRAPH_CHANNEL) { continue; }
+				for (int a = 0; a < node.arity; ++a) {
+					const uint32_t in = node.inputs[a];
+					if (isSideValue(graph, regions, in, regions.of[i])) { continue; }
+					for (uint32_t r = regions.of[i]; r != regions.of[in]; r = regions.parent[r]) {
+						if (imported[r].empty()) { imported[r].assign(graph.size(), 0); }
+						if (!imported[r][in]) {
+							imported[r][in] = 1;
+							imports[r].push_back(in);
+						}
+					}
+				}
+			}
+
+			// Number the values, and find the last step to read each.
+			std::vector<uint32_t> home(graph.size(), NONE), scattered(regions.parent.size(), NONE);
+			std::vector<std::vector<uint32_t> > copies(regions.parent.size());
+			std::vector<uint32_t> pinned, lastUse;
+			for (size_t e = 0; e < steps.size(); ++e) {
+				Step & step = steps[e];
+				if (step.kind == Step::NODE) {
+					const uint32_t n = step.index;
+					const GraphNode & node = graph.node(n);
+					if (node.op == GRAPH_INPUT) {
+						home[n] = newValue(pinned, lastUse, (node.source < INPUTS) ? node.source : 0);
+						continue;
+					}
+					if (node.op == GRAPH_CHANNEL) {
+						// The channels of a GRAPH_CHANNELS node are numbered in
+						// order, and it comes first.
+						home[n] = home[node.inputs[0]] + node.source;
+						continue;
+					}
+					for (int a = 0; a < node.arity; ++a) { step.reads.push_back(resolve(graph, regions, imports, copies, home, scattered, node.inputs[a], regions.of[n])); }
+					const size_t count = (node.op == GRAPH_CHANNELS) ? groups[node.source].size() : 1;
+					for (size_t c = 0; c < count; ++c) { step.defines.push_back(newValue(pinned, lastUse, NONE)); }
+					home[n] = step.defines[0];
+				}
+				else if (step.kind == Step::BEGIN) {
+					const uint32_t r = step.index;
+					const uint32_t control = graph.node(regions.owner[r]).inputs[2];
+					step.reads.push_back(resolve(graph, regions, imports, copies, home, scattered, control, regions.parent[r]));
+					for (size_t k = 0; k < imports[r].size(); ++k) {
+						step.reads.push_back(resolve(graph, regions, imports, copies, home, scattered, imports[r][k], regions.parent[r]));
+						step.defines.push_back(newValue(pinned, lastUse, NONE));
+					}
+					copies[r] = step.defines;
+				}
+				else {
+					const uint32_t r = step.index;
+					step.reads.push_back(home[graph.node(regions.owner[r]).inputs[regions.side[r]]]);
+					step.defines.push_back(newValue(pinned, lastUse, NONE));
+					scattered[r] = step.defines[0];
+				}
+				for (size_t k = 0; k < step.reads.size(); ++k) { lastUse[step.reads[k]] = (uint32_t) e; }
+			}
+			const uint32_t outputValue = home[output];
+			lastUse[outputValue] = NONE - 1;
+
+			// Give the values buffers, taking a step's buffers before releasing
+			// its inputs', so that no step writes a buffer it is still reading.
+			std::vector<uint32_t> buffer(pinned);
+			std::vector<uint32_t> free, open;
+			for (size_t e = 0; e < steps.size(); ++e) {
+				const Step & step = steps[e];
+				for (size_t k = 0; k < step.defines.size(); ++k) { buffer[step.defines[k]] = take(free); }
+				emit(graph, regions, step, buffer, open);
+				for (size_t k = 0; k < step.reads.size(); ++k) {
+					const uint32_t v = step.reads[k];
+					if (lastUse[v] == e && pinned[v] == NONE) {
+						free.push_back(buffer[v]);
+						// Only once, if the step reads it twice.
+						lastUse[v] = NONE - 1;
+					}
+				}
+				// Values nothing reads are free once written.
+				for (size_t k = 0; k < step.defines.size(); ++k) {
+					if (lastUse[step.defines[k]] == NONE) { free.push_back(buffer[step.defines[k]]); }
+				}
+			}
+			result = buffer[outputValue];
+		}
+
+		uint32_t take(std::vector<uint32_t> & free) {
+			if (free.empty()) { return buffers++; }
+			uint32_t b = free.back();
+			free.pop_back();
+			return b;
+		}
+
+		static uint32_t newValue(std::vector<uint32_t> & pinned, std::vector<uint32_t> & lastUse, uint32_t buffer) {
+			pinned.push_back(buffer);
+			lastUse.push_back(NONE);
+			return (uint32_t) (pinned.size() - 1);
+		}
+
+		// Whether node n is the value of a side of a select or blend in
+		// region r, which r reads once it is scattered back.
+		static bool isSideValue(const Graph & graph, const Regions & regions, uint32_t n, uint32_t r) {
+			const uint32_t region = regions.of[n];
+			return region != r && region != 0 && regions.parent[region] == r &&
+				graph.node(regions.owner[region]).inputs[regions.side[region]] == n;
+		}
+
+		// The value of node n as seen from region r.
+		static uint32_t resolve(const Graph & graph, const Regions & regions, const std::vector<std::vector<uint32_t> > & imports,
+			const std::vector<std::vector<uint32_t> > & copies, const std::vector<uint32_t> & home,
+			const std::vector<uint32_t> & scattered, uint32_t n, uint32_t r) {
+			if (regions.of[n] == r) { return home[n]; }
+			if (isSideValue(graph, regions, n, r)) { return scattered[regions.of[n]]; }
+			for (size_t k = 0; k < imports[r].size(); ++k) {
+				if (imports[r][k] == n) { return copies[r][k]; }
+			}
+			return NONE;
+		}
+
+		// Adds the instruction for a step, or the start or end of a branch,
+		// whose values have their buffers. open holds the branches started
+		// and not yet ended.
+		void emit(const Graph & graph, const Regions & regions, const Step & step, const std::vector<uint32_t> & buffer, std::vector<uint32_t> & open) {
+			if (step.kind == Step::END) {
+				Branch & branch = branches[open.back()];
+				open.pop_back();
+				branch.end = instructions.size();
+				branch.value = buffer[step.reads[0]];
+				branch.result = buffer[step.defines[0]];
+				return;
+			}
+			const GraphNode & node = graph.node((step.kind == Step::NODE) ? step.index : regions.owner[step.index]);
+			if (step.kind == Step::NODE && (node.op == GRAPH_INPUT || node.op == GRAPH_CHANNEL)) { return; }
+			Instruction instruction;
+			instruction.op = node.op;
+			instruction.arity = node.arity;
+			for (int a = 0; a < 4; ++a) { instruction.args[a] = 0; }
+			instruction.source = node.source;
+			for (int p = 0; p < 3; ++p) { instruction.params[p] = node.params[p]; }
+			instruction.branch = -1;
+			instruction.dest = 0;
+			if (step.kind == Step::BEGIN) {
+				Branch branch;
+				branch.op = node.op;
+				for (int p = 0; p < 3; ++p) { branch.params[p] = node.params[p]; }
+				branch.side = regions.side[step.index];
+				branch.control = buffer[step.reads[0]];
+				for (size_t k = 0; k < step.defines.size(); ++k) {
+					branch.importsFrom.push_back(buffer[step.reads[k + 1]]);
+					branch.importsTo.push_back(buffer[step.defines[k]]);
+				}
+				branch.end = 0;
+				branch.value = branch.result = 0;
+				instruction.branch = (int) branches.size();
+				open.push_back((uint32_t) branches.size());
+				branches.push_back(branch);
+				instructions.push_back(instruction);
+				return;
+			}
+			for (int a = 0; a < node.arity; ++a) { instruction.args[a] = buffer[step.reads[a]]; }
+			if (node.op == GRAPH_CHANNELS) {
+				instruction.dest = (uint32_t) channelBuffers.size();
+				for (size_t c = 0; c < step.defines.size(); ++c) { channelBuffers.push_back(buffer[step.defines[c]]); }
+			}
+			else { instruction.dest = buffer[step.defines[0]]; }
+			instructions.push_back(instruction);
+		}
+
+		// The buffers run evaluates in. Each thread keeps one per type and
+		// grows it to the largest plan it has run, so that evalBatch does not
+		// allocate once it is warm.
+		template <typename T>
+		struct Workspace {
+			std::vector<T> scratch;
+			std::vector<const T *> values;
+			std::vector<uint32_t> lanes;
+			bool busy;
+
+			Workspace(void) : busy(false) {}
+
+			void reserve(uint32_t buffers, size_t branches) {
+				if (scratch.size() < (size_t) buffers * BLOCK) { scratch.resize((size_t) buffers * BLOCK); }
+				if (values.size() < buffers) { values.resize(buffers); }
+				if (lanes.size() < branches * BLOCK) { lanes.resize(branches * BLOCK); }
+			}
+		};
+
+		template <int N, typename T>
+		void run(const T * const * in, T * out, size_t count) const {
+			static thread_local Workspace<T> shared;
+			// A plan run from inside another run on the same thread, which
+			// only a caller's own source could arrange, gets its own.
+			Workspace<T> nested;
+			Workspace<T> & workspace = shared.busy ? nested : shared;
+			workspace.busy = true;
+			workspace.reserve(buffers, branches.size());
+			run<N>(in, out, count, workspace);
+			workspace.busy = false;
+		}
+
+		template <int N, typename T>
+		void run(const T * const * in, T * out, size_t count, Workspace<T> & workspace) const {
+			static const T zeros[BLOCK] = {};
+			T * scratch = workspace.scratch.data();
+			const T ** values = workspace.values.data();
+			for (uint32_t b = INPUTS; b < buffers; ++b) { values[b] = scratch + (size_t) b * BLOCK; }
+			for (size_t begin = 0; begin < count; begin += BLOCK) {
+				size_t n = count - begin;
+				if (n > BLOCK) { n = BLOCK; }
+				for (int d = 0; d < (int) INPUTS; ++d) { values[d] = (d < N) ? in[d] + begin : zeros; }
+				runRange(0, instructions.size(), values, scratch, workspace.lanes.data(), n);
+				const T * value = values[result];
+				for (size_t i = 0; i < n; ++i) { out[begin + i] = value[i]; }
+			}
+		}
+
+		// Runs instructions begin to end on n points, each branch on the
+		// points that need it, packed into its own buffers.
+		template <typename T>
+		void runRange(size_t begin, size_t end, const T * const * values, T * scratch, uint32_t * lanes, size_t n) const {
+			for (size_t k = begin; k < end; ) {
+				const Instruction & op = instructions[k];
+				if (op.branch < 0) {
+					execute(op, values, scratch, n);
+					++k;
+					continue;
+				}
+				const Branch & branch = branches[op.branch];
+				uint32_t * active = lanes + (size_t) op.branch * BLOCK;
+				const Weight<T> weight(branch.op, branch.params);
+				const T * control = values[branch.control];
+				size_t m = 0;
+				for (size_t i = 0; i < n; ++i) {
+					const T t = weight(control[i]);
+					if ((branch.side == 0) ? (t < (T)1.0) : (t > (T)0.0)) { active[m++] = (uint32_t) i; }
+				}
+				if (m > 0) {
+					for (size_t j = 0; j < branch.importsFrom.size(); ++j) {
+						const T * from = values[branch.importsFrom[j]];
+						T * to = scratch + (size_t) branch.importsTo[j] * BLOCK;
+						for (size_t i = 0; i < m; ++i) { to[i] = from[active[i]]; }
+					}
+					runRange(k + 1, branch.end, values, scratch, lanes, m);
+					const T * value = values[branch.value];
+					T * result = scratch + (size_t) branch.result * BLOCK;
+					for (size_t i = 0; i < m; ++i) { result[active[i]] = value[i]; }
+				}
+				k = branch.end;
+			}
+		}
+
+		// The weight of the second input of a select or blend, from its
+		// control: clamped to 0..1 for a blend; for a select, a smoothstep
+		// across the falloff, or a hard switch without one.
+		template <typename T>
+		struct Weight {
+			bool select;
+			T lower, scale;
+			Weight(GraphOp op, const double * params) : select(op == GRAPH_SELECT) {
+				if (select) {
+					lower = (T) (params[0] - params[1]);
+					const T upper = (T) (params[0] + params[1]);
+					scale = (upper > lower) ? (T)1.0 / (upper - lower) : (T)0.0;
+				}
+				else {
+					lower = (T)0.0;
+					scale = (T)1.0;
+				}
+			}
+			T operator()(T c) const {
+				if (select && scale == (T)0.0) { return (c < lower) ? (T)0.0 : (T)1.0; }
+				T t = (c - lower) * scale;
+				t = (t < (T)0.0) ? (T)0.0 : t;
+				t = ((T)1.0 < t) ? (T)1.0 : t;
+				return select ? t * t * ((T)3.0 - (T)2.0 * t) : t;
+			}
+		};
+
+		template <typename T>
+		void sampleNoise(const Instruction & op, const T * const * coords, T * dest, size_t n) const {
+			switch (op.arity) {
+			case 2: noise2[op.source].evalBatch(coords[0], coords[1], dest, n); break;
+			case 3: noise3[op.source].evalBatch(coords[0], coords[1], coords[2], dest, n); break;
+			default: noise4[op.source].evalBatch(coords[0], coords[1], coords[2], coords[3], dest, n); break;
+			}
+		}
+
+		// Runs op on a block, writing the buffer it owns in scratch.
+		template <typename T>
+		void execute(const Instruction & op, const T * const * values, T * scratch, size_t n) const {
+			T * dest = scratch + (size_t) op.dest * BLOCK;
+			const T * a = values[op.args[0]];
+			const T * b = values[op.args[1]];
+			const T * c = values[op.args[2]];
+			switch (op.op) {
+			case GRAPH_INPUT:
+				break;
+			case GRAPH_CONSTANT: {
+				const T value = (T) op.params[0];
+				for (size_t i = 0; i < n; ++i) { dest[i] = value; }
+				break;
+			}
+			case GRAPH_NOISE: {
+				const T * coords[4] = { a, b, c, values[op.args[3]] };
+				sampleNoise(op, coords, dest, n);
+				break;
+			}
+			case GRAPH_FRACTAL:
+				fractal(op, values, dest, n);
+				break;
+			case GRAPH_ADD:
+				for (size_t i = 0; i < n; ++i) { dest[i] = a[i] + b[i]; }
+				break;
+			case GRAPH_SUBTRACT:
+				for (size_t i = 0; i < n; ++i) { dest[i] = a[i] - b[i]; }
+				break;
+			case GRAPH_MULTIPLY:
+				for (size_t i = 0; i < n; ++i) { dest[i] = a[i] * b[i]; }
+				break;
+			case GRAPH_MIN:
+				for (size_t i = 0; i < n; ++i) { dest[i] = (b[i] < a[i]) ? b[i] : a[i]; }
+				break;
+			case GRAPH_MAX:
+				for (size_t i = 0; i < n; ++i) { dest[i] = (a[i] < b[i]) ? b[i] : a[i]; }
+				break;
+			case GRAPH_SCALE_BIAS:
+			case GRAPH_ABS:
+			case GRAPH_CLAMP:
+			case GRAPH_CURVE:
+				unary(op.op, op.source, op.params, a, dest, n);
+				break;
+			case GRAPH_BLEND:
+			case GRAPH_SELECT: {
+				// Where the weight is 0 or 1, the other input may not have been
+				// computed, so it is not read.
+				const Weight<T> weight(op.op, op.params);
+				for (size_t i = 0; i < n; ++i) {
+					const T t = weight(c[i]);
+					dest[i] = (t == (T)0.0) ? a[i] : (t == (T)1.0) ? b[i] : a[i] + (b[i] - a[i]) * t;
+				}
+				break;
+			}
+			case GRAPH_CHANNELS:
+				channels(op, values, scratch, n);
+				break;
+			case GRAPH_CHANNEL:
+				break;
+			case GRAPH_MIX: {
+				const T wa = (T) op.params[0], wb = (T) op.params[1], bias = (T) op.params[2];
+				for (size_t i = 0; i < n; ++i) { dest[i] = a[i] * wa + b[i] * wb + bias; }
+				break;
+			}
+			case GRAPH_CHAIN: {
+				const std::vector<GraphNode> & steps = chains[op.source];
+				const T * in = a;
+				for (size_t k = 0; k < steps.size(); ++k) {
+					unary(steps[k].op, steps[k].source, steps[k].params, in, dest, n);
+					in = dest;
+				}
+				if (steps.empty()) {
+					for (size_t i = 0; i < n; ++i) { dest[i] = a[i]; }
+				}
+				break;
+			}
+			}
+		}
+
+		// The single-input elementwise ops, which may run in place.
+		template <typename T>
+		void unary(GraphOp op, uint32_t source, const double * params, const T * a, T * dest, size_t n) const {
+			switch (op) {
+			case GRAPH_SCALE_BIAS: {
+				const T scale = (T) params[0], bias = (T) params[1];
+				for (size_t i = 0; i < n; ++i) { dest[i] = a[i] * scale + bias; }
+				break;
+			}
+			case GRAPH_ABS:
+				for (size_t i = 0; i < n; ++i) { dest[i] = std::fabs(a[i]); }
+				break;
+			case GRAPH_CLAMP: {
+				const T lo = (T) params[0], hi = (T) params[1];
+				for (size_t i = 0; i < n; ++i) {
+					T v = (a[i] < lo) ? lo : a[i];
+					dest[i] = (hi < v) ? hi : v;
+				}
+				break;
+			}
+			case GRAPH_CURVE:
+				curve(curves[source], a, dest, n);
+				break;
+			default:
+				break;
+			}
+		}
+
+		// The weight of the first octave of a fractal with the given params,
+		// as Fractal.
+		static double normalization(const double * params) {
+			const int octaves = (int) params[0];
+			double total = 0.0, weight = 1.0;
+			for (int o = 0; o < octaves; ++o) {
+				total += weight;
+				weight *= params[2];
+			}
+			return (total > 0.0) ? 1.0 / total : 0.0;
+		}
+
+		// As Fractal, an octave of a block at a time.
+		template <typename T>
+		void fractal(const Instruction & op, const T * const * values, T * dest, size_t n) const {
+			T scaled[4][BLOCK];
+			T octave[BLOCK];
+			const T * coords[4] = { scaled[0], scaled[1], scaled[2], scaled[3] };
+			const int octaves = (int) op.params[0];
+			T frequency = (T)1.0, amplitude = (T) normalization(op.params);
+			for (size_t i = 0; i < n; ++i) { dest[i] = (T)0.0; }
+			for (int o = 0; o < octaves; ++o) {
+				for (int d = 0; d < op.arity; ++d) {
+					const T * coordinate = values[op.args[d]];
+					for (size_t i = 0; i < n; ++i) { scaled[d][i] = coordinate[i] * frequency; }
+				}
+				sampleNoise(op, coords, octave, n);
+				for (size_t i = 0; i < n; ++i) { dest[i] += amplitude * octave[i]; }
+				frequency *= (T) op.params[1];
+				amplitude *= (T) op.params[2];
+			}
+		}
+
+		// As fractal, for every generator of a GRAPH_CHANNELS group at once.
+		template <typename T>
+		void channels(const Instruction & op, const T * const * values, T * scratch, size_t n) const {
+			T scaled[3][BLOCK];
+			T octave[MAX_CHANNELS][BLOCK];
+			T * octaves[MAX_CHANNELS];
+			T * dests[MAX_CHANNELS];
+			const Noise<2> * generators2[MAX_CHANNELS];
+			const Noise<3> * generators3[MAX_CHANNELS];
+			const std::vector<uint32_t> & group = groups[op.source];
+			const int count = (int) op.params[0];
+			const T * coords[3];
+			for (int d = 0; d < op.arity && d < 3; ++d) { coords[d] = values[op.args[d]]; }
+			for (size_t first = 0; first < group.size(); first += MAX_CHANNELS) {
+				size_t k = group.size() - first;
+				if (k > MAX_CHANNELS) { k = MAX_CHANNELS; }
+				for (size_t c = 0; c < k; ++c) {
+					dests[c] = scratch + (size_t) channelBuffers[op.dest + first + c] * BLOCK;
+					octaves[c] = octave[c];
+					if (op.arity == 2) { generators2[c] = &noise2[group[first + c]]; }
+					else { generators3[c] = &noise3[group[first + c]]; }
+				}
+				// A single octave is plain noise, written in place.
+				if (count == 1) {
+					sampleChannels(op.arity, generators2, generators3, k, coords, dests, n);
+					continue;
+				}
+				for (size_t c = 0; c < k; ++c) {
+					for (size_t i = 0; i < n; ++i) { dests[c][i] = (T)0.0; }
+				}
+				const T * scaledCoords[3] = { scaled[0], scaled[1], scaled[2] };
+				T frequency = (T)1.0, amplitude = (T) normalization(op.params);
+				for (int o = 0; o < count; ++o) {
+					for (int d = 0; d < op.arity; ++d) {
+						for (size_t i = 0; i < n; ++i) { scaled[d][i] = coords[d][i] * frequency; }
+					}
+					sampleChannels(op.arity, generators2, generators3, k, scaledCoords, octaves, n);
+					for (size_t c = 0; c < k; ++c) {
+						for (size_t i = 0; i < n; ++i) { dests[c][i] += amplitude * octave[c][i]; }
+					}
+					frequency *= (T) op.params[1];
+					amplitude *= (T) op.params[2];
+				}
+			}
+		}
+
+		template <typename T>
+		static void sampleChannels(int arity, const Noise<2> * const * generators2, const Noise<3> * const * generators3, size_t k, const T * const * coords, T * const * out, size_t n) {
+			if (arity == 2) { Noise<2>::evalChannels(generators2, k, coords[0], coords[1], out, n); }
+			else { Noise<3>::evalChannels(generators3, k, coords[0], coords[1], coords[2], out, n); }
+		}
+
+		template <typename T>
+		static void curve(const GraphCurve & c, const T * a, T * dest, size_t n) {
+			const size_t count = c.x.size();
+			for (size_t i = 0; i < n; ++i) {
+				T v = a[i];
+				if (count == 0) { dest[i] = v; continue; }
+				if (v <= (T) c.x[0]) { dest[i] = (T) c.y[0]; continue; }
+				if (v >= (T) c.x[count - 1]) { dest[i] = (T) c.y[count - 1]; continue; }
+				size_t k = 1;
+				while ((T) c.x[k] < v) { ++k; }
+				T x0 = (T) c.x[k - 1], x1 = (T) c.x[k];
+				T t = (x1 > x0) ? (v - x0) / (x1 - x0) : (T)0.0;
+				dest[i] = (T) c.y[k - 1] + ((T) c.y[k] - (T) c.y[k - 1]) * t;
+			}
+		}
+
+	};
+
+
+	// What GraphOptimizer::optimize changed, with the estimated cost of a
+	// sample of the output before and after (see GraphOptimizer::sampleCost).
+	struct GraphReport {
+		// Nodes the output depends on.
+		size_t nodesBefore, nodesAfter;
+		double costBefore, costAfter;
+		// Nodes replaced by an identical earlier node.
+		size_t deduplicated;
+		// Nodes replaced by a constant or a simpler node because some of
+		// their inputs are constant.
+		size_t folded;
+		// Noise and fractal nodes evaluated as a channel of another.
+		size_t merged;
+		// Elementwise nodes absorbed into the node that reads them.
+		size_t fused;
+	};
+
+	// Rewrites a Graph into one with the same output that is cheaper to
+	// evaluate:
+	// - identical nodes are computed once;
+	// - nodes whose inputs are all constant become constants, arithmetic
+	//   with a constant becomes a GRAPH_SCALE_BIAS, and blends and selects
+	//   with a constant control become one of their inputs or a GRAPH_MIX;
+	// - 2D and 3D noise and fractal nodes that sample different seeds at
+	//   the same coordinates become the channels of one GRAPH_CHANNELS node;
+	// - single-use elementwise nodes are absorbed into the node reading them,
+	//   giving GRAPH_CHAIN and GRAPH_MIX nodes with their scales and biases
+	//   combined;
+	// - nodes the output does not depend on are dropped.
+	// The output matches the original's up to rounding. The 2014 3D kernel
+	// jumps by up to about 1e-4 across some faces of its cells, so where
+	// rounding moves a point across one, 3D channels can differ by that
+	// much, as Noise<3>::eval and evalBatch already can.
+	class GraphOptimizer {
+
+	public:
+
+		typedef Graph::Node Node;
+
+		static Graph optimize(const Graph & graph, GraphReport * report = NULL) {
+			GraphReport counts;
+			counts.nodesBefore = countNeeded(graph);
+			counts.costBefore = sampleCost(graph);
+			counts.deduplicated = counts.folded = counts.merged = counts.fused = 0;
+			Graph result = compact(fuse(compact(merge(compact(simplify(graph, counts)), counts)), counts));
+			counts.nodesAfter = countNeeded(result);
+			counts.costAfter = sampleCost(result);
+			if (report) { *report = counts; }
+			return result;
+		}
+
+		// Estimated time to evaluate the output at one point, in units of one
+		// 2D noise evaluation, from the nodes it depends on. The weights are
+		// rough batch timings on x86-64: 3D noise costs 2.5 units and 4D 5,
+		// each extra channel of a GRAPH_CHANNELS node a fraction of one, and
+		// elementwise nodes a few hundredths.
+		static double sampleCost(const Graph & graph) {
+			const std::vector<char> needed = neededNodes(graph);
+			double cost = 0.0;
+			for (size_t i = 0; i < needed.size(); ++i) {
+				if (!needed[i]) { continue; }
+				const GraphNode & node = graph.node((Node) i);
+				switch (node.op) {
+				case GRAPH_INPUT:
+				case GRAPH_CHANNEL:
+					break;
+				case GRAPH_CONSTANT:
+					cost += 0.01;
+					break;
+				case GRAPH_NOISE:
+					cost += noiseCost(node.arity);
+					break;
+				case GRAPH_FRACTAL:
+					cost += node.params[0] * (noiseCost(node.arity) + ELEMENTWISE_COST);
+					break;
+				case GRAPH_CHANNELS: {
+					// The shared walk costs a little more than plain 3D noise.
+					const double extra = (double) graph.getGroups()[node.source].size() - 1.0;
+					const double walk = (node.arity == 2) ? 1.0 : 3.0;
+					const double channel = (node.arity == 2) ? 0.5 : 1.0;
+					cost += node.params[0] * (walk + extra * channel + (extra + 1.0) * ELEMENTWISE_COST);
+					break;
+				}
+				case GRAPH_BLEND:
+				case GRAPH_SELECT:
+					cost += 2.0 * ELEMENTWISE_COST;
+					break;
+				case GRAPH_CURVE:
+					cost += CURVE_COST;
+					break;
+				case GRAPH_CHAIN: {
+					const std::vector<GraphNode> & steps = graph.getChains()[node.source];
+					for (size_t k = 0; k < steps.size(); ++k) {
+						cost += (steps[k].op == GRAPH_CURVE) ? CURVE_COST : ELEMENTWISE_COST;
+					}
+					break;
+				}
+				default:
+					cost += ELEMENTWISE_COST;
+					break;
+				}
+			}
+			return cost;
+		}
+
+	private:
+
+		static constexpr double ELEMENTWISE_COST = 0.02;
+		static constexpr double CURVE_COST = 0.1;
+
+		static double noiseCost(int dimensions) {
+			return (dimensions == 2) ? 1.0 : (dimensions == 3) ? 2.5 : 5.0;
+		}
+
+		// Orders nodes by every field, comparing params bit for bit, so that
+		// equal keys compute the same thing.
+		struct NodeLess {
+			bool operator()(const GraphNode & a, const GraphNode & b) const {
+				if (a.op != b.op) { return a.op < b.op; }
+				if (a.arity != b.arity) { return a.arity < b.arity; }
+				for (int i = 0; i < 4; ++i) {
+					if (a.inputs[i] != b.inputs[i]) { return a.inputs[i] < b.inputs[i]; }
+				}
+				if (a.source != b.source) { return a.source < b.source; }
+				return std::memcmp(a.params, b.params, sizeof(a.params)) < 0;
+			}
+		};
+
+		typedef std::map<GraphNode, Node, NodeLess> NodeTable;
+
+		static std::vector<char> neededNodes(const Graph & graph) {
+			std::vector<char> needed(graph.size(), 0);
+			if (graph.size() == 0) { return needed; }
+			needed[graph.getOutput()] = 1;
+			for (size_t i = graph.getOutput() + 1; i-- > 0; ) {
+				if (!needed[i]) { continue; }
+				const GraphNode & node = graph.node((Node) i);
+				for (int a = 0; a < node.arity; ++a) { needed[node.inputs[a]] = 1; }
+			}
+			return needed;
+		}
+
+		static size_t countNeeded(const Graph & graph) {
+			const std::vector<char> needed = neededNodes(graph);
+			size_t count = 0;
+			for (size_t i = 0; i < needed.size(); ++i) { count += needed[i]; }
+			return count;
+		}
+
+		// A graph with the generators, curves, groups and chains of graph, and
+		// no nodes. Generators keep their indices; curveMap gives the new index
+		// of each curve, as identical curves are merged.
+		static Graph emptyLike(const Graph & graph, std::vector<uint32_t> & curveMap) {
+			Graph result;
+			for (int d = 2; d <= 4; ++d) {
+				const std::vector<int64_t> & seeds = graph.seeds(d);
+				for (size_t i = 0; i < seeds.size(); ++i) { result.addGenerator(d, seeds[i]); }
+			}
+			const std::vector<GraphCurve> & curves = graph.getCurves();
+			curveMap.resize(curves.size());
+			for (size_t i = 0; i < curves.size(); ++i) { curveMap[i] = result.addCurve(curves[i]); }
+			const std::vector<std::vector<uint32_t> > & groups = graph.getGroups();
+			for (size_t i = 0; i < groups.size(); ++i) { result.addGroup(groups[i]); }
+			const std::vector<std::vector<GraphNode> > & chains = graph.getChains();
+			for (size_t i = 0; i < chains.size(); ++i) {
+				std::vector<GraphNode> steps = chains[i];
+				for (size_t k = 0; k < steps.size(); ++k) {
+					if (steps[k].op == GRAPH_CURVE) { steps[k].source = curveMap[steps[k].source]; }
+				}
+				result.addChain(steps);
+			}
+			return result;
+		}
+
+		// node with its inputs and curve renumbered, and unused inputs zeroed.
+		static GraphNode remap(const GraphNode & node, const std::vector<Node> & map, const std::vector<uint32_t> & curveMap) {
+			GraphNode result = Graph::makeNode(node.op, node.arity);
+			for (int a = 0; a < node.arity; ++a) { result.inputs[a] = map[node.inputs[a]]; }
+			result.source = (node.op == GRAPH_CURVE) ? curveMap[node.source] : node.source;
+			for (int p = 0; p < 3; ++p) { result.params[p] = node.params[p]; }
+			return result;
+		}
+
+		// The nodes of graph that the output depends on, in order.
+		static Graph compact(const Graph & graph) {
+			std::vector<uint32_t> curveMap;
+			Graph result = emptyLike(graph, curveMap);
+			if (graph.size() == 0) { return result; }
+			const std::vector<char> needed = neededNodes(graph);
+			std::vector<Node> map(graph.size(), 0);
+			for (size_t i = 0; i < graph.size(); ++i) {
+				if (needed[i]) { map[i] = result.append(remap(graph.node((Node) i), map, curveMap)); }
+			}
+			result.setOutput(map[graph.getOutput()]);
+			return result;
+		}
+
+		// Adds node to graph unless an identical node is already there.
+		static Node intern(Graph & graph, const GraphNode & node, NodeTable & table, size_t * hits) {
+			NodeTable::const_iterator found = table.find(node);
+			if (found != table.end()) {
+				if (hits) { ++*hits; }
+				return found->second;
+			}
+			Node n = graph.append(node);
+			table[node] = n;
+			return n;
+		}
+
+		static bool constantValue(const Graph & graph, Node n, double & value) {
+			const GraphNode & node = graph.node(n);
+			if (node.op != GRAPH_CONSTANT) { return false; }
+			value = node.params[0];
+			return true;
+		}
+
+		static bool elementwise(GraphOp op) {
+			switch (op) {
+			case GRAPH_ADD: case GRAPH_SUBTRACT: case GRAPH_MULTIPLY: case GRAPH_MIN: case GRAPH_MAX:
+			case GRAPH_SCALE_BIAS: case GRAPH_ABS: case GRAPH_CLAMP: case GRAPH_BLEND: case GRAPH_SELECT:
+			case GRAPH_CURVE: case GRAPH_MIX:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// The value of an elementwise node whose inputs are constants,
+		// computed by a plan of it alone, so that it rounds as the plan would.
+		static double evaluate(const Graph & graph, const GraphNode & node) {
+			Graph single;
+			GraphNode copy = node;
+			for (int a = 0; a < node.arity; ++a) {
+				double value = 0.0;
+				constantValue(graph, node.inputs[a], value);
+				copy.inputs[a] = single.constant(value);
+			}
+			if (node.op == GRAPH_CURVE) { copy.source = single.addCurve(graph.getCurves()[node.source]); }
+			single.setOutput(single.append(copy));
+			GraphPlan plan(single);
+			double x = 0.0, y = 0.0, value = 0.0;
+			plan.evalBatch(&x, &y, &value, 1);
+			return value;
+		}
+
+		static GraphNode scaleBias(Node a, double scale, double bias) {
+			GraphNode node = Graph::makeNode(GRAPH_SCALE_BIAS, 1);
+			node.inputs[0] = a;
+			node.params[0] = scale;
+			node.params[1] = bias;
+			return node;
+		}
+
+		// a where t is 0, b where it is 1, and their weighted sum between.
+		static Node pick(Graph & graph, Node a, Node b, double t, NodeTable & table, GraphReport & report) {
+			if (t <= 0.0) { return a; }
+			if (t >= 1.0) { return b; }
+			GraphNode node = Graph::makeNode(GRAPH_MIX, 2);
+			node.inputs[0] = a;
+			node.inputs[1] = b;
+			node.params[0] = 1.0 - t;
+			node.params[1] = t;
+			return simplifyNode(graph, node, table, report);
+		}
+
+		// Adds node, whose inputs are already simplified, in its simplest form.
+		static Node simplifyNode(Graph & graph, GraphNode node, NodeTable & table, GraphReport & report) {
+			if (!elementwise(node.op)) { return intern(graph, node, table, &report.deduplicated); }
+			const Node a = node.inputs[0], b = node.inputs[1], c = node.inputs[2];
+			bool constant = true;
+			double ca = 0.0, cb = 0.0, cc = 0.0, unused = 0.0;
+			for (int i = 0; i < node.arity; ++i) { constant = constant && constantValue(graph, node.inputs[i], unused); }
+			if (constant) {
+				++report.folded;
+				GraphNode folded = Graph::makeNode(GRAPH_CONSTANT, 0);
+				folded.params[0] = evaluate(graph, node);
+				return intern(graph, folded, table, NULL);
+			}
+			const bool constantA = constantValue(graph, a, ca);
+			const bool constantB = node.arity > 1 && constantValue(graph, b, cb);
+			const bool constantC = node.arity > 2 && constantValue(graph, c, cc);
+			switch (node.op) {
+			case GRAPH_ADD:
+				if (constantA) { ++report.folded; return simplifyNode(graph, scaleBias(b, 1.0, ca), table, report); }
+				if (constantB) { ++report.folded; return simplifyNode(graph, scaleBias(a, 1.0, cb), table, report); }
+				break;
+			case GRAPH_SUBTRACT:
+				if (constantA) { ++report.folded; return simplifyNode(graph, scaleBias(b, -1.0, ca), table, report); }
+				if (constantB) { ++report.folded; return simplifyNode(graph, scaleBias(a, 1.0, -cb), table, report); }
+				break;
+			case GRAPH_MULTIPLY:
+				if (constantA) { ++report.folded; return simplifyNode(graph, scaleBias(b, ca, 0.0), table, report); }
+				if (constantB) { ++report.folded; return simplifyNode(graph, scaleBias(a, cb, 0.0), table, report); }
+				break;
+			case GRAPH_MIN:
+			case GRAPH_MAX:
+				if (a == b) { ++report.folded; return a; }
+				break;
+			case GRAPH_SCALE_BIAS:
+				if (node.params[0] == 1.0 && node.params[1] == 0.0) { ++report.folded; return a; }
+				break;
+			case GRAPH_BLEND:
+				if (a == b) { ++report.folded; return a; }
+				if (constantC) { ++report.folded; return pick(graph, a, b, cc, table, report); }
+				break;
+			case GRAPH_SELECT:
+				if (a == b) { ++report.folded; return a; }
+				if (constantC) {
+					// The control through a select of the constants 0 and 1.
+					Graph single;
+					GraphNode t = node;
+					t.inputs[0] = single.constant(0.0);
+					t.inputs[1] = single.constant(1.0);
+					t.inputs[2] = single.constant(cc);
+					single.setOutput(single.append(t));
+					++report.folded;
+					return pick(graph, a, b, evaluate(single, t), table, report);
+				}
+				break;
+			case GRAPH_MIX:
+				if (constantA) { ++report.folded; return simplifyNode(graph, scaleBias(b, node.params[1], ca * node.params[0] + node.params[2]), table, report); }
+				if (constantB) { ++report.folded; return simplifyNode(graph, scaleBias(a, node.params[0], cb * node.params[1] + node.params[2]), table, report); }
+				break;
+			default:
+				break;
+			}
+			// Operands of commutative ops in a fixed order, so that a + b and
+			// b + a are found equal.
+			if ((node.op == GRAPH_ADD || node.op == GRAPH_MULTIPLY || node.op == GRAPH_MIN || node.op == GRAPH_MAX) && b < a) {
+				node.inputs[0] = b;
+				node.inputs[1] = a;
+			}
+			return intern(graph, node, table, &report.deduplicated);
+		}
+
+		// Deduplication and constant folding, in one pass in order.
+		static Graph simplify(const Graph & graph, GraphReport & report) {
+			std::vector<uint32_t> curveMap;
+			Graph result = emptyLike(graph, curveMap);
+			if (graph.size() == 0) { return result; }
+			const std::vector<char> needed = neededNodes(graph);
+			std::vector<Node> map(graph.size(), 0);
+			NodeTable table;
+			for (size_t i = 0; i < graph.size(); ++i) {
+				if (needed[i]) { map[i] = simplifyNode(result, remap(graph.node((Node) i), map, curveMap), table, report); }
+			}
+			result.setOutput(map[graph.getOutput()]);
+			return result;
+		}
+
+		// Groups 2D and 3D noise and fractal nodes by everything but their
+		// generator: a fractal of one octave is plain noise. Nodes after the
+		// first of a group share its inputs, so its channels node can take
+		// the first one's place.
+		//
+		// Only nodes that a lazy plan evaluates on the same points are
+		// grouped: merging noise from the two sides of a select would run
+		// both sides everywhere, and a walk shared by channels costs more
+		// than each one alone.
+		static Graph merge(const Graph & graph, GraphReport & report) {
+			std::vector<uint32_t> curveMap;
+			Graph result = emptyLike(graph, curveMap);
+			if (graph.size() == 0) { return result; }
+
+			const std::vector<uint32_t> regions = GraphPlan::branchRegions(graph);
+			std::map<GraphNode, std::vector<Node>, NodeLess> samples;
+			for (size_t i = 0; i < graph.size(); ++i) {
+				const GraphNode & node = graph.node((Node) i);
+				if ((node.op != GRAPH_NOISE && node.op != GRAPH_FRACTAL) || node.arity > 3) { continue; }
+				GraphNode key = node;
+				key.op = GRAPH_CHANNELS;
+				// The region until the channels node is made, then the group.
+				key.source = regions[i];
+				if (node.op == GRAPH_NOISE || node.params[0] == 1.0) {
+					key.params[0] = 1.0;
+					key.params[1] = key.params[2] = 0.0;
+				}
+				samples[key].push_back((Node) i);
+			}
+
+			// Groups of at most MAX_CHANNELS, in the order of their members.
+			std::vector<std::vector<Node> > chunks;
+			std::vector<GraphNode> keys;
+			std::vector<int> chunkOf(graph.size(), -1);
+			typedef std::map<GraphNode, std::vector<Node>, NodeLess>::const_iterator Iterator;
+			for (Iterator it = samples.begin(); it != samples.end(); ++it) {
+				const std::vector<Node> & members = it->second;
+				for (size_t first = 0; first + 1 < members.size(); first += MAX_CHANNELS) {
+					size_t end = first + MAX_CHANNELS;
+					if (end > members.size()) { end = members.size(); }
+					if (end - first < 2) { break; }
+					chunks.push_back(std::vector<Node>(members.begin() + first, members.begin() + end));
+					keys.push_back(it->first);
+					for (size_t k = first; k < end; ++k) { chunkOf[members[k]] = (int) chunks.size() - 1; }
+				}
+			}
+
+			std::vector<Node> map(graph.size(), 0);
+			std::vector<char> done(chunks.size(), 0);
+			for (size_t i = 0; i < graph.size(); ++i) {
+				const int chunk = chunkOf[i];
+				if (chunk < 0) {
+					map[i] = result.append(remap(graph.node((Node) i), map, curveMap));
+					continue;
+				}
+				if (done[chunk]) { continue; }
+				done[chunk] = 1;
+				const std::vector<Node> & members = chunks[chunk];
+				std::vector<uint32_t> generators;
+				for (size_t k = 0; k < members.size(); ++k) { generators.push_back(graph.node(members[k]).source); }
+				GraphNode channels = remap(keys[chunk], map, curveMap);
+				channels.source = result.addGroup(generators);
+				const Node channelsNode = result.append(channels);
+				for (size_t k = 0; k < members.size(); ++k) {
+					GraphNode channel = Graph::makeNode(GRAPH_CHANNEL, 1);
+					channel.inputs[0] = channelsNode;
+					channel.source = (uint32_t) k;
+					map[members[k]] = result.append(channel);
+				}
+				report.merged += members.size() - 1;
+			}
+			result.setOutput(map[graph.getOutput()]);
+			return result;
+		}
+
+		static const size_t MAX_CHANNELS = 8;
+
+		static bool chainable(GraphOp op) {
+			return op == GRAPH_SCALE_BIAS || op == GRAPH_ABS || op == GRAPH_CLAMP || op == GRAPH_CURVE || op == GRAPH_CHAIN;
+		}
+
+		// Appends the steps of a chainable node to steps, combining
+		// consecutive scales and biases.
+		static void appendSteps(const Graph & graph, const GraphNode & node, std::vector<GraphNode> & steps) {
+			std::vector<GraphNode> added;
+			if (node.op == GRAPH_CHAIN) { added = graph.getChains()[node.source]; }
+			else {
+				GraphNode step = node;
+				step.inputs[0] = 0;
+				added.push_back(step);
+			}
+			for (size_t k = 0; k < added.size(); ++k) {
+				const GraphNode & step = added[k];
+				if (step.op == GRAPH_SCALE_BIAS && !steps.empty() && steps.back().op == GRAPH_SCALE_BIAS) {
+					GraphNode & last = steps.back();
+					last.params[1] = last.params[1] * step.params[0] + step.params[1];
+					last.params[0] *= step.params[0];
+				}
+				else { steps.push_back(step); }
+			}
+		}
+
+		// Absorbs single-use elementwise inputs into the nodes that read them.
+		// Reads the uses in graph and the absorbed nodes in result, where they
+		// were already rewritten.
+		static Graph fuse(const Graph & graph, GraphReport & report) {
+			std::vector<uint32_t> curveMap;
+			Graph result = emptyLike(graph, curveMap);
+			if (graph.size() == 0) { return result; }
+
+			std::vector<size_t> uses(graph.size(), 0);
+			for (size_t i = 0; i < graph.size(); ++i) {
+				const GraphNode & node = graph.node((Node) i);
+				for (int a = 0; a < node.arity; ++a) { ++uses[node.inputs[a]]; }
+			}
+			++uses[graph.getOutput()];
+
+			std::vector<Node> map(graph.size(), 0);
+			for (size_t i = 0; i < graph.size(); ++i) {
+				const GraphNode & original = graph.node((Node) i);
+				GraphNode node = remap(original, map, curveMap);
+				if (chainable(node.op) && uses[original.inputs[0]] == 1 && chainable(result.node(node.inputs[0]).op)) {
+					const GraphNode & inner = result.node(node.inputs[0]);
+					std::vector<GraphNode> steps;
+					appendSteps(result, inner, steps);
+					appendSteps(result, node, steps);
+					const Node in = inner.inputs[0];
+					if (steps.size() == 1) { node = steps[0]; }
+					else {
+						node = Graph::makeNode(GRAPH_CHAIN, 1);
+						node.source = result.addChain(steps);
+					}
+					node.inputs[0] = in;
+					++report.fused;
+				}
+				else if (node.op == GRAPH_ADD || node.op == GRAPH_SUBTRACT || node.op == GRAPH_MIX) {
+					double weights[3] = { 1.0, (node.op == GRAPH_SUBTRACT) ? -1.0 : 1.0, 0.0 };
+					if (node.op == GRAPH_MIX) { for (int p = 0; p < 3; ++p) { weights[p] = node.params[p]; } }
+					bool absorbed = false;
+					for (int k = 0; k < 2; ++k) {
+						const GraphNode & in = result.node(node.inputs[k]);
+						if (uses[original.inputs[k]] != 1 || in.op != GRAPH_SCALE_BIAS) { continue; }
+						weights[2] += weights[k] * in.params[1];
+						weights[k] *= in.params[0];
+						node.inputs[k] = in.inputs[0];
+						absorbed = true;
+						++report.fused;
+					}
+					if (absorbed) {
+						node.op = GRAPH_MIX;
+						for (int p = 0; p < 3; ++p) { node.params[p] = weights[p]; }
+					}
+				}
+				else if (node.op == GRAPH_SCALE_BIAS && uses[original.inputs[0]] == 1 && result.node(node.inputs[0]).op == GRAPH_MIX) {
+					const GraphNode & in = result.node(node.inputs[0]);
+					const double scale = node.params[0], bias = node.params[1];
+					node = in;
+					node.params[0] *= scale;
+					node.params[1] *= scale;
+					node.params[2] = node.params[2] * scale + bias;
+					++report.fused;
+				}
+				map[i] = result.append(node);
+			}
+			result.setOutput(map[graph.getOutput()]);
+			return result;
+		}
+
+	};
+
+}
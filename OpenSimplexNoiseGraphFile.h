@@ -0,0 +1,752 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * Noise graph files
+ *
+ * Reads and writes the graphs of OpenSimplexNoiseGraph.h in two formats: a
+ * line-based text format for hand editing, where each line names a node,
+ * and a compact little-endian binary format. Either can be loaded into a
+ * LiveGraph, which compiles it into a GraphPlan once and can load a new
+ * version while other threads are evaluating the current one, so that a
+ * graph can be tweaked without rebuilding the program that uses it.
+ *
+ * The text format, one statement per line, with # starting a comment:
+ *
+ *   osn-graph 1
+ *   cx = scale_bias x 0.25 0
+ *   ...
+ *   output height
+ *
+ * where x, y, z and w name the coordinates, and each other line names a
+ * node as one of:
+ *
+ *   input AXIS                         constant VALUE
+ *   noise SEED COORD...                fractal SEED OCTAVES LACUNARITY GAIN COORD...
+ *   add A B   subtract A B   multiply A B   min A B   max A B
+ *   scale_bias A SCALE BIAS            abs A
+ *   clamp A LO HI                      blend A B T
+ *   select LOW HIGH CONTROL THRESHOLD FALLOFF
+ *   curve A COUNT X0 Y0 X1 Y1 ...      mix A B WA WB BIAS
+ *   channels OCTAVES LACUNARITY GAIN COUNT SEED... COORD...
+ *   channel CHANNELS INDEX
+ *   chain A COUNT STEP...
+ *
+ * with 2 to 4 coordinates for noise (2 or 3 for channels), and each chain
+ * step one of scale_bias SCALE BIAS, abs, clamp LO HI or curve COUNT
+ * X0 Y0 .... A name must start with a letter or underscore, and be
+ * defined before it is used.
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "OpenSimplexNoiseGraph.h"
+#include "OpenSimplexNoiseTrace.h"
+
+
+namespace OSN {
+
+	namespace GraphFile {
+
+		// Names of the ops in the text format, in GraphOp order.
+		static const char * const OP_NAMES[] = {
+			"input", "constant", "noise", "fractal", "add", "subtract", "multiply", "min", "max",
+			"scale_bias", "abs", "clamp", "blend", "select", "curve", "channels", "channel", "mix", "chain"
+		};
+		static const int OP_COUNT = (int) (sizeof(OP_NAMES) / sizeof(OP_NAMES[0]));
+
+		static const char BINARY_MAGIC[4] = { 'O', 'S', 'N', 'G' };
+		static const uint32_t VERSION = 1;
+
+		// Most octaves a fractal or channels node may sum.
+		static const int MAX_OCTAVES = 64;
+
+		// Checks that every node of graph has a known op with the inputs it
+		// takes, reads only earlier nodes, refers to generators, curves,
+		// non-empty groups and chains the graph has, and sums 1 to
+		// MAX_OCTAVES octaves, so that a plan compiled from it is safe to run.
+		inline bool validate(const Graph & graph, std::string * error) {
+			std::ostringstream message;
+			for (size_t i = 0; i < graph.size() && message.tellp() == 0; ++i) {
+				const GraphNode & node = graph.node((Graph::Node) i);
+				if ((int) node.op < 0 || (int) node.op >= OP_COUNT) {
+					message << "node " << i << ": unknown op " << (int) node.op;
+					break;
+				}
+				int lo = 0, hi = 0;
+				switch (node.op) {
+				case GRAPH_INPUT: case GRAPH_CONSTANT: lo = hi = 0; break;
+				case GRAPH_NOISE: case GRAPH_FRACTAL: lo = 2; hi = 4; break;
+				case GRAPH_CHANNELS: lo = 2; hi = 3; break;
+				case GRAPH_BLEND: case GRAPH_SELECT: lo = hi = 3; break;
+				case GRAPH_ADD: case GRAPH_SUBTRACT: case GRAPH_MULTIPLY: case GRAPH_MIN: case GRAPH_MAX: case GRAPH_MIX: lo = hi = 2; break;
+				default: lo = hi = 1; break;
+				}
+				if (node.arity < lo || node.arity > hi) {
+					message << "node " << i << ": " << OP_NAMES[node.op] << " takes " << lo << " to " << hi << " inputs, not " << node.arity;
+					break;
+				}
+				for (int a = 0; a < node.arity; ++a) {
+					if (node.inputs[a] >= i) {
+						message << "node " << i << ": input " << a << " is not an earlier node";
+						break;
+					}
+				}
+				if (message.tellp() != 0) { break; }
+				const char * table = NULL;
+				switch (node.op) {
+				case GRAPH_INPUT: if (node.source > 3) { table = "axis"; } break;
+				case GRAPH_NOISE: case GRAPH_FRACTAL: if (node.source >= graph.seeds(node.arity).size()) { table = "generator"; } break;
+				case GRAPH_CURVE: if (node.source >= graph.getCurves().size()) { table = "curve"; } break;
+				case GRAPH_CHAIN: if (node.source >= graph.getChains().size()) { table = "chain"; } break;
+				case GRAPH_CHANNELS: {
+					if (node.source >= graph.getGroups().size()) { table = "group"; break; }
+					const std::vector<uint32_t> & group = graph.getGroups()[node.source];
+					if (group.empty()) { message << "node " << i << ": group " << node.source << " is empty"; break; }
+					for (size_t k = 0; k < group.size(); ++k) {
+						if (group[k] >= graph.seeds(node.arity).size()) { table = "generator"; }
+					}
+					break;
+				}
+				case GRAPH_CHANNEL:
+					if (graph.node(node.inputs[0]).op != GRAPH_CHANNELS ||
+						node.source >= graph.getGroups()[graph.node(node.inputs[0]).source].size()) { table = "channel"; }
+					break;
+				default: break;
+				}
+				if (table) { message << "node " << i << ": no such " << table << " " << node.source; }
+				else if ((node.op == GRAPH_FRACTAL || node.op == GRAPH_CHANNELS) && message.tellp() == 0 &&
+					!(node.params[0] >= 1.0 && node.params[0] <= (double) MAX_OCTAVES)) {
+					message << "node " << i << ": octave count " << node.params[0] << " is not 1 to " << MAX_OCTAVES;
+				}
+			}
+			const std::vector<GraphCurve> & curves = graph.getCurves();
+			for (size_t c = 0; c < curves.size() && message.tellp() == 0; ++c) {
+				for (size_t k = 1; k < curves[c].x.size(); ++k) {
+					if (!(curves[c].x[k - 1] <= curves[c].x[k])) {
+						message << "curve " << c << ": x is not ascending";
+						break;
+					}
+				}
+			}
+			const std::vector<std::vector<GraphNode> > & chains = graph.getChains();
+			for (size_t c = 0; c < chains.size() && message.tellp() == 0; ++c) {
+				for (size_t k = 0; k < chains[c].size(); ++k) {
+					const GraphNode & step = chains[c][k];
+					const bool unary = step.op == GRAPH_SCALE_BIAS || step.op == GRAPH_ABS || step.op == GRAPH_CLAMP || step.op == GRAPH_CURVE;
+					if (!unary || (step.op == GRAPH_CURVE && step.source >= graph.getCurves().size())) {
+						message << "chain " << c << ": bad step " << k;
+						break;
+					}
+				}
+			}
+			if (message.tellp() == 0 && graph.size() > 0 && graph.getOutput() >= graph.size()) { message << "no such output node " << graph.getOutput(); }
+			if (message.tellp() == 0) { return true; }
+			if (error) { *error = message.str(); }
+			return false;
+		}
+
+		inline void writeCurve(std::ostream & out, const GraphCurve & curve) {
+			out << ' ' << curve.x.size();
+			for (size_t k = 0; k < curve.x.size(); ++k) { out << ' ' << curve.x[k] << ' ' << curve.y[k]; }
+		}
+
+		// Writes graph in the text format, naming node i n<i>. Doubles are
+		// written with enough digits to read back exactly.
+		inline void writeText(std::ostream & out, const Graph & graph) {
+			const std::streamsize precision = out.precision(17);
+			out << "osn-graph " << VERSION << '\n';
+			for (size_t i = 0; i < graph.size(); ++i) {
+				const GraphNode & node = graph.node((Graph::Node) i);
+				out << 'n' << i << " = " << OP_NAMES[node.op];
+				switch (node.op) {
+				case GRAPH_INPUT:
+					out << ' ' << node.source;
+					break;
+				case GRAPH_CONSTANT:
+					out << ' ' << node.params[0];
+					break;
+				case GRAPH_NOISE:
+					out << ' ' << graph.seeds(node.arity)[node.source];
+					break;
+				case GRAPH_FRACTAL:
+					out << ' ' << graph.seeds(node.arity)[node.source] << ' ' << (int) node.params[0] << ' ' << node.params[1] << ' ' << node.params[2];
+					break;
+				case GRAPH_CHANNELS: {
+					const std::vector<uint32_t> & group = graph.getGroups()[node.source];
+					out << ' ' << (int) node.params[0] << ' ' << node.params[1] << ' ' << node.params[2] << ' ' << group.size();
+					for (size_t k = 0; k < group.size(); ++k) { out << ' ' << graph.seeds(node.arity)[group[k]]; }
+					break;
+				}
+				default:
+					break;
+				}
+				for (int a = 0; a < node.arity; ++a) { out << " n" << node.inputs[a]; }
+				switch (node.op) {
+				case GRAPH_SCALE_BIAS:
+				case GRAPH_CLAMP:
+				case GRAPH_SELECT:
+					out << ' ' << node.params[0] << ' ' << node.params[1];
+					break;
+				case GRAPH_MIX:
+					out << ' ' << node.params[0] << ' ' << node.params[1] << ' ' << node.params[2];
+					break;
+				case GRAPH_CURVE:
+					writeCurve(out, graph.getCurves()[node.source]);
+					break;
+				case GRAPH_CHANNEL:
+					out << ' ' << node.source;
+					break;
+				case GRAPH_CHAIN: {
+					const std::vector<GraphNode> & steps = graph.getChains()[node.source];
+					out << ' ' << steps.size();
+					for (size_t k = 0; k < steps.size(); ++k) {
+						const GraphNode & step = steps[k];
+						out << ' ' << OP_NAMES[step.op];
+						if (step.op == GRAPH_SCALE_BIAS || step.op == GRAPH_CLAMP) { out << ' ' << step.params[0] << ' ' << step.params[1]; }
+						else if (step.op == GRAPH_CURVE) { writeCurve(out, graph.getCurves()[step.source]); }
+					}
+					break;
+				}
+				default:
+					break;
+				}
+				out << '\n';
+			}
+			if (graph.size() > 0) { out << "output n" << graph.getOutput() << '\n'; }
+			out.precision(precision);
+		}
+
+		// Reads the tokens of one line of the text format.
+		class TextLine {
+
+		public:
+
+			TextLine(const std::string & line, std::map<std::string, Graph::Node> & names, Graph & graph) : names(names), graph(graph), next(0) {
+				std::istringstream in(line.substr(0, line.find('#')));
+				std::string token;
+				while (in >> token) { tokens.push_back(token); }
+			}
+
+			bool empty(void) const { return tokens.empty(); }
+			bool done(void) const { return next == tokens.size(); }
+			size_t remaining(void) const { return tokens.size() - next; }
+			const std::string & peek(void) const { return tokens[next]; }
+
+			bool word(std::string & value) {
+				if (done()) { return false; }
+				value = tokens[next++];
+				return true;
+			}
+
+			bool number(double & value) {
+				if (done()) { return false; }
+				const char * begin = tokens[next].c_str();
+				char * end = NULL;
+				value = std::strtod(begin, &end);
+				if (end == begin || *end != '\0') { return false; }
+				++next;
+				return true;
+			}
+
+			bool integer(int64_t & value) {
+				if (done()) { return false; }
+				const char * begin = tokens[next].c_str();
+				char * end = NULL;
+				value = (int64_t) std::strtoll(begin, &end, 10);
+				if (end == begin || *end != '\0') { return false; }
+				++next;
+				return true;
+			}
+
+			// Whether the next token is a name rather than a number.
+			bool atName(void) const {
+				return !done() && (std::isalpha((unsigned char) tokens[next][0]) || tokens[next][0] == '_');
+			}
+
+			// A defined name, or a coordinate, which is added as an input node
+			// the first time it is used.
+			bool node(Graph::Node & value) {
+				if (!atName()) { return false; }
+				const std::string & name = tokens[next];
+				std::map<std::string, Graph::Node>::const_iterator found = names.find(name);
+				if (found != names.end()) { value = found->second; }
+				else if (name.size() == 1 && std::strchr("xyzw", name[0])) {
+					value = graph.input((name[0] == 'w') ? 3 : name[0] - 'x');
+					names[name] = value;
+				}
+				else { return false; }
+				++next;
+				return true;
+			}
+
+			bool curve(GraphCurve & curve) {
+				int64_t count = 0;
+				if (!integer(count) || count < 0 || (size_t) count * 2 > remaining()) { return false; }
+				curve.x.resize((size_t) count);
+				curve.y.resize((size_t) count);
+				for (int64_t k = 0; k < count; ++k) {
+					if (!number(curve.x[k]) || !number(curve.y[k])) { return false; }
+				}
+				return true;
+			}
+
+		private:
+
+			std::map<std::string, Graph::Node> & names;
+			Graph & graph;
+			std::vector<std::string> tokens;
+			size_t next;
+
+		};
+
+		// Parses the operands of a node of the given op into node, adding any
+		// generators, curves, groups and chains it needs to graph.
+		inline bool readOperands(TextLine & line, GraphOp op, Graph & graph, GraphNode & node) {
+			int64_t seed = 0, count = 0;
+			std::vector<int64_t> seeds;
+			switch (op) {
+			case GRAPH_INPUT:
+				if (!line.integer(count) || count < 0 || count > 3) { return false; }
+				node.source = (uint32_t) count;
+				return true;
+			case GRAPH_CONSTANT:
+				return line.number(node.params[0]);
+			case GRAPH_NOISE:
+			case GRAPH_FRACTAL:
+			case GRAPH_CHANNELS:
+				if (op != GRAPH_CHANNELS && !line.integer(seed)) { return false; }
+				if (op != GRAPH_NOISE) {
+					if (!line.integer(count) || count < 1 || !line.number(node.params[1]) || !line.number(node.params[2])) { return false; }
+					node.params[0] = (double) count;
+				}
+				if (op == GRAPH_CHANNELS) {
+					if (!line.integer(count) || count < 1 || (size_t) count > line.remaining()) { return false; }
+					seeds.resize((size_t) count);
+					for (int64_t k = 0; k < count; ++k) {
+						if (!line.integer(seeds[k])) { return false; }
+					}
+				}
+				else { seeds.push_back(seed); }
+				while (line.atName() && node.arity < 4) {
+					if (!line.node(node.inputs[node.arity])) { return false; }
+					++node.arity;
+				}
+				if (node.arity < 2 || (op == GRAPH_CHANNELS && node.arity > 3)) { return false; }
+				if (op == GRAPH_CHANNELS) {
+					std::vector<uint32_t> group;
+					for (size_t k = 0; k < seeds.size(); ++k) { group.push_back(graph.addGenerator(node.arity, seeds[k])); }
+					node.source = graph.addGroup(group);
+				}
+				else { node.source = graph.addGenerator(node.arity, seed); }
+				return true;
+			case GRAPH_CHANNEL:
+				node.arity = 1;
+				if (!line.node(node.inputs[0]) || !line.integer(count) || count < 0) { return false; }
+				node.source = (uint32_t) count;
+				return true;
+			default:
+				break;
+			}
+
+			node.arity = (op == GRAPH_BLEND || op == GRAPH_SELECT) ? 3 :
+				(op == GRAPH_ADD || op == GRAPH_SUBTRACT || op == GRAPH_MULTIPLY || op == GRAPH_MIN || op == GRAPH_MAX || op == GRAPH_MIX) ? 2 : 1;
+			for (int a = 0; a < node.arity; ++a) {
+				if (!line.node(node.inputs[a])) { return false; }
+			}
+			GraphCurve curve;
+			switch (op) {
+			case GRAPH_SCALE_BIAS:
+			case GRAPH_CLAMP:
+			case GRAPH_SELECT:
+				return line.number(node.params[0]) && line.number(node.params[1]);
+			case GRAPH_MIX:
+				return line.number(node.params[0]) && line.number(node.params[1]) && line.number(node.params[2]);
+			case GRAPH_CURVE:
+				if (!line.curve(curve)) { return false; }
+				node.source = graph.addCurve(curve);
+				return true;
+			case GRAPH_CHAIN: {
+				if (!line.integer(count) || count < 0) { return false; }
+				std::vector<GraphNode> steps;
+				for (int64_t k = 0; k < count; ++k) {
+					std::string name;
+					if (!line.word(name)) { return false; }
+					GraphNode step = Graph::makeNode(GRAPH_ABS, 1);
+					if (name == "scale_bias" || name == "clamp") {
+						step.op = (name == "clamp") ? GRAPH_CLAMP : GRAPH_SCALE_BIAS;
+						if (!line.number(step.params[0]) || !line.number(step.params[1])) { return false; }
+					}
+					else if (name == "curve") {
+						step.op = GRAPH_CURVE;
+						if (!line.curve(curve)) { return false; }
+						step.source = graph.addCurve(curve);
+					}
+					else if (name != "abs") { return false; }
+					steps.push_back(step);
+				}
+				node.source = graph.addChain(steps);
+				return true;
+			}
+			default:
+				return true;
+			}
+		}
+
+		// Reads a graph in the text format. On failure, returns false with
+		// the line and reason in error, and leaves graph unspecified.
+		inline bool readText(std::istream & in, Graph & graph, std::string * error = NULL) {
+			graph = Graph();
+			std::map<std::string, Graph::Node> names;
+			std::string text;
+			int number = 0;
+			bool header = false, output = false;
+			std::ostringstream message;
+			while (std::getline(in, text)) {
+				++number;
+				TextLine line(text, names, graph);
+				if (line.empty()) { continue; }
+				std::string first;
+				line.word(first);
+				if (!header) {
+					int64_t version = 0;
+					if (first != "osn-graph" || !line.integer(version) || version != VERSION || !line.done()) {
+						message << "line " << number << ": expected osn-graph " << VERSION;
+						break;
+					}
+					header = true;
+					continue;
+				}
+				if (first == "output") {
+					Graph::Node node = 0;
+					if (!line.node(node) || !line.done()) {
+						message << "line " << number << ": expected output NAME";
+						break;
+					}
+					graph.setOutput(node);
+					output = true;
+					continue;
+				}
+				std::string equals, opName;
+				if (!(std::isalpha((unsigned char) first[0]) || first[0] == '_') || !line.word(equals) || equals != "=" || !line.word(opName)) {
+					message << "line " << number << ": expected NAME = OP ...";
+					break;
+				}
+				int op = 0;
+				while (op < OP_COUNT && opName != OP_NAMES[op]) { ++op; }
+				if (op == OP_COUNT) {
+					message << "line " << number << ": unknown op " << opName;
+					break;
+				}
+				GraphNode node = Graph::makeNode((GraphOp) op, 0);
+				if (!readOperands(line, (GraphOp) op, graph, node) || !line.done()) {
+					message << "line " << number << ": bad operands for " << opName;
+					break;
+				}
+				if (names.count(first)) {
+					message << "line " << number << ": " << first << " is already defined";
+					break;
+				}
+				names[first] = graph.append(node);
+			}
+			if (message.tellp() == 0 && !header) { message << "missing osn-graph header"; }
+			if (message.tellp() == 0 && graph.size() > 0 && !output) { message << "missing output"; }
+			if (message.tellp() != 0) {
+				if (error) { *error = message.str(); }
+				return false;
+			}
+			return validate(graph, error);
+		}
+
+		inline void put32(std::ostream & out, uint32_t value) {
+			char bytes[4];
+			for (int i = 0; i < 4; ++i) { bytes[i] = (char) ((value >> (8 * i)) & 0xFF); }
+			out.write(bytes, 4);
+		}
+
+		inline void put64(std::ostream & out, uint64_t value) {
+			put32(out, (uint32_t) value);
+			put32(out, (uint32_t) (value >> 32));
+		}
+
+		inline void putDouble(std::ostream & out, double value) {
+			uint64_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			put64(out, bits);
+		}
+
+		inline bool get32(std::istream & in, uint32_t & value) {
+			unsigned char bytes[4];
+			if (!in.read((char *) bytes, 4)) { return false; }
+			value = 0;
+			for (int i = 0; i < 4; ++i) { value |= (uint32_t) bytes[i] << (8 * i); }
+			return true;
+		}
+
+		inline bool get64(std::istream & in, uint64_t & value) {
+			uint32_t lo = 0, hi = 0;
+			if (!get32(in, lo) || !get32(in, hi)) { return false; }
+			value = (uint64_t) lo | ((uint64_t) hi << 32);
+			return true;
+		}
+
+		inline bool getDouble(std::istream & in, double & value) {
+			uint64_t bits = 0;
+			if (!get64(in, bits)) { return false; }
+			std::memcpy(&value, &bits, sizeof(value));
+			return true;
+		}
+
+		// Whether nodes of op have a source, and how many of their params
+		// are used, which are all a binary node record holds.
+		inline bool hasSource(GraphOp op) {
+			return op == GRAPH_INPUT || op == GRAPH_NOISE || op == GRAPH_FRACTAL || op == GRAPH_CURVE ||
+				op == GRAPH_CHANNELS || op == GRAPH_CHANNEL || op == GRAPH_CHAIN;
+		}
+
+		inline int paramCount(GraphOp op) {
+			switch (op) {
+			case GRAPH_CONSTANT: return 1;
+			case GRAPH_SCALE_BIAS: case GRAPH_CLAMP: case GRAPH_SELECT: return 2;
+			case GRAPH_FRACTAL: case GRAPH_CHANNELS: case GRAPH_MIX: return 3;
+			default: return 0;
+			}
+		}
+
+		inline void putNode(std::ostream & out, const GraphNode & node) {
+			const char header[2] = { (char) node.op, (char) node.arity };
+			out.write(header, 2);
+			for (int i = 0; i < node.arity; ++i) { put32(out, node.inputs[i]); }
+			if (hasSource(node.op)) { put32(out, node.source); }
+			for (int i = 0; i < paramCount(node.op); ++i) { putDouble(out, node.params[i]); }
+		}
+
+		inline bool getNode(std::istream & in, GraphNode & node) {
+			unsigned char header[2];
+			if (!in.read((char *) header, 2) || header[0] >= OP_COUNT || header[1] > 4) { return false; }
+			node = Graph::makeNode((GraphOp) header[0], header[1]);
+			for (int i = 0; i < node.arity; ++i) {
+				if (!get32(in, node.inputs[i])) { return false; }
+			}
+			if (hasSource(node.op) && !get32(in, node.source)) { return false; }
+			for (int i = 0; i < paramCount(node.op); ++i) {
+				if (!getDouble(in, node.params[i])) { return false; }
+			}
+			return true;
+		}
+
+		// Writes graph in the binary format: a magic number and version, the
+		// generator seeds of each dimension, the curves, groups and chains,
+		// the nodes, and the output, all little-endian. Each node is its op and
+		// arity in a byte each, then its inputs, its source if it has one and
+		// the params it uses.
+		inline void writeBinary(std::ostream & out, const Graph & graph) {
+			out.write(BINARY_MAGIC, 4);
+			put32(out, VERSION);
+			for (int d = 2; d <= 4; ++d) {
+				const std::vector<int64_t> & seeds = graph.seeds(d);
+				put32(out, (uint32_t) seeds.size());
+				for (size_t i = 0; i < seeds.size(); ++i) { put64(out, (uint64_t) seeds[i]); }
+			}
+			const std::vector<GraphCurve> & curves = graph.getCurves();
+			put32(out, (uint32_t) curves.size());
+			for (size_t i = 0; i < curves.size(); ++i) {
+				put32(out, (uint32_t) curves[i].x.size());
+				for (size_t k = 0; k < curves[i].x.size(); ++k) {
+					putDouble(out, curves[i].x[k]);
+					putDouble(out, curves[i].y[k]);
+				}
+			}
+			const std::vector<std::vector<uint32_t> > & groups = graph.getGroups();
+			put32(out, (uint32_t) groups.size());
+			for (size_t i = 0; i < groups.size(); ++i) {
+				put32(out, (uint32_t) groups[i].size());
+				for (size_t k = 0; k < groups[i].size(); ++k) { put32(out, groups[i][k]); }
+			}
+			const std::vector<std::vector<GraphNode> > & chains = graph.getChains();
+			put32(out, (uint32_t) chains.size());
+			for (size_t i = 0; i < chains.size(); ++i) {
+				put32(out, (uint32_t) chains[i].size());
+				for (size_t k = 0; k < chains[i].size(); ++k) { putNode(out, chains[i][k]); }
+			}
+			put32(out, (uint32_t) graph.size());
+			for (size_t i = 0; i < graph.size(); ++i) { putNode(out, graph.node((Graph::Node) i)); }
+			put32(out, graph.getOutput());
+		}
+
+		// Reads a graph in the binary format. On failure, returns false with
+		// the reason in error, and leaves graph unspecified.
+		inline bool readBinary(std::istream & in, Graph & graph, std::string * error = NULL) {
+			graph = Graph();
+			const char * problem = NULL;
+			char magic[4];
+			uint32_t version = 0, count = 0, length = 0, value = 0;
+			std::vector<uint32_t> curveMap;
+			if (!in.read(magic, 4) || std::memcmp(magic, BINARY_MAGIC, 4) != 0 || !get32(in, version) || version != VERSION) {
+				problem = "not an osn-graph binary of this version";
+			}
+			for (int d = 2; d <= 4 && !problem; ++d) {
+				if (!get32(in, count)) { problem = "truncated generators"; }
+				for (uint32_t i = 0; i < count && !problem; ++i) {
+					uint64_t seed = 0;
+					if (!get64(in, seed)) { problem = "truncated generators"; }
+					else if (graph.addGenerator(d, (int64_t) seed) != i) { problem = "repeated generator seed"; }
+				}
+			}
+			if (!problem && !get32(in, count)) { problem = "truncated curves"; }
+			for (uint32_t i = 0; i < count && !problem; ++i) {
+				GraphCurve curve;
+				if (!get32(in, length)) { problem = "truncated curves"; break; }
+				for (uint32_t k = 0; k < length && !problem; ++k) {
+					double x = 0.0, y = 0.0;
+					if (!getDouble(in, x) || !getDouble(in, y)) { problem = "truncated curves"; }
+					curve.x.push_back(x);
+					curve.y.push_back(y);
+				}
+				curveMap.push_back(graph.addCurve(curve));
+			}
+			if (!problem && !get32(in, count)) { problem = "truncated groups"; }
+			for (uint32_t i = 0; i < count && !problem; ++i) {
+				std::vector<uint32_t> group;
+				if (!get32(in, length)) { problem = "truncated groups"; break; }
+				for (uint32_t k = 0; k < length && !problem; ++k) {
+					if (!get32(in, value)) { problem = "truncated groups"; }
+					group.push_back(value);
+				}
+				graph.addGroup(group);
+			}
+			if (!problem && !get32(in, count)) { problem = "truncated chains"; }
+			for (uint32_t i = 0; i < count && !problem; ++i) {
+				std::vector<GraphNode> steps;
+				if (!get32(in, length)) { problem = "truncated chains"; break; }
+				for (uint32_t k = 0; k < length && !problem; ++k) {
+					GraphNode step;
+					if (!getNode(in, step)) { problem = "bad chain step"; break; }
+					if (step.op == GRAPH_CURVE) {
+						if (step.source >= curveMap.size()) { problem = "bad chain step"; break; }
+						step.source = curveMap[step.source];
+					}
+					steps.push_back(step);
+				}
+				graph.addChain(steps);
+			}
+			if (!problem && !get32(in, count)) { problem = "truncated nodes"; }
+			for (uint32_t i = 0; i < count && !problem; ++i) {
+				GraphNode node;
+				if (!getNode(in, node)) { problem = "truncated nodes"; break; }
+				if (node.op == GRAPH_CURVE) {
+					if (node.source >= curveMap.size()) { problem = "bad curve index"; break; }
+					node.source = curveMap[node.source];
+				}
+				graph.append(node);
+			}
+			if (!problem && !get32(in, value)) { problem = "truncated output"; }
+			if (problem) {
+				if (error) { *error = problem; }
+				return false;
+			}
+			graph.setOutput(value);
+			return validate(graph, error);
+		}
+
+		// Reads a graph in either format, telling them apart by the binary
+		// format's magic number.
+		inline bool read(std::istream & in, Graph & graph, std::string * error = NULL) {
+			char magic[4] = { 0, 0, 0, 0 };
+			in.read(magic, 4);
+			const bool binary = in.gcount() == 4 && std::memcmp(magic, BINARY_MAGIC, 4) == 0;
+			in.clear();
+			in.seekg(0);
+			return binary ? readBinary(in, graph, error) : readText(in, graph, error);
+		}
+
+	}
+
+	// A GraphPlan compiled from a graph file, which can be replaced while
+	// other threads evaluate it. Each frame takes the current plan once with
+	// get, and evaluates with that until it is done. reload compiles a new
+	// plan completely before publishing it with one atomic store, so each
+	// frame sees either the old plan or the new one, never a mix, and the
+	// old plan is freed when the last frame holding it lets go.
+	//
+	// get may be called from any thread; reload and load from one at a time.
+	class LiveGraph {
+
+	public:
+
+		typedef std::shared_ptr<const GraphPlan> Plan;
+
+		// Graphs are run through GraphOptimizer unless optimize is false.
+		explicit LiveGraph(const std::string & path, bool optimize = true) : path(path), optimize(optimize), version(0) {}
+
+		Plan get(void) const { return std::atomic_load(&plan); }
+
+		// Reads the file again, and compiles and publishes it if it changed
+		// since the last plan was published. Returns false, keeping the
+		// current plan, if the file cannot be read or does not hold a valid
+		// graph; getError says why.
+		bool reload(void) {
+			std::ifstream in(path.c_str(), std::ios::binary);
+			if (!in) {
+				error = "cannot open " + path;
+				return false;
+			}
+			std::ostringstream data;
+			data << in.rdbuf();
+			if (get() && data.str() == contents) { return true; }
+			return load(data.str());
+		}
+
+		// As reload, from the contents of a graph file in memory.
+		bool load(const std::string & data) {
+			OSN_TRACE_SPAN("LiveGraph::load");
+			std::istringstream in(data);
+			Graph graph;
+			if (!GraphFile::read(in, graph, &error)) { return false; }
+			if (optimize) { graph = GraphOptimizer::optimize(graph); }
+			Plan next = std::make_shared<GraphPlan>(graph);
+			std::atomic_store(&plan, next);
+			contents = data;
+			error.clear();
+			++version;
+			return true;
+		}
+
+		const std::string & getError(void) const { return error; }
+
+		// How many plans have been published.
+		uint64_t getVersion(void) const { return version; }
+
+	private:
+
+		std::string path, contents, error;
+		bool optimize;
+		uint64_t version;
+		Plan plan;
+
+	};
+
+}
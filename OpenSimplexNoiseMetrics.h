@@ -0,0 +1,223 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * Runtime metrics
+ *
+ * A small registry of named counters kept per thread and summed when a
+ * snapshot is taken, so that the evaluation paths never contend on a shared
+ * cache line. Counters are signed, so a gauge could be kept as the running
+ * sum of per-thread increments and decrements. The library has no job
+ * scheduler or tile cache, so only the samples its kernels evaluate are
+ * counted; an application's own queues are better measured where they live.
+ *
+ * Metrics are compiled out unless OSN_ENABLE_METRICS is defined; the
+ * OSN_METRICS_* macros then expand to nothing. When enabled, each update is
+ * a relaxed load and store of the calling thread's own counter (a plain add
+ * on common hardware, with no locked read-modify-write instruction).
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+
+#ifdef OSN_ENABLE_METRICS
+// Adds n to the calling thread's share of the given counter.
+#define OSN_METRICS_ADD(counter, n) ::OSN::Metrics::add(::OSN::Metrics::counter, n)
+#else
+#define OSN_METRICS_ADD(counter, n) ((void) 0)
+#endif
+
+
+namespace OSN {
+
+	namespace Metrics {
+
+		enum Counter {
+			EVAL_1D_SAMPLES,
+			EVAL_2D_SAMPLES,
+			EVAL_3D_SAMPLES,
+			EVAL_4D_SAMPLES,
+			DEVAL_2D_SAMPLES,
+			DERIVATIVES_2D_SAMPLES,
+			DERIVATIVES_3D_SAMPLES,
+			NUM_COUNTERS
+		};
+
+		// Names in the Prometheus text exposition style, indexed by Counter.
+		inline const char * counterName(int counter) {
+			static const char * const names[NUM_COUNTERS] = {
+				"osn_eval_samples_total{dim=\"1\"}",
+				"osn_eval_samples_total{dim=\"2\"}",
+				"osn_eval_samples_total{dim=\"3\"}",
+				"osn_eval_samples_total{dim=\"4\"}",
+				"osn_deval_samples_total{dim=\"2\"}",
+				"osn_derivatives_samples_total{dim=\"2\"}",
+				"osn_derivatives_samples_total{dim=\"3\"}"
+			};
+			return names[counter];
+		}
+
+		// Counters owned by a single thread. Only the owning thread writes;
+		// atomics are used so that concurrent snapshots are well-defined.
+		struct ThreadCounters {
+
+			ThreadCounters(void) {
+				for (int i = 0; i < NUM_COUNTERS; ++i) { values[i].store(0, std::memory_order_relaxed); }
+			}
+
+			std::atomic<int64_t> values[NUM_COUNTERS];
+
+		};
+
+		// The microarchitecture level whose batch kernels the loader picked, as
+		// "x86-64-v2" to "x86-64-v4" or "default", or "generic" in a build
+		// without multiversioning. Defined in OpenSimplexNoise.cpp, next to
+		// the kernels.
+		const char * dispatchedKernelVariant(void);
+
+		class Registry {
+
+		public:
+
+			static Registry & instance(void) {
+				static Registry registry;
+				return registry;
+			}
+
+			Registry(void) : kernelVariant(dispatchedKernelVariant()) {
+				for (int i = 0; i < NUM_COUNTERS; ++i) { retired[i] = 0; }
+			}
+
+			ThreadCounters * registerThread(void) {
+				std::lock_guard<std::mutex> lock(mutex);
+				threads.push_back(new ThreadCounters());
+				return threads.back();
+			}
+
+			// Adds the counters of an exiting thread to the retired totals, so
+			// that totals never go backwards, and frees them.
+			void retireThread(ThreadCounters * counters) {
+				std::lock_guard<std::mutex> lock(mutex);
+				for (int i = 0; i < NUM_COUNTERS; ++i) { retired[i] += counters->values[i].load(std::memory_order_relaxed); }
+				for (size_t t = 0; t < threads.size(); ++t) {
+					if (threads[t] == counters) {
+						threads[t] = threads.back();
+						threads.pop_back();
+						break;
+					}
+				}
+				delete counters;
+			}
+
+			std::mutex mutex;
+			std::vector<ThreadCounters *> threads;
+			int64_t retired[NUM_COUNTERS];
+			const char * kernelVariant;
+
+		};
+
+		// Registers the calling thread's counters and retires them when the
+		// thread exits.
+		struct ThreadRegistration {
+
+			explicit ThreadRegistration(ThreadCounters * & slot) : slot(slot) {
+				slot = Registry::instance().registerThread();
+			}
+
+			~ThreadRegistration(void) {
+				Registry::instance().retireThread(slot);
+				slot = NULL;
+			}
+
+			ThreadCounters * & slot;
+
+		};
+
+		inline ThreadCounters & threadCounters(void) {
+			// Constant-initialized, so access needs no thread-safe-static guard;
+			// only the first call on each thread reaches the registration.
+			static thread_local ThreadCounters * counters = NULL;
+			if (counters == NULL) { static thread_local ThreadRegistration registration(counters); }
+			return *counters;
+		}
+
+		inline void add(Counter counter, int64_t n) {
+			std::atomic<int64_t> & value = threadCounters().values[counter];
+			value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+
+		// Records which kernel implementation is serving evaluations.
+		// The string must outlive the registry, e.g. a string literal.
+		inline void setKernelVariant(const char * name) {
+			Registry & registry = Registry::instance();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.kernelVariant = name;
+		}
+
+		struct Snapshot {
+
+			std::chrono::steady_clock::time_point time;
+			int64_t values[NUM_COUNTERS];
+			const char * kernelVariant;
+
+			// Per-second rate of a counter between an earlier snapshot and this one.
+			double rate(const Snapshot & earlier, Counter counter) const {
+				double seconds = std::chrono::duration<double>(time - earlier.time).count();
+				return (seconds > 0.0) ? (values[counter] - earlier.values[counter]) / seconds : 0.0;
+			}
+
+			// Writes one "name value" line per counter, followed by the rates of
+			// the sample counters relative to an earlier snapshot, if given.
+			void write(std::ostream & out, const Snapshot * earlier = NULL) const {
+				out << "osn_kernel_info{variant=\"" << kernelVariant << "\"} 1\n";
+				for (int i = 0; i < NUM_COUNTERS; ++i) {
+					out << counterName(i) << ' ' << values[i] << '\n';
+				}
+				if (earlier != NULL) {
+					static const char * const dims[] = { "1", "2", "3", "4" };
+					for (int i = EVAL_1D_SAMPLES; i <= EVAL_4D_SAMPLES; ++i) {
+						out << "osn_eval_samples_per_second{dim=\"" << dims[i - EVAL_1D_SAMPLES] << "\"} "
+							<< rate(*earlier, (Counter) i) << '\n';
+					}
+				}
+			}
+
+		};
+
+		// Sums every live thread's counters and those of the threads that have
+		// exited. May run concurrently with updates, in which case each counter
+		// reflects some recent value.
+		inline Snapshot snapshot(void) {
+			Registry & registry = Registry::instance();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			Snapshot s;
+			s.time = std::chrono::steady_clock::now();
+			s.kernelVariant = registry.kernelVariant;
+			for (int i = 0; i < NUM_COUNTERS; ++i) { s.values[i] = registry.retired[i]; }
+			for (size_t t = 0; t < registry.threads.size(); ++t) {
+				for (int i = 0; i < NUM_COUNTERS; ++i) {
+					s.values[i] += registry.threads[t]->values[i].load(std::memory_order_relaxed);
+				}
+			}
+			return s;
+		}
+
+	}
+
+}
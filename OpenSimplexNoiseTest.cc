@@ -4,7 +4,7 @@
  *
  * Modified 2014-12-04
  *
- * This file is intended to test the function of OpenSimplexNoise.hh
+ * This file is intended to test the function of OpenSimplexNoise.h
  * by creating example images of 2D, 3D and 4D noise.
  * It requires that you have development packages for libpng installed.
  *
@@ -20,7 +20,7 @@
 #include <cmath>
 #include <iostream>
 
-#include "OpenSimplexNoise.hh"
+#include "OpenSimplexNoise.h"
 
 
 const int WIDTH = 512;
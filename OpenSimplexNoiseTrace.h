@@ -0,0 +1,274 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * Timeline tracing
+ *
+ * Records spans and instant events from any number of threads into
+ * per-thread buffers and exports them in the Chrome trace event format
+ * (load the output in chrome://tracing or https://ui.perfetto.dev).
+ *
+ * Tracing is compiled out unless OSN_ENABLE_TRACE is defined; the
+ * OSN_TRACE_* macros then expand to nothing. When enabled, recording an
+ * event takes no locks and performs no allocation: each thread owns a
+ * fixed-capacity buffer that only it writes to, and events beyond the
+ * capacity are counted and dropped. A mutex is taken only the first time a
+ * thread records an event, to register its buffer, and when it exits.
+ *
+ * A buffer outlives its thread, so that the events of threads that have
+ * exited can still be exported, and is handed on to the next thread that
+ * registers: threads that come and go (a pool that is torn down and rebuilt
+ * per frame) append to the same buffers, which show as one track each,
+ * instead of allocating one per thread ever started. Memory is bounded by
+ * the largest number of threads recording at once.
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+
+#ifndef OSN_TRACE_BUFFER_EVENTS
+#define OSN_TRACE_BUFFER_EVENTS 65536
+#endif
+
+#define OSN_TRACE_CONCAT_INNER(a, b) a ## b
+#define OSN_TRACE_CONCAT(a, b) OSN_TRACE_CONCAT_INNER(a, b)
+
+#ifdef OSN_ENABLE_TRACE
+// Records a span covering the rest of the enclosing scope.
+#define OSN_TRACE_SPAN(name) ::OSN::Trace::Span OSN_TRACE_CONCAT(osnTraceSpan, __LINE__)(name)
+// Records a single point in time.
+#define OSN_TRACE_INSTANT(name) ::OSN::Trace::instant(name)
+// Records a span between an earlier OSN_TRACE_NOW() and the current time.
+#define OSN_TRACE_SINCE(name, begin) ::OSN::Trace::complete(name, begin, ::OSN::Trace::now())
+#define OSN_TRACE_NOW() ::OSN::Trace::now()
+#else
+#define OSN_TRACE_SPAN(name) ((void) 0)
+#define OSN_TRACE_INSTANT(name) ((void) 0)
+#define OSN_TRACE_SINCE(name, begin) ((void) (begin))
+#define OSN_TRACE_NOW() ((uint64_t) 0)
+#endif
+
+
+namespace OSN {
+
+	namespace Trace {
+
+		struct Event {
+			// Must point to storage that outlives the trace, e.g. a string literal.
+			const char * name;
+			// 'X' for a complete span, 'i' for an instant.
+			char phase;
+			// Nanoseconds since the first event recorded in the process.
+			uint64_t begin;
+			uint64_t duration;
+		};
+
+		// Events recorded by a single thread. Only the owning thread writes;
+		// readers see every event published before the count they load.
+		class ThreadBuffer {
+
+		public:
+
+			ThreadBuffer(uint32_t id) : id(id), count(0), dropped(0), live(true) {
+				events.resize(OSN_TRACE_BUFFER_EVENTS);
+			}
+
+			inline void record(const char * name, char phase, uint64_t begin, uint64_t duration) {
+				size_t n = count.load(std::memory_order_relaxed);
+				if (n == events.size()) {
+					dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					return;
+				}
+				Event & e = events[n];
+				e.name = name;
+				e.phase = phase;
+				e.begin = begin;
+				e.duration = duration;
+				count.store(n + 1, std::memory_order_release);
+			}
+
+			const uint32_t id;
+			std::vector<Event> events;
+			std::atomic<size_t> count;
+			std::atomic<uint64_t> dropped;
+			// Whether a running thread owns the buffer. Guarded by the registry.
+			bool live;
+
+		};
+
+		class Registry {
+
+		public:
+
+			static Registry & instance(void) {
+				static Registry registry;
+				return registry;
+			}
+
+			// Hands the calling thread the retired buffer with the most room
+			// left, or a new one if every buffer is in use.
+			ThreadBuffer * registerThread(void) {
+				std::lock_guard<std::mutex> lock(mutex);
+				ThreadBuffer * best = NULL;
+				for (size_t b = 0; b < buffers.size(); ++b) {
+					ThreadBuffer * buffer = buffers[b];
+					if (buffer->live) { continue; }
+					if (best == NULL || buffer->count.load(std::memory_order_relaxed) < best->count.load(std::memory_order_relaxed)) {
+						best = buffer;
+					}
+				}
+				if (best == NULL) {
+					buffers.push_back(new ThreadBuffer((uint32_t) buffers.size() + 1));
+					return buffers.back();
+				}
+				best->live = true;
+				return best;
+			}
+
+			// Called as a thread exits. Its events stay in the buffer until
+			// cleared; later threads append after them.
+			void retireThread(ThreadBuffer * buffer) {
+				std::lock_guard<std::mutex> lock(mutex);
+				buffer->live = false;
+			}
+
+			std::mutex mutex;
+			std::vector<ThreadBuffer *> buffers;
+			const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+		};
+
+		inline uint64_t now(void) {
+			return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - Registry::instance().epoch).count();
+		}
+
+		// Registers the calling thread's buffer and retires it when the
+		// thread exits.
+		struct ThreadRegistration {
+
+			explicit ThreadRegistration(ThreadBuffer * & slot) : slot(slot) {
+				slot = Registry::instance().registerThread();
+			}
+
+			~ThreadRegistration(void) {
+				Registry::instance().retireThread(slot);
+				slot = NULL;
+			}
+
+			ThreadBuffer * & slot;
+
+		};
+
+		inline ThreadBuffer & threadBuffer(void) {
+			// Constant-initialized, so access needs no thread-safe-static guard;
+			// only the first call on each thread reaches the registration.
+			static thread_local ThreadBuffer * buffer = NULL;
+			if (buffer == NULL) { static thread_local ThreadRegistration registration(buffer); }
+			return *buffer;
+		}
+
+		inline void complete(const char * name, uint64_t begin, uint64_t end) {
+			threadBuffer().record(name, 'X', begin, end - begin);
+		}
+
+		inline void instant(const char * name) {
+			threadBuffer().record(name, 'i', now(), 0);
+		}
+
+		class Span {
+
+		public:
+
+			explicit Span(const char * name) : name(name), begin(now()) {}
+			~Span(void) { complete(name, begin, now()); }
+
+		private:
+
+			Span(const Span &);
+			Span & operator=(const Span &);
+
+			const char * name;
+			const uint64_t begin;
+
+		};
+
+		// Discards all recorded events. Must not race with recording threads.
+		inline void clear(void) {
+			Registry & registry = Registry::instance();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			for (size_t i = 0; i < registry.buffers.size(); ++i) {
+				registry.buffers[i]->count.store(0, std::memory_order_relaxed);
+				registry.buffers[i]->dropped.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		// Chrome trace timestamps are in microseconds; keep full nanosecond precision.
+		inline void writeMicroseconds(std::ostream & out, uint64_t ns) {
+			char fraction[4] = {
+				(char) ('0' + (ns / 100) % 10),
+				(char) ('0' + (ns / 10) % 10),
+				(char) ('0' + ns % 10),
+				'\0'
+			};
+			out << (ns / 1000) << '.' << fraction;
+		}
+
+		// Writes every event published so far as Chrome trace JSON. Safe to call
+		// while other threads are still recording; their later events are omitted.
+		// Names are written verbatim and must not need JSON escaping.
+		inline void writeChromeTrace(std::ostream & out) {
+			Registry & registry = Registry::instance();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+			bool first = true;
+			for (size_t b = 0; b < registry.buffers.size(); ++b) {
+				const ThreadBuffer & buffer = *registry.buffers[b];
+				size_t n = buffer.count.load(std::memory_order_acquire);
+				for (size_t i = 0; i < n; ++i) {
+					const Event & e = buffer.events[i];
+					out << (first ? "\n" : ",\n");
+					first = false;
+					out << "{\"name\":\"" << e.name << "\",\"ph\":\"" << e.phase
+						<< "\",\"pid\":1,\"tid\":" << buffer.id
+						<< ",\"ts\":";
+					writeMicroseconds(out, e.begin);
+					if (e.phase == 'X') {
+						out << ",\"dur\":";
+						writeMicroseconds(out, e.duration);
+					}
+					else {
+						out << ",\"s\":\"t\"";
+					}
+					out << '}';
+				}
+				uint64_t dropped = buffer.dropped.load(std::memory_order_relaxed);
+				if (dropped != 0) {
+					out << (first ? "\n" : ",\n");
+					first = false;
+					out << "{\"name\":\"dropped " << dropped << " events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":"
+						<< buffer.id << ",\"ts\":0}";
+				}
+			}
+			out << "\n]}\n";
+		}
+
+	}
+
+}
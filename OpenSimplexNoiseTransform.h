@@ -0,0 +1,322 @@
+/*
+ * OpenSimplex (Simplectic) Noise in C++
+ * Domain transforms
+ *
+ * Affine<N> maps input coordinates before a generator sees them: a rotation
+ * that hides the lattice's axis-aligned artifacts, a shear, or a scale and
+ * offset. Transformed<Source, N> applies one on the batch path, with the
+ * same eval and evalBatch interface as the source, and the fillGrid and
+ * fillVolume overloads that take an Affine apply it on the grid paths.
+ *
+ * A grid's pixels map to points of a transformed grid, whose rows start at
+ * points computed from the origin and whose pixels advance along a row by
+ * a constant vector, so a transformed grid costs a multiply-add per axis
+ * per pixel, as an untransformed one does, rather than a matrix product.
+ *
+ * Anyone is free to make use of this software in whatever way they want.
+ * Attribution is appreciated, but not required.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "OpenSimplexNoise.h"
+#include "OpenSimplexNoiseFill.h"
+
+
+namespace OSN {
+
+	// The map p -> matrix * p + offset of N-dimensional coordinates. Starts
+	// as the identity.
+	template <int N>
+	struct Affine {
+
+		Affine(void) {
+			for (int a = 0; a < N; ++a) {
+				for (int b = 0; b < N; ++b) { matrix[a][b] = (a == b) ? 1.0 : 0.0; }
+				offset[a] = 0.0;
+			}
+		}
+
+		// This map applied after other.
+		Affine after(const Affine & other) const {
+			Affine result;
+			for (int a = 0; a < N; ++a) {
+				result.offset[a] = offset[a];
+				for (int b = 0; b < N; ++b) {
+					double sum = 0.0;
+					for (int k = 0; k < N; ++k) { sum += matrix[a][k] * other.matrix[k][b]; }
+					result.matrix[a][b] = sum;
+					result.offset[a] += matrix[a][b] * other.offset[b];
+				}
+			}
+			return result;
+		}
+
+		template <typename In, typename Out>
+		void apply(const In * in, Out * out) const {
+			for (int a = 0; a < N; ++a) {
+				double sum = offset[a];
+				for (int b = 0; b < N; ++b) { sum += matrix[a][b] * (double) in[b]; }
+				out[a] = (Out) sum;
+			}
+		}
+
+		double matrix[N][N];
+		double offset[N];
+
+	};
+
+	// Rotation of the plane by angle radians counterclockwise.
+	inline Affine<2> affineRotation(double angle) {
+		Affine<2> r;
+		r.matrix[0][0] = std::cos(angle);
+		r.matrix[0][1] = -std::sin(angle);
+		r.matrix[1][0] = std::sin(angle);
+		r.matrix[1][1] = std::cos(angle);
+		return r;
+	}
+
+	// Rotation that turns the z axis onto the lattice's main diagonal
+	// (1, 1, 1), the direction Noise<3> stretches along, so that xy slices
+	// cut the lattice evenly and show no axis-aligned artifacts; for when z
+	// is time or height. The same rotation as Noise2F<3>::evalImproveXY.
+	inline Affine<3> affineImproveXY(void) {
+		const double s2 = -0.211324865405187, zz = 0.577350269189626;
+		Affine<3> r;
+		r.matrix[0][0] = 1.0 + s2; r.matrix[0][1] = s2;       r.matrix[0][2] = zz;
+		r.matrix[1][0] = s2;       r.matrix[1][1] = 1.0 + s2; r.matrix[1][2] = zz;
+		r.matrix[2][0] = -zz;      r.matrix[2][1] = -zz;      r.matrix[2][2] = zz;
+		return r;
+	}
+
+	// Source evaluated at domain(p) for every point p: the batch path of a
+	// domain transform. Gradients are returned with respect to p, through
+	// the transpose of the matrix.
+	//
+	// Holds a reference to the source, which must outlive it.
+	template <typename Source, int N>
+	class Transformed {
+
+	public:
+
+		Transformed(const Source & source, const Affine<N> & domain) : source(&source), domain(domain) {}
+
+		const Source & getSource(void) const { return *source; }
+		const Affine<N> & getDomain(void) const { return domain; }
+
+		template <typename T, typename... Ts>
+		T eval(T x0, Ts... xs) const {
+			static_assert(1 + sizeof...(Ts) == N, "Transformed::eval takes N coordinates");
+			const T in[N] = { x0, (T) xs... };
+			T p[N];
+			domain.apply(in, p);
+			return evalAt(p);
+		}
+
+		template <typename T>
+		void evalBatch(const T * x, const T * y, T * out, size_t count) const {
+			const T * in[2] = { x, y };
+			transformBlocks(in, out, count);
+		}
+
+		template <typename T>
+		void evalBatch(const T * x, const T * y, const T * z, T * out, size_t count) const {
+			const T * in[3] = { x, y, z };
+			transformBlocks(in, out, count);
+		}
+
+		template <typename T>
+		void evalGradientBatch(const T * x, const T * y, ValueGradient<T, 2> * out, size_t count) const {
+			const T * in[2] = { x, y };
+			transformBlocks(in, out, count);
+		}
+
+		template <typename T>
+		void evalGradientBatch(const T * x, const T * y, const T * z, ValueGradient<T, 3> * out, size_t count) const {
+			const T * in[3] = { x, y, z };
+			transformBlocks(in, out, count);
+		}
+
+	private:
+
+		const Source * source;
+		Affine<N> domain;
+
+		template <typename T>
+		T evalAt(const T (&p)[2]) const { return source->eval(p[0], p[1]); }
+
+		template <typename T>
+		T evalAt(const T (&p)[3]) const { return source->eval(p[0], p[1], p[2]); }
+
+		template <typename T>
+		void sourceBatch(T (&p)[2][Fill::BLOCK], T * out, size_t n) const { source->evalBatch(p[0], p[1], out, n); }
+
+		template <typename T>
+		void sourceBatch(T (&p)[3][Fill::BLOCK], T * out, size_t n) const { source->evalBatch(p[0], p[1], p[2], out, n); }
+
+		template <typename T>
+		void sourceBatch(T (&p)[2][Fill::BLOCK], ValueGradient<T, 2> * out, size_t n) const {
+			source->evalGradientBatch(p[0], p[1], out, n);
+			pullBack(out, n);
+		}
+
+		template <typename T>
+		void sourceBatch(T (&p)[3][Fill::BLOCK], ValueGradient<T, 3> * out, size_t n) const {
+			source->evalGradientBatch(p[0], p[1], p[2], out, n);
+			pullBack(out, n);
+		}
+
+		// Turns gradients with respect to the transformed point into gradients
+		// with respect to the input.
+		template <typename T>
+		void pullBack(ValueGradient<T, N> * out, size_t n) const {
+			T m[N][N];
+			for (int a = 0; a < N; ++a) {
+				for (int b = 0; b < N; ++b) { m[a][b] = (T) domain.matrix[a][b]; }
+			}
+			for (size_t i = 0; i < n; ++i) {
+				T g[N];
+				for (int b = 0; b < N; ++b) {
+					g[b] = (T)0.0;
+					for (int a = 0; a < N; ++a) { g[b] += m[a][b] * out[i].gradient[a]; }
+				}
+				for (int b = 0; b < N; ++b) { out[i].gradient[b] = g[b]; }
+			}
+		}
+
+		template <typename T, typename Out>
+		void transformBlocks(const T * const * in, Out * out, size_t count) const {
+			T m[N][N], o[N];
+			for (int a = 0; a < N; ++a) {
+				for (int b = 0; b < N; ++b) { m[a][b] = (T) domain.matrix[a][b]; }
+				o[a] = (T) domain.offset[a];
+			}
+			T p[N][Fill::BLOCK];
+			for (size_t begin = 0; begin < count; begin += Fill::BLOCK) {
+				size_t n = count - begin;
+				if (n > Fill::BLOCK) { n = Fill::BLOCK; }
+				for (int a = 0; a < N; ++a) {
+					for (size_t i = 0; i < n; ++i) { p[a][i] = o[a]; }
+					for (int b = 0; b < N; ++b) {
+						const T * src = in[b] + begin;
+						for (size_t i = 0; i < n; ++i) { p[a][i] += m[a][b] * src[i]; }
+					}
+				}
+				sourceBatch(p, out + begin, n);
+			}
+		}
+
+	};
+
+	namespace Fill {
+
+		template <typename Source, typename T>
+		void affineBatch(const Source & source, T (&p)[2][BLOCK], T * out, size_t n) { source.evalBatch(p[0], p[1], out, n); }
+
+		template <typename Source, typename T>
+		void affineBatch(const Source & source, T (&p)[3][BLOCK], T * out, size_t n) { source.evalBatch(p[0], p[1], p[2], out, n); }
+
+		// Evaluates the points origin + i * along for i in 0..count, the pixels
+		// of one row of a transformed grid.
+		template <typename Source, typename T, int N, typename Stats>
+		void affineRow(const Source & source, const T (&origin)[N], const T (&along)[N], T * out, size_t count, Stats & stats) {
+			T p[N][BLOCK];
+			for (size_t begin = 0; begin < count; begin += BLOCK) {
+				size_t n = count - begin;
+				if (n > BLOCK) { n = BLOCK; }
+				for (int a = 0; a < N; ++a) {
+					for (size_t i = 0; i < n; ++i) { p[a][i] = origin[a] + along[a] * (T) (int64_t) (begin + i); }
+				}
+				affineBatch(source, p, out + begin, n);
+				stats.add(out + begin, n);
+			}
+		}
+
+		// Fills out from source at domain(x0 + i * step, y0 + j * step) for
+		// every pixel (i, j). Each row's first point is computed from the
+		// origin, so rounding does not accumulate down the image.
+		template <typename Source, typename T, typename Stats>
+		void affineGrid(const Source & source, const Affine<2> & domain, T x0, T y0, T step, const ImageView<T> & out, Stats & stats) {
+			const T along[2] = { (T) (domain.matrix[0][0] * step), (T) (domain.matrix[1][0] * step) };
+			for (size_t row = 0; row < out.height; ++row) {
+				const double in[2] = { (double) x0, (double) y0 + (double) step * (double) row };
+				T origin[2];
+				domain.apply(in, origin);
+				affineRow(source, origin, along, out.row(row), out.width, stats);
+			}
+		}
+
+		// As above, for the slice at z of a 3D source.
+		template <typename Source, typename T, typename Stats>
+		void affineGrid(const Source & source, const Affine<3> & domain, T x0, T y0, T z, T step, const ImageView<T> & out, Stats & stats) {
+			const T along[3] = { (T) (domain.matrix[0][0] * step), (T) (domain.matrix[1][0] * step), (T) (domain.matrix[2][0] * step) };
+			for (size_t row = 0; row < out.height; ++row) {
+				const double in[3] = { (double) x0, (double) y0 + (double) step * (double) row, (double) z };
+				T origin[3];
+				domain.apply(in, origin);
+				affineRow(source, origin, along, out.row(row), out.width, stats);
+			}
+		}
+
+		template <typename Source, typename T, typename Stats>
+		void affineVolume(const Source & source, const Affine<3> & domain, T x0, T y0, T z0, T step, size_t width, size_t height, size_t depth, T * out, Stats & stats) {
+			for (size_t k = 0; k < depth; ++k) {
+				T z = z0 + step * (T) (int64_t) k;
+				affineGrid(source, domain, x0, y0, z, step, ImageView<T>(out + k * width * height, width, height), stats);
+			}
+		}
+
+	}
+
+	// As fillGrid, sampling source at domain(x0 + i * step, y0 + j * step)
+	// for every pixel (i, j). The same as filling from a Transformed source,
+	// up to rounding, without the matrix product per pixel.
+	template <typename Source, typename T>
+	void fillGrid(const Source & source, const Affine<2> & domain, T x0, T y0, T step, const ImageView<T> & out) {
+		Fill::NoStats none;
+		Fill::affineGrid(source, domain, x0, y0, step, out, none);
+	}
+
+	// As above, for the slice at z of a 3D source.
+	template <typename Source, typename T>
+	void fillGrid(const Source & source, const Affine<3> & domain, T x0, T y0, T z, T step, const ImageView<T> & out) {
+		Fill::NoStats none;
+		Fill::affineGrid(source, domain, x0, y0, z, step, out, none);
+	}
+
+	template <typename Source, typename T>
+	void fillGrid(const Source & source, const Affine<2> & domain, T x0, T y0, T step, const ImageView<T> & out, FillStats<T> & stats) {
+		Fill::affineGrid(source, domain, x0, y0, step, out, stats);
+	}
+
+	template <typename Source, typename T>
+	void fillGrid(const Source & source, const Affine<3> & domain, T x0, T y0, T z, T step, const ImageView<T> & out, FillStats<T> & stats) {
+		Fill::affineGrid(source, domain, x0, y0, z, step, out, stats);
+	}
+
+	// As fillVolume, sampling source at domain(x0 + i * step, y0 + j * step,
+	// z0 + k * step) for every voxel (i, j, k).
+	template <typename Source, typename T>
+	void fillVolume(const Source & source, const Affine<3> & domain, T x0, T y0, T z0, T step, size_t width, size_t height, size_t depth, T * out) {
+		Fill::NoStats none;
+		Fill::affineVolume(source, domain, x0, y0, z0, step, width, height, depth, out, none);
+	}
+
+	template <typename Source, typename T>
+	void fillVolume(const Source & source, const Affine<3> & domain, T x0, T y0, T z0, T step, size_t width, size_t height, size_t depth, T * out, FillStats<T> & stats) {
+		Fill::affineVolume(source, domain, x0, y0, z0, step, width, height, depth, out, stats);
+	}
+
+}